@@ -58,6 +58,8 @@
 	#define	FREQ2_HZ						(3209)
 	#define	FREQ3_HZ						(3627)
 	#define	FREQ4_HZ						(4046)
+	#define DEVIATION_LUT           (1)  // 1 if the calibrated deviation can use a lookup table of the normalised
+	                                     // amplitude difference, generated by an extended calibration (CAN command)
 #endif
 
 //*************************************************************************************************************
@@ -98,6 +100,28 @@
 																		 of 1111,111... nsec with ADCS =43 and 
 																		 4 AN to scan -> Tad*15*4 
 																		 (previous TAD = 425nsec w/ ADCS = 16 */
+#define CAN_BITRATE_DIP         (0)          /* 1 if the CAN bit rate is selected by DIP switches on RF4, RF5:
+																		 off = stored bit rate (default 250kbps),
+																		 125kbps, 500kbps, 1Mbps */
+#define CAN_PDO_COMPACT         (0)          /* 1 if the compact PDO layout is used until another layout is
+																		 stored (CAN command) */
+#define CAN_SYNC_REPHASE        (0)          /* 1 if the Goertzel window starts at a received SYNC (0x080),
+																		 while SYNC is received */
+#define CAN_TIMESTAMP           (0)          /* 1 if the timestamp diagnostic page follows every transmitted
+																		 deviation PDO */
+#define SCHED_IDLE              (1)          /* 1 if the CPU enters Idle mode when no task is pending */
+#define SCHED_LOAD_REPORT       (0)          /* 1 if the CPU load diagnostic page is sent every second */
+#define INT_NESTING             (1)          /* 1 if interrupts are nested: Timer1 and CAN preempt the A/D
+																		 interrupt (see interrupts.h for the priorities) */
+#define INT_LATENCY_MONITOR     (1)          /* 1 if the entry latency of the Timer1, A/D and CAN interrupts
+																		 is measured (histogram) */
+#define PERF_COUNTERS           (1)          /* 1 if the execution time of the main functions is measured
+																		 (diagnostic page PERF) */
+#define SAMPLE_CAPTURE          (0)          /* 1 if antenna samples can be captured and streamed through the
+																		 diagnostic PDO (CAN command), uses 3 bytes RAM per pair */
+#define CAPTURE_PAIRS           (HN_WDW_SZ)  /* Highest number of captured sample pairs, at most 255 */
+#define INT_T1_JITTER_MAX_USEC  (10)         /* usec, bound of the Timer1 entry latency; exceeding entries
+																		 are counted and reported */
 
 //*************************************************************************************************************
 //* Debug defines, shall all be 0 when AGV is operational
@@ -22,11 +22,25 @@
 #define HN_WDW_VAR	(20)
 #endif
 
+// Coefficient set used by the Goertzel step. Two sets are kept: the active set is
+// read by ANT_Step, the staging set is written by ANT_Set_Freqs/ANT_Stage_Gains and
+// replaces the active set between ANT_FinalStep and the next ANT_Step.
+typedef struct
+{
+	Uint8	version;	// Incremented each time the set becomes active
+	int16	cos_coeff[NBR_FREQUENCIES];	// Cosine coefficients, same order as the filter states
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	int16	sin_coeff[2];	// Sine coefficient of the 1st Input Freq. and its 2nd Harmonic
+	#endif
+	int16	gain_left[NBR_INPUT_FREQ];	// Calibration gains
+	int16	gain_right[NBR_INPUT_FREQ];
+} T_ant_coeff_set_t;
+
 // Antenna Initialization
 void ANT_Initialize(T_wireGuid_t *);
 
 // Needs to be processed once each sample period (called in timer interrupt)
-void ANT_Step(int ADValueLeft, int ADValueRight);
+void ANT_Step(int16 ADValueLeft, int16 ADValueRight);
 
 // Final step for antenna calculations
 void ANT_FinalStep(T_wireGuid_t *);
@@ -36,16 +50,24 @@ void ANT_Set_Freqs(Uint8 *, T_wg_coefficient_t *, E_wg_coeff_status_t *);
 
 // Stores updated Frequency values
 void ANT_Store_Freqs(T_wg_coefficient_t *, E_wg_coeff_status_t *);
+sbool ANT_Store_Busy(void);
 
 // Loads Frequency values
 void ANT_Load_Freqs(T_wg_coefficient_t *, E_wg_coeff_status_t *);
 
+// Stages new calibration gains, applied at the next batch boundary
+void ANT_Stage_Gains(const Uint16 *gain_left, const Uint16 *gain_right);
+
+// Windows start at a received SYNC
+void ANT_Sync_Window(sbool enable);
+void ANT_Sync_Start(void);
+
 // Global Variables
 extern Uint8    ANT_k;
 extern Uint8    ANT_k_max;
+extern volatile sbool ANT_WaitSync;
+extern volatile sbool ANT_BatchReady;
 extern int16    ANT_Deviation[NBR_INPUT_FREQ];
-extern int16    AntAmpGainLeft[NBR_INPUT_FREQ];
-extern int16    AntAmpGainRight[NBR_INPUT_FREQ];
 #if SECOND_HARMONIC_FIRST_FREQUENCY
 extern int32    AntRelPhaseLeft[2];
 extern int32    AntRelPhaseRight[2];
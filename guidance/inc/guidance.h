@@ -19,6 +19,9 @@ typedef struct{
 /* Function declarations */
 void Guid_init(T_guidData_t  *guidanceData);
 void Guid_process(T_guidData_t  *guidanceData);
+sbool Guid_batch(T_guidData_t  *guidanceData);
+void Guid_bit(T_guidData_t  *guidanceData);
+void Guid_store(T_guidData_t  *guidanceData);
 
 extern T_guidData_t	gGuidanceData;
 
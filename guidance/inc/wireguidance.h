@@ -18,6 +18,9 @@
 /* WG_DEVIATION_INVALID is the value to which deviation is set when it is not valid */
 #define WG_DEVIATION_INVALID          (0x7FFF)
 
+/* deviation_fine has WG_DEVIATION_FINE_SCALE times the resolution of deviation_m2ecm */
+#define WG_DEVIATION_FINE_SCALE       (4)
+
 #if SECOND_HARMONIC_FIRST_FREQUENCY
 /* WG_REL_PHASE_INVALID is the value to which the relative phase is set when the 
 	first Input Frequency is not present */
@@ -28,20 +31,24 @@
    to WG_CALIBRATION_DEFAULT_PARAM */
 #define WG_CALIBRATION_DEFAULT_PARAM  (2000)
 
+/* The calibration times are counted in WG_CALIBRATION_TICK_MSEC units of the
+   1 msec tick, independent of the batch period. The unit is the batch period 
+   of the batches processed at the 100Hz tick, which the times used to count. */
+#define WG_CALIBRATION_TICK_MSEC      (20)
+
 /* WG_DELAY_CALIBRATION_COUNTER is a counter used to delay the calibration with 
-  500msec, once the 'start calibration' is triggered (50*100Hz) */
+  1sec, once the 'start calibration' is triggered (50*20msec) */
 #define WG_DELAY_CALIBRATION_COUNTER  (50)
 
-/* WG_MIN_CALIBRATION_COUNTER is the counter used to set the minimal duration
-   of calibration, 300msec, once the calibration has started (30*100Hz). When
-   at WG_MIN_CALIBRATION_COUNTER, the calibration parameter is still too small
-   (WG_MIN_CALIBRATION_PARAM), calibration for that frequency is stopped, as it 
-   is failing. */
-#define WG_MIN_CALIBRATION_COUNTER    (30+WG_DELAY_CALIBRATION_COUNTER)
+/* WG_MIN_CALIBRATION_TIME sets the minimal duration of calibration, 600msec,
+   once the calibration has started (30*20msec). When after this time the 
+   calibration parameter is still too small (WG_MIN_CALIBRATION_PARAM), 
+   calibration for that frequency is stopped, as it is failing. */
+#define WG_MIN_CALIBRATION_TIME       (30)
 
-/* WG_MAX_CALIBRATION_COUNTER is the counter used to stop the calibration when
-   calibration criteria are not met. */
-#define WG_MAX_CALIBRATION_COUNTER	(100+WG_DELAY_CALIBRATION_COUNTER)
+/* WG_MAX_CALIBRATION_TIME is used to stop the calibration when calibration 
+   criteria are not met, 2sec once the calibration has started (100*20msec). */
+#define WG_MAX_CALIBRATION_TIME       (100)
 
 /* WG_MIN_CALIBRATION_PARAM is used to detect whether a frequency is available 
    for calibration, together with amplitude strength (parameter) */
@@ -54,6 +61,32 @@
 /* Amplitude is scaled to this WG_MAX_AMPLITUDE, to compute deviation */
 #define WG_MAX_AMPLITUDE              	(180)
 
+/* Layout version of the stored runtime parameters, first word of the record */
+#define WG_PARAM_VERSION              (1)
+
+#if DEVIATION_LUT
+/* Points of the deviation lookup table, evenly spaced over the normalised
+   amplitude difference (L-R)/(L+R) in [-span ; span]. With the version, the
+   Input Frequency and the span, the table fills the payload of an EEPROM record. */
+#define WG_LUT_POINTS                 (11)
+
+/* Layout version of the stored lookup table, low byte of the first word of the
+   record, the Input Frequency of the table is the high byte. Version 1 tables
+   had no Input Frequency and are not loaded. */
+#define WG_LUT_VERSION                (2)
+
+/* Smallest span of the table, Q15 (0.03) */
+#define WG_LUT_MIN_SPAN               (1024)
+
+/* Reference offsets of an extended calibration, largest reference offset
+   (deviation_fine units) */
+#define WG_LUT_MAX_REFS               (16)
+#define WG_LUT_MAX_OFFSET             (16383)
+
+/* Batches averaged for a reference offset (about 0.5 sec) */
+#define WG_LUT_AVERAGE                (32)
+#endif
+
 //******************************************************************************************************
 // Typedefs
 //******************************************************************************************************
@@ -92,6 +125,37 @@ typedef enum
 	WG_COEFF_STATUS_FAILED			/* Loading/Storing Freq. values failed */
 } E_wg_coeff_status_t;
 
+typedef enum
+{
+	WG_STORE_STEP_START = 0,	/* Queue calibration record */
+	WG_STORE_STEP_RECORD		/* Record queued, waiting for completion */
+} E_wg_store_step_t;
+
+#if DEVIATION_LUT
+/* Extended calibration: sub-command, byte 1 of CAN_CMD_LUT */
+typedef enum
+{
+	WG_LUT_CMD_CLEAR = 0,		/* Clear the reference offsets and their Input Frequency */
+	WG_LUT_CMD_REFERENCE,		/* The wire of Input Frequency (byte 4) is at the offset (bytes 2-3,
+									deviation_fine units): average its normalised difference. All
+									references of a table are of the Input Frequency of the first */
+	WG_LUT_CMD_STORE,			/* Compute the table from the references, store and use it */
+	WG_LUT_CMD_ERASE,			/* Store an empty table: deviation from the amplitudes again */
+	WG_LUT_CMD_LAST
+} E_wg_lut_cmd_t;
+
+typedef enum
+{
+	WG_LUT_STATUS_IDLE = 0,		/* No command, or the last reference is averaged */
+	WG_LUT_STATUS_MEASURING,	/* Averaging a reference offset */
+	WG_LUT_STATUS_STORING,		/* Table queued for EEPROM */
+	WG_LUT_STATUS_SUCCEEDED,	/* Table stored and used */
+	WG_LUT_STATUS_FAILED		/* Reference not measured (no valid deviation, too many, other Input
+									Frequency), references not monotonic or too few, or EEPROM write
+									failed */
+} E_wg_lut_status_t;
+#endif
+
 typedef enum
 {
 	WG_NIBBLE_STATUS_SYNC = 0,
@@ -143,6 +207,17 @@ typedef struct
 	E_wg_coeff_status_t coeff_status;
 } T_wg_coefficient_t;
 
+#if DEVIATION_LUT
+/* Deviation lookup table, stored as version and Input Frequency, span and points */
+typedef struct
+{
+	Uint8	freq;						/* Input Frequency the table was measured on, only used for it */
+	int16	span;						/* Normalised difference of the last point, Q15 */
+	int16	point[WG_LUT_POINTS];		/* deviation_fine at -span + i * 2 * span / (WG_LUT_POINTS - 1) */
+	Uint32	scale;						/* (WG_LUT_POINTS - 1) * 2^24 / (2 * span), not stored */
+} T_wg_lut_t;
+#endif
+
 typedef struct
 {
 	/* Already foreseen, in case of omni-directional antenna in future */
@@ -151,8 +226,17 @@ typedef struct
 	/* Calibration_status indicates the overall calibration status */
 	E_wg_calib_status_t 	calibration_status;
   
-	/* Calibration counter is used to delay calibration and to check the minimal calibration time */
+	/* Calibration counter is used to delay calibration and to check the minimal calibration time:
+		time since the start of the calibration [WG_CALIBRATION_TICK_MSEC], from the 1 msec
+		tick at calibration_start_msec */
 	Uint16              			calibration_counter;
+	Uint16							calibration_start_msec;
+
+	/* Storing calibration parameters in EEPROM: step, record write not yet 
+		completed, record write failed */
+	E_wg_store_step_t		store_step;
+	volatile sbool			store_pending;
+	volatile sbool			store_failed;
 
 	/* calibration_left and _right contain all variables related to calibration procedure for the left and right antenna coil */
 	T_wg_calibration_t  	calibration_left;
@@ -168,6 +252,43 @@ typedef struct
 	
 	/* Overall status of the Frequency values, coefficients */
 	E_wg_coeff_status_t	freq_status;
+
+	/* User-defined Frequencies are loaded after start-up, defaults are used until then */
+	sbool						user_freqs_loaded;
+
+	/* Version of the coefficient set the last batch was computed with */
+	Uint8						coeff_version;
+
+	/* ADC sample counter (ADC_sampleCounter) at the last sample of the last batch */
+	Uint32						window_end;
+
+	/* Frequencies with a valid deviation in the last batch (bit per frequency) */
+	Uint8						valid_mask;
+
+	/* Frequency configuration received through CAN, processed outside the CAN interrupt */
+	Uint8						freq_request[8];
+	sbool						freq_request_pending;
+
+	#if DEVIATION_LUT
+	/* Deviation lookup table: used for its Input Frequency when valid and the
+		antenna is calibrated */
+	T_wg_lut_t					lut;
+	sbool						lut_valid;
+
+	/* Extended calibration: status, reference offsets and their normalised 
+		differences, their Input Frequency, the reference being averaged, table
+		being stored */
+	E_wg_lut_status_t			lut_status;
+	Uint8						lut_refs;
+	int16						lut_ref_offset[WG_LUT_MAX_REFS];
+	int16						lut_ref_diff[WG_LUT_MAX_REFS];
+	Uint8						lut_freq;
+	Uint8						lut_count;
+	int32						lut_sum;
+	T_wg_lut_t					lut_new;
+	volatile sbool				lut_store_pending;
+	volatile sbool				lut_store_failed;
+	#endif
 	
 	/* Result of the wire guidance: a left and right amplitude. Based on this
 		amplitude, the deviation is determined. */
@@ -179,6 +300,7 @@ typedef struct
 
 	/* Deviation has not to be computed for test frequency and the 2nd Harmonic */
 	int16						deviation_m2ecm[NBR_INPUT_FREQ];
+	int16						deviation_fine[NBR_INPUT_FREQ];
 
 	#if SECOND_HARMONIC_FIRST_FREQUENCY
 	/* Relative Phase between 1st Input Freq. - 2nd Harmonic (normalized cosine and sine) */
@@ -204,9 +326,38 @@ typedef struct
 	#endif
 }T_wireGuid_t;
 
+/* Runtime parameters, defaults are the former compile-time constants. They can
+   be changed through the object dictionary (index 0x2000) and are stored in
+   EEPROM. All fields are 16-bit, the struct is stored as record payload. */
+typedef struct
+{
+	Uint16	deviation_scale;		/* Scale of the amplitude to deviation conversion */
+	Uint16	deviation_range;		/* Deviation is limited to +/- deviation_range */
+	Uint16	amplitude_min;			/* Minimal amplitude to compute deviation */
+	int16	qam_comp_noise;			/* QAM component noise */
+	Uint16	qam_noise;				/* QAM square amplitude noise */
+	Uint16	calib_delay;			/* See WG_DELAY_CALIBRATION_COUNTER */
+	Uint16	calib_min_time;			/* See WG_MIN_CALIBRATION_TIME */
+	Uint16	calib_max_time;			/* See WG_MAX_CALIBRATION_TIME */
+	Uint16	calib_min_param;		/* See WG_MIN_CALIBRATION_PARAM */
+	int16	bit_max_refvolt_short_circuit;	/* See BIT_ANT_MAX_REFVOLT_SHORT_CIRCUIT */
+	int16	bit_min_refvolt;		/* See BIT_ANT_MIN_REFVOLT */
+	int16	bit_max_refvolt;		/* See BIT_ANT_MAX_REFVOLT */
+} T_wg_param_t;
+
+extern T_wg_param_t	gWireGuidParam;
+
 /* Function declarations */
 void WireGuid_init(T_wireGuid_t  *wireGuidData);
 void WireGuid_process(T_wireGuid_t  *pWireGuidData);
+sbool WireGuid_batch(T_wireGuid_t  *pWireGuidData);
+void WireGuid_bit(T_wireGuid_t  *pWireGuidData);
+void WireGuid_store(T_wireGuid_t  *pWireGuidData);
+void WireGuid_param_defaults(void);
+sbool WireGuid_param_store(void);
+#if DEVIATION_LUT
+void WireGuid_lut_command(T_wireGuid_t  *pWireGuidData, const Uint8 *param);
+#endif
 
 #endif
 
@@ -13,12 +13,31 @@ static const Uint32 __attribute__((space(auto_psv))) ANT_AMPLITUDE_GAIN = 4000UL
 // 2*PI is used to calculate the Frequency coefficients
 static const double __attribute__((space(auto_psv))) math_2pi = (double)MATH_2PI;
 
+// Default Frequency coefficients, 8192 x cos/sin(2.pi.Ft/Fs) as computed on target
+// (see ANT_Load_Freqs) with 32-bit doubles, reproduced and checked by host/coeff/coeff_gen.
+// They are used at start-up, so no coefficients are computed before the first batch.
+#if (ADC_SAMPLING_FREQ_Hz != 15000) || (NBR_INPUT_FREQ != 4) || (FREQ1_HZ != 2790) || \
+	(FREQ2_HZ != 3209) || (FREQ3_HZ != 3627) || (FREQ4_HZ != 4046) || \
+	(BIT_WIREGUID_ACTIVE && (TEST_FREQUENCY_HZ != 5000))
+	#error "Default Frequency coefficients do not match configuration.h! Recompute ANT_DEFAULT_COS_COEFF."
+#endif
+static const int16 __attribute__((space(auto_psv))) 
+ANT_DEFAULT_COS_COEFF[NBR_INPUT_FREQ] = {3206, 1840, 421, -1013};
+#if BIT_WIREGUID_ACTIVE
+static const int16 __attribute__((space(auto_psv))) ANT_TEST_FREQ_COS_COEFF = -4096;
+#endif
+#if SECOND_HARMONIC_FIRST_FREQUENCY
+static const int16 __attribute__((space(auto_psv))) ANT_DEFAULT_SIN_COEFF = 7538;
+static const int16 __attribute__((space(auto_psv))) ANT_DEFAULT_2ND_HARM_COS_COEFF = -5682;
+static const int16 __attribute__((space(auto_psv))) ANT_DEFAULT_2ND_HARM_SIN_COEFF = 5900;
+#endif
+
 // External variables
-int16	AntAmpGainLeft[NBR_INPUT_FREQ];
-int16	AntAmpGainRight[NBR_INPUT_FREQ];
 int16   ANT_Deviation[NBR_INPUT_FREQ];
 Uint8	ANT_k;
 Uint8	ANT_k_max = (Uint8)HN_WDW_SZ;
+volatile sbool	ANT_WaitSync;	// Next window starts at ANT_Sync_Start()
+volatile sbool	ANT_BatchReady;	// Window complete, set by ANT_Step, cleared by WireGuid_batch
 #if SECOND_HARMONIC_FIRST_FREQUENCY
 int32 AntRelPhaseLeft[2];
 int32 AntRelPhaseRight[2];
@@ -33,21 +52,176 @@ clock_t t[5]; // ticks of step, final step, per batch, total, A/D interrupt
 // Internal variables
 Uint32  	AntResultLeftFinal[NBR_INPUT_FREQ];
 Uint32  	AntResultRightFinal[NBR_INPUT_FREQ];
-int16   	AntCoeff[NBR_FREQUENCIES];
-#if	SECOND_HARMONIC_FIRST_FREQUENCY
-int16 AntSINECoeff[2]; // Sine coefficient of the 1st Input Freq. and its 2nd Harmonic
-#endif
+T_ant_coeff_set_t	AntCoeffSet[2];	// Active and staging coefficient sets
+Uint8	AntCoeffActive;		// Index of the set used by ANT_Step
+sbool	AntCoeffPending;	// Staging set is complete and waits for the batch boundary
+sbool	AntSyncWindow;		// Windows start at a received SYNC
+Uint32	AntWindowEnd;		// ADC sample counter at the last sample of the window
 int16	   	AntQL[NBR_FREQUENCIES][2];
 int16 	AntQR[NBR_FREQUENCIES][2];
 
 static Uint16 Input_Freq_Table[NBR_INPUT_FREQ];
 
+// Storing of updated Freq. values, completed by the EEPROM record callback
+static T_wg_coefficient_t	*AntStoreFrequencies;
+static E_wg_coeff_status_t	*AntStoreStatus;
+static E_wg_coeff_status_t	AntStoreDone;	// Overall status once written: user-defined, or default after a reset
+static volatile sbool		AntStoreBusy;
+
 // Prototypes
 void    ANT_Initialize(T_wireGuid_t *);
-void    ANT_Step(int ADValueLeft, int ADValueRight);
+void    ANT_Step(int16 ADValueLeft, int16 ADValueRight);
 void    ANT_FinalStep(T_wireGuid_t *);
 Uint32  ANT_Sqrt(Uint32 r3);
 
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+//! Returns the staging coefficient set. When no update is pending yet, the staging
+//! set is first filled with the active set, so that only the changed values differ.
+static T_ant_coeff_set_t *ant_open_staging(void)
+{
+	T_ant_coeff_set_t *pStaging = &AntCoeffSet[AntCoeffActive ^ 1U];
+
+	if (!AntCoeffPending)
+	{
+		*pStaging = AntCoeffSet[AntCoeffActive];
+		++pStaging->version;
+	}
+
+	return pStaging;
+}
+
+//*****************************************************************************
+//! Makes the staging set active. Only called while ANT_Step is not running, i.e.
+//! between ANT_FinalStep and the reset of the sample counter, or at initialization.
+static void ant_swap_coeff_set(void)
+{
+	if (AntCoeffPending)
+	{
+		AntCoeffActive ^= 1U;
+		AntCoeffPending = false;
+	}
+
+	return;
+}
+
+//*****************************************************************************
+//! Sets the i-th Freq. (and the 2nd Harmonic for the 1st Freq.) to its default
+//! value and coefficients.
+static void ant_set_default_freq(T_wg_coefficient_t *frequencies, Uint8 i)
+{
+	frequencies[i].freq_value = Input_Freq_Table[i];
+	frequencies[i].cos_coefficient = ANT_DEFAULT_COS_COEFF[i];
+	frequencies[i].sin_coefficient = 0;
+	frequencies[i].coeff_status = WG_COEFF_STATUS_DEFAULT;
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	if (i == 0U)
+	{
+		frequencies[i].sin_coefficient = ANT_DEFAULT_SIN_COEFF;
+		frequencies[NBR_INPUT_FREQ].freq_value = 2 * frequencies[i].freq_value;
+		frequencies[NBR_INPUT_FREQ].cos_coefficient = ANT_DEFAULT_2ND_HARM_COS_COEFF;
+		frequencies[NBR_INPUT_FREQ].sin_coefficient = ANT_DEFAULT_2ND_HARM_SIN_COEFF;
+		frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_DEFAULT;
+	}
+	#endif
+
+	return;
+}
+
+//*****************************************************************************
+//! Copies the Frequency coefficients to the staging set.
+static void ant_stage_freqs(const T_wg_coefficient_t *frequencies)
+{
+	Uint8 i;
+	// Index of local Freq. Coeffs., takes into account presence 
+	// of Test Frequency/Pilot Tone (PWM)
+	Uint8 freq_idx;
+	T_ant_coeff_set_t *pStaging = ant_open_staging();
+
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+	{
+		#if BIT_WIREGUID_ACTIVE
+		freq_idx = i + 1;
+		#else
+		freq_idx = i;
+		#endif
+
+		pStaging->cos_coeff[freq_idx] = frequencies[i].cos_coefficient;
+	}
+	#if BIT_WIREGUID_ACTIVE
+	pStaging->cos_coeff[0] = ANT_TEST_FREQ_COS_COEFF;
+	#endif
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	pStaging->sin_coeff[0] = frequencies[0].sin_coefficient;
+	pStaging->cos_coeff[NBR_FREQUENCIES-1] = frequencies[NBR_INPUT_FREQ].cos_coefficient;
+	pStaging->sin_coeff[1] = frequencies[NBR_INPUT_FREQ].sin_coefficient;
+	#endif
+	AntCoeffPending = true;
+
+	return;
+}
+
+//*****************************************************************************
+//! Sets all Frequencies to their default values and stages their coefficients.
+static void ant_load_default_freqs(T_wg_coefficient_t *frequencies, E_wg_coeff_status_t *status)
+{
+	Uint8 i;
+
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+		ant_set_default_freq(frequencies, i);
+	*status = WG_COEFF_STATUS_DEFAULT;
+	ant_stage_freqs(frequencies);
+
+	return;
+}
+
+//*****************************************************************************
+//! EEPROM callback of the Freq. record. Ends the storing process. Called from the
+//! NVM interrupt, or directly from eeprom_record_store() when unchanged.
+static void ant_store_callback(Uint16 tag, sbool success)
+{
+	Uint8 i;
+
+	/* Check success/failure of storing process and update 
+		updated freq. status accordingly */
+	for(i = 0U; i < NBR_INPUT_FREQ; ++i)	
+	{
+		if (AntStoreFrequencies[i].coeff_status != WG_COEFF_STATUS_UPDATED)
+			continue;
+		AntStoreFrequencies[i].coeff_status = success ? WG_COEFF_STATUS_USER : WG_COEFF_STATUS_FAILED;
+		#if SECOND_HARMONIC_FIRST_FREQUENCY
+		if (i == 0U)
+			AntStoreFrequencies[NBR_INPUT_FREQ].coeff_status = success ? WG_COEFF_STATUS_USER : WG_COEFF_STATUS_FAILED;
+		#endif
+	}
+	*AntStoreStatus = success ? AntStoreDone : WG_COEFF_STATUS_FAILED;
+	AntStoreBusy = false;
+
+	return;
+}
+
+//*****************************************************************************
+//! Reads stored Freq. values from the newest Freq. record. When no record is 
+//! present, values stored at fixed addresses by earlier versions are used.
+//! Both are read from the RAM copy made at start-up. Returns false when no
+//! values are stored. 0xFFFF is a default Freq.
+static sbool ant_read_stored_freqs(Uint16 *freq_values)
+{
+	Uint8 i;
+
+	if (eeprom_record_load(EEPROM_RECORD_FREQS, freq_values, NBR_INPUT_FREQ))
+		return true;
+
+	if (eeprom_read_legacy(EEPROM_ANT_COEFF_DATA_WRITTEN) != WG_EEPROM_COEFFS_STORED)
+		return false;
+
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+		freq_values[i] = eeprom_read_legacy((E_eeprom_ID_t)(i+EEPROM_ANT_COEFF_FREQ1));
+
+	return true;
+}
+
 //*****************************************************************************
 // Local functions
 //*****************************************************************************
@@ -56,6 +230,8 @@ void ANT_Initialize(T_wireGuid_t *pWireGuidData)
 {
     // Local counting variables
     Uint8 i;
+	// Coefficient set filled during initialization
+	T_ant_coeff_set_t *pStaging;
 	
 	// Initialize Timers
 	#if DBG_TIME
@@ -65,6 +241,13 @@ void ANT_Initialize(T_wireGuid_t *pWireGuidData)
 	t[3] = 0;	// instruction-counter of all batches. never reset, except if program restarts (-> resets in antenna init)
 	#endif
 
+	// Initialize coefficient sets. Coefficients and gains are staged below and
+	// activated before the first batch.
+	memset((void*)AntCoeffSet, 0, sizeof(AntCoeffSet));
+	AntCoeffActive = 0U;
+	AntCoeffPending = false;
+	pStaging = ant_open_staging();
+
     // For Input Frequencies
     for (i = 0U; i < NBR_INPUT_FREQ; ++i)
     {
@@ -85,11 +268,13 @@ void ANT_Initialize(T_wireGuid_t *pWireGuidData)
 		// Initialize Deviations
 		ANT_Deviation[i] = WG_DEVIATION_INVALID;
 		pWireGuidData->deviation_m2ecm[i] = ANT_Deviation[i];
+		pWireGuidData->deviation_fine[i] = WG_DEVIATION_INVALID;
 		
 		// Initialize Calibration Gains
-		AntAmpGainLeft[i] = pWireGuidData->calibration_left.calibration_param[i];
-		AntAmpGainRight[i] = pWireGuidData->calibration_right.calibration_param[i];
+		pStaging->gain_left[i] = pWireGuidData->calibration_left.calibration_param[i];
+		pStaging->gain_right[i] = pWireGuidData->calibration_right.calibration_param[i];
     }
+	AntCoeffPending = true;
 
 	// Takes into account Pilot Tone, 2nd Harmonic 
 	#if BIT_WIREGUID_ACTIVE // Test Freq.
@@ -178,8 +363,9 @@ void ANT_Initialize(T_wireGuid_t *pWireGuidData)
 				#error "No input frequencies! Check configuration (configuration.h)"
 			#endif
 		#endif // End 2nd Harmonic enabled/disabled
-		// Load Frequency values, calculate Frequency coefficients. Stored in wiredguidance struct.
-		ANT_Load_Freqs(pWireGuidData->frequencies, &(pWireGuidData->freq_status));
+		// Start with default Frequency values and coefficients. Stored in wiredguidance struct.
+		// User-defined Frequencies are loaded by ANT_Load_Freqs, after start-up.
+		ant_load_default_freqs(pWireGuidData->frequencies, &(pWireGuidData->freq_status));
 		
 	#else // No Test Freq.
 		#if SECOND_HARMONIC_FIRST_FREQUENCY // 2nd harmonic of the the first input freq. enabled
@@ -254,10 +440,20 @@ void ANT_Initialize(T_wireGuid_t *pWireGuidData)
 				#error "No input frequencies! Check configuration (configuration.h)"
 			#endif
 		#endif // End 2nd Harmonic enabled/disabled
-		// Load Frequency values, calculate Frequency coefficients. Stored in wiredguidance struct. 
-		ANT_Load_Freqs(pWireGuidData->frequencies, &(pWireGuidData->freq_status));
+		// Start with default Frequency values and coefficients. Stored in wiredguidance struct.
+		// User-defined Frequencies are loaded by ANT_Load_Freqs, after start-up.
+		ant_load_default_freqs(pWireGuidData->frequencies, &(pWireGuidData->freq_status));
 	#endif // End test freq enabled/disabled
 
+	// Activate initial coefficients and gains
+	ant_swap_coeff_set();
+	pWireGuidData->coeff_version = AntCoeffSet[AntCoeffActive].version;
+
+	// Free-running windows until SYNC is received
+	AntSyncWindow = false;
+	ANT_WaitSync = false;
+	ANT_BatchReady = false;
+
     /// RESET SAMPLE COUNTER
     ANT_k = 0U;
 
@@ -276,6 +472,8 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
 
 	// Local variable
     Uint8  i;
+	// Coefficient set the finished batch was computed with
+	const T_ant_coeff_set_t *pBatchSet = &AntCoeffSet[AntCoeffActive];
 
 	//Local Filter States declaration
 	int16 Q_left[NBR_FREQUENCIES][2];
@@ -295,6 +493,13 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
        	AntQR[i][0] = 0;
        	AntQR[i][1] = 0;
    	}
+	// Activate staged coefficients/gains before the next batch starts. The
+	// previous set stays untouched until it is staged again, after this function.
+	ant_swap_coeff_set();
+	pWireGuidData->coeff_version = pBatchSet->version;
+	pWireGuidData->window_end = AntWindowEnd;
+	// Next window waits for the SYNC, set before the sample counter is reset
+	ANT_WaitSync = AntSyncWindow;
     // Reset Sample counter
     ANT_k = 0U;
 
@@ -309,17 +514,21 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
 			// Left channel Test Frequency
 			pWireGuidData->amplitudePWM[0] = ((int32)((int32)Q_left[i][1] * (int32)Q_left[i][1]) >> 13)
 				+ ((int32)((int32)Q_left[i][0] * (int32)Q_left[i][0]) >> 13)
-				- ((int32)(((int32)((int32)Q_left[i][0] * (int32)Q_left[i][1]) >> 15) * (int32)AntCoeff[i]) >> 10);
-			// Limit
-			if (pWireGuidData->amplitudePWM[0] > 255UL)
+				- ((int32)(((int32)((int32)Q_left[i][0] * (int32)Q_left[i][1]) >> 15) * (int32)pBatchSet->cos_coeff[i]) >> 10);
+			// Limit, the truncations give slightly negative results without a pilot tone
+			if ((int32)pWireGuidData->amplitudePWM[0] < 0L)
+					pWireGuidData->amplitudePWM[0] = 0UL;
+			else if (pWireGuidData->amplitudePWM[0] > 255UL)
 					pWireGuidData->amplitudePWM[0] = 255UL;
 
 			// Right channel Test Frequency
 			pWireGuidData->amplitudePWM[1] = ((int32)((int32)Q_right[i][1] * (int32)Q_right[i][1]) >> 13)
 				+ ((int32)((int32)Q_right[i][0] * (int32)Q_right[i][0]) >> 13)
-				- ((int32)(((int32)((int32)Q_right[i][0] * (int32)Q_right[i][1]) >> 15) * (int32)AntCoeff[i]) >> 10);
-			// Limit
-			if (pWireGuidData->amplitudePWM[1] > 255UL)
+				- ((int32)(((int32)((int32)Q_right[i][0] * (int32)Q_right[i][1]) >> 15) * (int32)pBatchSet->cos_coeff[i]) >> 10);
+			// Limit, the truncations give slightly negative results without a pilot tone
+			if ((int32)pWireGuidData->amplitudePWM[1] < 0L)
+					pWireGuidData->amplitudePWM[1] = 0UL;
+			else if (pWireGuidData->amplitudePWM[1] > 255UL)
 					pWireGuidData->amplitudePWM[1] = 255UL;
 		}
 	
@@ -329,7 +538,7 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
 		// Left channel Input Frequencies
         TempResult = ((int32)((int32)Q_left[i+1][1] * (int32)Q_left[i+1][1]) >> 13)
 			+ ((int32)((int32)Q_left[i+1][0] * (int32)Q_left[i+1][0]) >> 13)
-            - ((int32)(((int32)((int32)Q_left[i+1][0] * (int32)Q_left[i+1][1]) >> 15) * (int32)AntCoeff[i+1]) >> 10);
+            - ((int32)(((int32)((int32)Q_left[i+1][0] * (int32)Q_left[i+1][1]) >> 15) * (int32)pBatchSet->cos_coeff[i+1]) >> 10);
 
         // Take square root and limit
         pWireGuidData->amplitudeLeft[i] = ANT_Sqrt(TempResult);
@@ -340,7 +549,7 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
 		// Right channel Input Frequencies
         TempResult = ((int32)((int32)Q_right[i+1][1] * (int32)Q_right[i+1][1]) >> 13)
             + ((int32)((int32)Q_right[i+1][0] * (int32)Q_right[i+1][0]) >> 13)
-            - ((int32)(((int32)((int32)Q_right[i+1][0] * (int32)Q_right[i+1][1]) >> 15) * (int32)AntCoeff[i+1]) >> 10);
+            - ((int32)(((int32)((int32)Q_right[i+1][0] * (int32)Q_right[i+1][1]) >> 15) * (int32)pBatchSet->cos_coeff[i+1]) >> 10);
 
         // Take square root and limit
         pWireGuidData->amplitudeRight[i] = ANT_Sqrt(TempResult);
@@ -358,17 +567,19 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
     {
         // Local variables
         /* Cosine and Sine of 2nd Harmonic phase */
-        int32	phi_2ndHarmonic[] = { ((int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)AntCoeff[NBR_FREQUENCIES-1]) >> 13)
+        int32	phi_2ndHarmonic[] = { ((int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->cos_coeff[NBR_FREQUENCIES-1]) >> 13)
                                                 - (int32)Q_left[NBR_FREQUENCIES-1][1], 
-                                                (int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)AntSINECoeff[1]) >> 13 };
+                                                (int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->sin_coeff[1]) >> 13 };
         /* Cosine and Sine of 1st Input Freq. */
-        int32 phi_1stFreq[] = { ((int32)((int32)Q_left[1][0] * (int32)AntCoeff[1]) >> 13) - (int32)Q_left[1][1],
-                                        (int32)((int32)Q_left[1][0] * (int32)AntSINECoeff[0]) >> 13 };
+        int32 phi_1stFreq[] = { ((int32)((int32)Q_left[1][0] * (int32)pBatchSet->cos_coeff[1]) >> 13) - (int32)Q_left[1][1],
+                                        (int32)((int32)Q_left[1][0] * (int32)pBatchSet->sin_coeff[0]) >> 13 };
         /* Twice Angle Cosine and Sine of 1st Input Freq. */
         int32	phi_double_1stFreq[] = { ((int32)(phi_1stFreq[0] * phi_1stFreq[0]) - (int32)(phi_1stFreq[1] * phi_1stFreq[1])) >> 13,
                                                     (int32)(phi_1stFreq[0] * phi_1stFreq[1]) >> 12 };
         /* Relative Phase normalizer */
         Uint32 normalize_phi = (Uint32)(AntResultLeftFinal[0] * AntResultLeftFinal[0] * AntResultLeftFinal[0] * ANT_Sqrt(8192UL) / 100UL);
+        if (normalize_phi == 0UL)
+            normalize_phi = 1UL; // Amplitude below 2, no division by zero
     
         // Relative Phase Calculation, Scaled Linear Factor of 100
         // Normalized Cosine -> In-Phase component
@@ -382,13 +593,13 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
     
         /* Right Channel */			
         /* Cosine and Sine of 2nd Harmonic phase */		
-        phi_2ndHarmonic[0] = ((int32)((int32)Q_right[NBR_FREQUENCIES-1][0] * (int32)AntCoeff[NBR_FREQUENCIES-1]) >> 13)
+        phi_2ndHarmonic[0] = ((int32)((int32)Q_right[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->cos_coeff[NBR_FREQUENCIES-1]) >> 13)
                                         - (int32)Q_right[NBR_FREQUENCIES-1][1];
-        phi_2ndHarmonic[1] = (int32)((int32)Q_right[NBR_FREQUENCIES-1][0] * (int32)AntSINECoeff[1]) >> 13;
+        phi_2ndHarmonic[1] = (int32)((int32)Q_right[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->sin_coeff[1]) >> 13;
     
         /* Cosine and Sine of 1st Input Freq. */
-        phi_1stFreq[0] = ((int32)((int32)Q_right[1][0] * (int32)AntCoeff[1]) >> 13) - (int32)Q_right[1][1];
-        phi_1stFreq[1] = (int32)((int32)Q_right[1][0] * (int32)AntSINECoeff[0]) >> 13;
+        phi_1stFreq[0] = ((int32)((int32)Q_right[1][0] * (int32)pBatchSet->cos_coeff[1]) >> 13) - (int32)Q_right[1][1];
+        phi_1stFreq[1] = (int32)((int32)Q_right[1][0] * (int32)pBatchSet->sin_coeff[0]) >> 13;
     
         /* Twice Angle Cosine and Sine of 1st Input Freq. */
         phi_double_1stFreq[0] = ((int32)(phi_1stFreq[0] * phi_1stFreq[0]) - (int32)(phi_1stFreq[1] * phi_1stFreq[1])) >> 13;
@@ -396,6 +607,8 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
     
         /* Relative Phase normalizer */
         normalize_phi = (Uint32)(AntResultRightFinal[0] * AntResultRightFinal[0] * AntResultRightFinal[0] * ANT_Sqrt(8192UL) / 100UL);
+        if (normalize_phi == 0UL)
+            normalize_phi = 1UL; // Amplitude below 2, no division by zero
     
         // Relative Phase Calculation, Scaled Linear Factor of 100
         // Normalized Cosine -> In-Phase component
@@ -420,7 +633,7 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
         // Left channel Goertzel Formula
         TempResult = ((int32)((int32)Q_left[i][1] * (int32)Q_left[i][1]) >> 13)
                      + ((int32)((int32)Q_left[i][0] * (int32)Q_left[i][0]) >> 13)
-                     - ((int32)(((int32)((int32)Q_left[i][0] * (int32)Q_left[i][1]) >> 15) * (int32)AntCoeff[i]) >> 10);
+                     - ((int32)(((int32)((int32)Q_left[i][0] * (int32)Q_left[i][1]) >> 15) * (int32)pBatchSet->cos_coeff[i]) >> 10);
 
         // Take square root and limit
         pWireGuidData->amplitudeLeft[i] = ANT_Sqrt(TempResult);
@@ -431,7 +644,7 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
         // Right channel Goertzel formula
         TempResult = ((int32)((int32)Q_right[i][1] * (int32)Q_right[i][1]) >> 13)
                      + ((int32)((int32)Q_right[i][0] * (int32)Q_right[i][0]) >> 13)
-                     - ((int32)(((int32)((int32)Q_right[i][0] * (int32)Q_right[i][1]) >> 15) * (int32)AntCoeff[i]) >> 10);
+                     - ((int32)(((int32)((int32)Q_right[i][0] * (int32)Q_right[i][1]) >> 15) * (int32)pBatchSet->cos_coeff[i]) >> 10);
 
         // Take square root and limit
         pWireGuidData->amplitudeRight[i] = ANT_Sqrt(TempResult);
@@ -451,14 +664,14 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
         // Local variables
         /* Cosine and Sine of 2nd Harmonic phase */
         int32	phi_2ndHarmonic[] = {
-            ((int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)AntCoeff[NBR_FREQUENCIES-1]) >> 13) -
+            ((int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->cos_coeff[NBR_FREQUENCIES-1]) >> 13) -
                 (int32)Q_left[NBR_FREQUENCIES-1][1], 
-            (int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)AntSINECoeff[1]) >> 13
+            (int32)((int32)Q_left[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->sin_coeff[1]) >> 13
         };
         /* Cosine and Sine of 1st Input Freq. */
         int32 phi_1stFreq[] = {
-            ((int32)((int32)Q_left[0][0] * (int32)AntCoeff[0]) >> 13) - (int32)Q_left[0][1],
-            (int32)((int32)Q_left[0][0] * (int32)AntSINECoeff[0]) >> 13
+            ((int32)((int32)Q_left[0][0] * (int32)pBatchSet->cos_coeff[0]) >> 13) - (int32)Q_left[0][1],
+            (int32)((int32)Q_left[0][0] * (int32)pBatchSet->sin_coeff[0]) >> 13
         };
         /* Twice Angle Cosine and Sine of 1st Input Freq. */
         int32	phi_double_1stFreq[] = {
@@ -468,6 +681,8 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
         /* Relative Phase normalizer */ 
         Uint32 normalize_phi = (Uint32)(AntResultLeftFinal[0] * AntResultLeftFinal[0] * AntResultLeftFinal[0] *
             ANT_Sqrt(8192UL) / 100UL);
+        if (normalize_phi == 0UL)
+            normalize_phi = 1UL; // Amplitude below 2, no division by zero
     
         // Relative phase calculation, Scaled Linear Factor of 100
         // Normalized Cosine
@@ -482,11 +697,11 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
         /* Right Channel */
     
         phi_2ndHarmonic[0] = ((int32)((int32)Q_right[NBR_FREQUENCIES-1][0] *
-            (int32)AntCoeff[NBR_FREQUENCIES-1]) >> 13) - (int32)Q_right[NBR_FREQUENCIES-1][1];
-        phi_2ndHarmonic[1] = (int32)((int32)Q_right[NBR_FREQUENCIES-1][0] * (int32)AntSINECoeff[1]) >> 13;
+            (int32)pBatchSet->cos_coeff[NBR_FREQUENCIES-1]) >> 13) - (int32)Q_right[NBR_FREQUENCIES-1][1];
+        phi_2ndHarmonic[1] = (int32)((int32)Q_right[NBR_FREQUENCIES-1][0] * (int32)pBatchSet->sin_coeff[1]) >> 13;
     
-        phi_1stFreq[0] = ((int32)((int32)Q_right[0][0] * (int32)AntCoeff[0]) >> 13) - (int32)Q_right[0][1];
-        phi_1stFreq[1] = (int32)((int32)Q_right[0][0] * (int32)AntSINECoeff[0]) >> 13;
+        phi_1stFreq[0] = ((int32)((int32)Q_right[0][0] * (int32)pBatchSet->cos_coeff[0]) >> 13) - (int32)Q_right[0][1];
+        phi_1stFreq[1] = (int32)((int32)Q_right[0][0] * (int32)pBatchSet->sin_coeff[0]) >> 13;
     
         phi_double_1stFreq[0] = ((int32)(phi_1stFreq[0] * phi_1stFreq[0]) -
             (int32)(phi_1stFreq[1] * phi_1stFreq[1])) >> 13;
@@ -494,6 +709,8 @@ void ANT_FinalStep(T_wireGuid_t *pWireGuidData)
     
         normalize_phi = (Uint32)(AntResultRightFinal[0] * AntResultRightFinal[0] * AntResultRightFinal[0] *
             ANT_Sqrt(8192UL) / 100UL);
+        if (normalize_phi == 0UL)
+            normalize_phi = 1UL; // Amplitude below 2, no division by zero
 
         // Relative Phase Calculation, Scaled Linear Factor of 100
         // Normalized Cosine
@@ -572,10 +789,17 @@ void ANT_Step(int16 ADValueLeft, int16 ADValueRight)
 
 	// counter
 	Uint8 i;
+	// Coefficients and gains of the running batch
+	const T_ant_coeff_set_t *pSet = &AntCoeffSet[AntCoeffActive];
 
     // Take sample for left and right, and apply Hanning window
     ValueL = (int16)(((int32)ADValueLeft * (int32)Hanning[ANT_k]) >> 15) * (int16)AntRelPhaseLeftSign; // 15 bits (32768) hanning window scaled to 2^15
     ValueR = (int16)(((int32)ADValueRight * (int32)Hanning[ANT_k]) >> 15) * (int16)AntRelPhaseRightSign; // 15 bits 
+
+	#if SAMPLE_CAPTURE
+	if (Capture_hook & CAPTURE_HOOK_STEP)
+		Capture_step(ADValueLeft, ADValueRight, ValueL, ValueR);
+	#endif
 	
 	/// For all Frequencies (Test Freq, Input Freqs, 2nd Harmonic)
 	for (i = 0U; i < NBR_FREQUENCIES; ++i)
@@ -593,48 +817,55 @@ void ANT_Step(int16 ADValueLeft, int16 ADValueRight)
 			{
 				// Apply Gain from Parameters
 				// shift by 13 bits left (2^13 = 8192) -> normalization of the frequency gain
-				SampleL = ((int32)ValueL * (int32)AntAmpGainLeft[0])  >> 13;
-				SampleR = ((int32)ValueR * (int32)AntAmpGainRight[0]) >> 13;
+				SampleL = ((int32)ValueL * (int32)pSet->gain_left[0])  >> 13;
+				SampleR = ((int32)ValueR * (int32)pSet->gain_right[0]) >> 13;
 			}
 			#endif
 		else
 		{
 			// Apply Gain from Parameters
 			// shift by 13 bits left (2^13 = 8192) -> normalization of the frequency gain
-			SampleL = ((int32)ValueL * (int32)AntAmpGainLeft[i-1])  >> 13;
-			SampleR = ((int32)ValueR * (int32)AntAmpGainRight[i-1]) >> 13;
+			SampleL = ((int32)ValueL * (int32)pSet->gain_left[i-1])  >> 13;
+			SampleR = ((int32)ValueR * (int32)pSet->gain_right[i-1]) >> 13;
 		}
 		#else // Case No Pilot Tone
 		if (i < (NBR_FREQUENCIES-1))
 		{
 			// Apply Gain from Parameters
 			// shift by 13 bits left (2^13 = 8192) -> normalization of the frequency gain
-			SampleL = ((int32)ValueL * (int32)AntAmpGainLeft[i])  >> 13;
-			SampleR = ((int32)ValueR * (int32)AntAmpGainRight[i]) >> 13;
+			SampleL = ((int32)ValueL * (int32)pSet->gain_left[i])  >> 13;
+			SampleR = ((int32)ValueR * (int32)pSet->gain_right[i]) >> 13;
 		}
 			#if SECOND_HARMONIC_FIRST_FREQUENCY
 			else
 			{
 				// Apply Gain from Parameters
 				// shift by 13 bits left (2^13 = 8192) -> normalization of the frequency gain
-				SampleL = ((int32)ValueL * (int32)AntAmpGainLeft[0])  >> 13;
-				SampleR = ((int32)ValueR * (int32)AntAmpGainRight[0]) >> 13;
+				SampleL = ((int32)ValueL * (int32)pSet->gain_left[0])  >> 13;
+				SampleR = ((int32)ValueR * (int32)pSet->gain_right[0]) >> 13;
 			}
 			#endif
 		#endif // End Pilot Tone 
 		
 		// Goertzel for left channel
-		TempCalc	= (((int32)AntCoeff[i] * (int32)AntQL[i][1]) >> 12) - (int32)AntQL[i][0] + SampleL; // 12 bits (4096)
+		TempCalc	= (((int32)pSet->cos_coeff[i] * (int32)AntQL[i][1]) >> 12) - (int32)AntQL[i][0] + SampleL; // 12 bits (4096)
 		AntQL[i][0] = AntQL[i][1];
 		AntQL[i][1] = (int16) TempCalc;
 		// Goertzel for right channel
-		TempCalc = (((int32)AntCoeff[i] * (int32)AntQR[i][1]) >> 12) - (int32)AntQR[i][0] + SampleR; // 12 bits
+		TempCalc = (((int32)pSet->cos_coeff[i] * (int32)AntQR[i][1]) >> 12) - (int32)AntQR[i][0] + SampleR; // 12 bits
 		AntQR[i][0] = AntQR[i][1];
 		AntQR[i][1] = (int16) TempCalc;
 	}
 	
     // Increase Sample counter
     ++ANT_k;
+	// Timestamp of the window, read by ANT_FinalStep; signal the completed window
+	if (ANT_k >= ANT_k_max)
+	{
+		AntWindowEnd = ADC_sampleCounter;
+		ANT_BatchReady = true;
+		Sched_signal(SCHED_TASK_BATCH);
+	}
 
 	/* End timer */
 	#ifdef FUNCTION_INTERNAL
@@ -684,14 +915,17 @@ void ANT_Set_Freqs(Uint8 *content, T_wg_coefficient_t *frequencies, E_wg_coeff_s
 	// Index of the Frequency Coefficients, takes into account presence 
 	// of Test Frequency/Pilot Tone (PWM)
 	Uint8 freq_idx;
+	// New coefficients are written to the staging set, activated at the next batch boundary
+	T_ant_coeff_set_t *pStaging = ant_open_staging();
+	// At least one coefficient was changed
+	sbool updated = false;
 	
 	// Reset Freq. values and Coeffs.
 	if	((content[0] & content[1]) == 0xFF)
 	// Bitwise comparison: All 1s then 0xFF
 	// If at least one bit is 0, then result != 0xFF
 	{
-		Uint32 read_address;
-		Uint16 read_data;
+		Uint16 stored_freqs[NBR_INPUT_FREQ];
 	
 		for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 		{
@@ -701,53 +935,32 @@ void ANT_Set_Freqs(Uint8 *content, T_wg_coefficient_t *frequencies, E_wg_coeff_s
 			freq_idx = i;
 			#endif
 			
-			// Reset i-th Freq. value to default value
-			frequencies[i].freq_value = Input_Freq_Table[i];
-			
-			double freq_ratio = (double)frequencies[i].freq_value / (double)ADC_SAMPLING_FREQ_Hz ;
+			// Reset i-th Freq. value and coefficients to default value
+			ant_set_default_freq(frequencies, i);
 			
 			#if SECOND_HARMONIC_FIRST_FREQUENCY
 			if (i == 0U)
 			{
-				// Calculate cos, sin coeffs. of 2nd Harmonic and sin coeff. of 1st Freq.
-				AntCoeff[NBR_FREQUENCIES-1] = (int16)(cos(2.0 * math_2pi * freq_ratio) * 8192.0);
-				AntSINECoeff[0] = (int16)(sin(math_2pi * freq_ratio) * 8192.0);
-				AntSINECoeff[1] = (int16)(sin(2.0 * math_2pi * freq_ratio) * 8192.0);
-				// Copy coeffs. to data structure and update status of 2nd Harm to default.
-				frequencies[i].sin_coefficient = AntSINECoeff[0];
-				frequencies[NBR_INPUT_FREQ].freq_value = 2 * frequencies[i].freq_value;
-				frequencies[NBR_INPUT_FREQ].cos_coefficient = AntCoeff[NBR_FREQUENCIES-1];
-				frequencies[NBR_INPUT_FREQ].sin_coefficient = AntSINECoeff[1];
-				frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_DEFAULT;
+				// Default cos, sin coeffs. of 2nd Harmonic and sin coeff. of 1st Freq.
+				pStaging->cos_coeff[NBR_FREQUENCIES-1] = frequencies[NBR_INPUT_FREQ].cos_coefficient;
+				pStaging->sin_coeff[0] = frequencies[i].sin_coefficient;
+				pStaging->sin_coeff[1] = frequencies[NBR_INPUT_FREQ].sin_coefficient;
 			}
 			#endif
 
-			// Calculate default coefficient for the i-th Freq.
-			AntCoeff[freq_idx] = (int16)(cos(math_2pi * freq_ratio) * 8192.0);
-			// Copy coeff. to data structure and update status of i-th Freq to default.
-			frequencies[i].cos_coefficient =  AntCoeff[freq_idx];
-			frequencies[i].coeff_status = WG_COEFF_STATUS_DEFAULT;
-		}
-		// Set overall coefficient status to default.
-		*status = WG_COEFF_STATUS_DEFAULT;
-		
-		// Check whether any user-defined Freq. vales are stored in EEPROM.
-		read_address = eeprom_get_read_write_address(EEPROM_ANT_COEFF_DATA_WRITTEN);
-		read_data = eeprom_read_word(read_address);
-		if (read_data == WG_EEPROM_COEFFS_STORED)
-		{
-			// Delete stored flag, so that default Freq. values are loaded at system initialization.
-			eeprom_write_word(read_address, 0xFFFF);
-			for (i = 0U; i < NBR_INPUT_FREQ; ++i)
-			{
-				read_address = eeprom_get_read_write_address(i+EEPROM_ANT_COEFF_FREQ1);
-				read_data = eeprom_read_word(read_address);
-				// Delete any user-defined Frequency value.
-				if (read_data != 0xFFFFU)
-					eeprom_write_word(read_address, 0xFFFF);
-			}
+			// Default coefficient for the i-th Freq.
+			pStaging->cos_coeff[freq_idx] = frequencies[i].cos_coefficient;
 		}
+		// Set overall coefficient status to default. When user-defined Freq. values 
+		// are stored in EEPROM, a record w/o Freq. values is stored by ANT_Store_Freqs,
+		// so that default Freq. values are loaded at system initialization; the status
+		// is default once written, failed when the record cannot be written.
+		if (ant_read_stored_freqs(stored_freqs))
+			*status = WG_COEFF_STATUS_UPDATED;
+		else
+			*status = WG_COEFF_STATUS_DEFAULT;
 		
+		AntCoeffPending = true;
 		return;
 	}
 	
@@ -767,6 +980,7 @@ void ANT_Set_Freqs(Uint8 *content, T_wg_coefficient_t *frequencies, E_wg_coeff_s
 		
 		// Set overall status to updated, when at least one Freq. is to be updated 
 		*status = WG_COEFF_STATUS_UPDATED;
+		updated = true;
 		
 		// Copy new value of i-th Freq. to data structure
 		frequencies[i].freq_value = (Uint16)content[(2*i)+1] + (((Uint16)content[2*i]) << 8);
@@ -777,190 +991,124 @@ void ANT_Set_Freqs(Uint8 *content, T_wg_coefficient_t *frequencies, E_wg_coeff_s
 		if (i == 0U)
 		{
 			// Calculate cos, sin coeffs. of 2nd Harmonic and sin coeff. of 1st Freq. 
-			AntCoeff[NBR_FREQUENCIES-1] = (int16)(cos(2.0 * math_2pi * freq_ratio) * 8192.0);
-			AntSINECoeff[0] = (int16)(sin(math_2pi * freq_ratio) * 8192.0);
-			AntSINECoeff[1] = (int16)(sin(2.0 * math_2pi * freq_ratio) * 8192.0);
+			pStaging->cos_coeff[NBR_FREQUENCIES-1] = (int16)(cos(2.0 * math_2pi * freq_ratio) * 8192.0);
+			pStaging->sin_coeff[0] = (int16)(sin(math_2pi * freq_ratio) * 8192.0);
+			pStaging->sin_coeff[1] = (int16)(sin(2.0 * math_2pi * freq_ratio) * 8192.0);
 			// Copy coeffs. to data structure, calculate new Freq. and update status of 2nd Harm.
-			frequencies[i].sin_coefficient = AntSINECoeff[0];
+			frequencies[i].sin_coefficient = pStaging->sin_coeff[0];
 			frequencies[NBR_INPUT_FREQ].freq_value = 2 * frequencies[i].freq_value;
-			frequencies[NBR_INPUT_FREQ].cos_coefficient = AntCoeff[NBR_FREQUENCIES-1];
-			frequencies[NBR_INPUT_FREQ].sin_coefficient = AntSINECoeff[1];
+			frequencies[NBR_INPUT_FREQ].cos_coefficient = pStaging->cos_coeff[NBR_FREQUENCIES-1];
+			frequencies[NBR_INPUT_FREQ].sin_coefficient = pStaging->sin_coeff[1];
 			frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_UPDATED;
 		}
 		#endif
 		
 		// Calculate new coefficient for the i-th Freq.
-		AntCoeff[freq_idx] = (int16)(cos(math_2pi * freq_ratio) * 8192.0);
+		pStaging->cos_coeff[freq_idx] = (int16)(cos(math_2pi * freq_ratio) * 8192.0);
 		// Copy coeff. to data structure and update status of i-th Freq.
-		frequencies[i].cos_coefficient = AntCoeff[freq_idx];
+		frequencies[i].cos_coefficient = pStaging->cos_coeff[freq_idx];
 		frequencies[i].coeff_status = WG_COEFF_STATUS_UPDATED;
 	}		
+	if (updated)
+		AntCoeffPending = true;
 		
 	return;
 }
 
 //*****************************************************************************
-//! This function stores the updated Frequency values to the EEPROM.
+//! This function writes the Frequency values to the EEPROM as one record. The
+//! Freq. and overall status are updated by the record callback, once written.
+//! Called periodically: while a record is being stored, it is retried later.
 //! 
 void ANT_Store_Freqs(T_wg_coefficient_t *frequencies, E_wg_coeff_status_t *status)
 {
 	Uint8 		i;
-	Uint32   	write_address;
-	sbool	check_write;
-	// Counter of the number of updated Freq. values
-	Uint8 count_updated = 0U;
-	// Counter of the number of failed writings
-	Uint8 count_failed = 0U;
-
-	if (*status != WG_COEFF_STATUS_UPDATED)
+	Uint16		freq_values[NBR_INPUT_FREQ];
+
+	if ((*status != WG_COEFF_STATUS_UPDATED) || AntStoreBusy)
 		return;
-	
+
+	// All Freq. values default (reset): the status is default once written
+	AntStoreDone = WG_COEFF_STATUS_DEFAULT;
 	for(i = 0U; i < NBR_INPUT_FREQ; ++i)	
 	{
-		// Check if i-th Freq. was updated w/ new value
-		if (frequencies[i].coeff_status != WG_COEFF_STATUS_UPDATED)
-			continue;
-		
-		++count_updated;
-		
-		write_address = eeprom_get_read_write_address(i+EEPROM_ANT_COEFF_FREQ1);
-		check_write = eeprom_write_word(write_address, frequencies[i].freq_value);
-		/* Check success/failure of storing process and update 
-			i-th freq. status accordingly */
-		if (check_write)
-		{
-			frequencies[i].coeff_status = WG_COEFF_STATUS_USER;
-			#if SECOND_HARMONIC_FIRST_FREQUENCY
-			if (i == 0U)
-				frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_USER;
-			#endif
-		}
+		// Default Freq. values are not stored
+		if (frequencies[i].coeff_status == WG_COEFF_STATUS_DEFAULT)
+			freq_values[i] = 0xFFFFU;
 		else
 		{
-			++count_failed;
-			frequencies[i].coeff_status = WG_COEFF_STATUS_FAILED;
-			#if SECOND_HARMONIC_FIRST_FREQUENCY
-			if (i == 0U)
-				frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_USER;
-			#endif
+			freq_values[i] = frequencies[i].freq_value;
+			AntStoreDone = WG_COEFF_STATUS_USER;
 		}
 	}
-	write_address = eeprom_get_read_write_address(EEPROM_ANT_COEFF_DATA_WRITTEN);
-	// Check if storing updated Freqs. to EEPROM failed
-	if ((count_failed != 0U) && (count_failed == count_updated))
-	{
-		eeprom_write_word(write_address, 0xFFFF);
-		*status = WG_COEFF_STATUS_FAILED;
-		return;
-	}
-	check_write = eeprom_write_word(write_address, WG_EEPROM_COEFFS_STORED);
-	// Check if storing Successful Update value to EEPROM failed
-	if (!check_write)
-	{
-		*status = WG_COEFF_STATUS_FAILED;
-		return;
-	}
-	*status = WG_COEFF_STATUS_USER;
+
+	AntStoreFrequencies	= frequencies;
+	AntStoreStatus		= status;
+	AntStoreBusy		= true;
+	if (!eeprom_record_store(EEPROM_RECORD_FREQS, freq_values, NBR_INPUT_FREQ, ant_store_callback, 0U))
+		ant_store_callback(0U, false);
 	
 	return;
 }
 
 //*****************************************************************************
-//! This function retrieves the Frequency values from EEPROM.
+//! Returns true while updated Frequency values are being stored.
+//! 
+sbool ANT_Store_Busy(void)
+{
+	return AntStoreBusy;
+}
+
+//*****************************************************************************
+//! This function retrieves the user-defined Frequency values from EEPROM and 
+//! stages their coefficients. It is called once after start-up, the default
+//! coefficients are used until then.
 //! 
 /* FREQUENCY COSINE COEFFICIENTS FOR GOERTZEL:
-	HEX(8192d x cos(2.pi.Ft/Fs)),
+	HEX(8192d x cos(2.pi.Ft/Fs)), see host/coeff/coeff_gen,
 	Fs=15 kHz, Ft=5 kHz[0](Test Freq. enabled), 2790 Hz[1], 
 	3209 Hz[2], 3627 Hz[3], 4046 Hz[4], 2*2790=5580 Hz[5] (2nd Harmonic)
 	COEFFS: 	DEC: -4096 HEX: 0xF000	[0] (Test Freq.), 
 					DEC:  3206 HEX: 0x0C86	[1], 
-					DEC:  1842 HEX: 0x0732	[2], 
+					DEC:  1840 HEX: 0x0730	[2], 
 					DEC:    421 HEX: 0x01A5	[3],
-					DEC: -1012 HEX: 0xFC0C	[4], 
+					DEC: -1013 HEX: 0xFC0B	[4], 
 					DEC: -5682 HEX: 0xE9CE	[5] (2nd Harmonic).
 */ 
 /*	FREQUENCY SINE COEFFS FOR 1ST FREQ AND ITS 2ND HARMONIC:
 	HEX(8192d x sin(2.pi.Ft/Fs)),
 	Fs=15 kHz, Ft=2790 Hz[0] (1st Freq.), Ft = 2*2790=5580 Hz[1] (2nd Harmonic)
-	COEFFS: 	DEC: 7539 HEX: 0x1D73	[0] (1st Freq.),
-					DEC: 5901 HEX: 0x170D	[1] (2nd Freq.)
+	COEFFS: 	DEC: 7538 HEX: 0x1D72	[0] (1st Freq.),
+					DEC: 5900 HEX: 0x170C	[1] (2nd Freq.)
 */
 void ANT_Load_Freqs(T_wg_coefficient_t *frequencies, E_wg_coeff_status_t *status		)
 {
 	Uint8 i;
-	Uint32 read_address;
-	Uint16 read_data;
-	// Index of local Freq. Coeffs., takes into account presence 
-	// of Test Frequency/Pilot Tone (PWM)
-	Uint8 freq_idx;
-	
-	read_address = eeprom_get_read_write_address(EEPROM_ANT_COEFF_DATA_WRITTEN);
-	read_data = eeprom_read_word(read_address);
+	Uint16 stored_freqs[NBR_INPUT_FREQ];
+	// Counter of the number of failed loadings/invalid Freq. values. 
+	Uint8 load_fail = 0U;
 	
+	// No Freq. values are stored in EEPROM, default Freq. values remain in use.
+	if (!ant_read_stored_freqs(stored_freqs))
+		return;
+
 	// Freq. values are present in EEPROM, 
-	if (read_data == WG_EEPROM_COEFFS_STORED)
+	*status = WG_COEFF_STATUS_USER;
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 	{
-		// Counter of the number of failed loadings/invalid Freq. values. 
-		Uint8 load_fail = 0U;
-		*status = WG_COEFF_STATUS_USER;
-		for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+		if (stored_freqs[i] == 0xFFFFU)
 		{
-			read_address = eeprom_get_read_write_address(i+EEPROM_ANT_COEFF_FREQ1);
-			frequencies[i].freq_value = eeprom_read_word(read_address);
-			
-			if (frequencies[i].freq_value == 0xFFFFU)
-			{
-				/* Use default Freq. value if no stored value present in EEPROM address or loading failed */
-				frequencies[i].freq_value = Input_Freq_Table[i];
-				double freq_ratio = (double)frequencies[i].freq_value / (double)ADC_SAMPLING_FREQ_Hz;
-				frequencies[i].cos_coefficient = (int16)(cos(math_2pi * freq_ratio) * 8192.0);
-				frequencies[i].sin_coefficient = 0;
-				frequencies[i].coeff_status = WG_COEFF_STATUS_DEFAULT;
-				#if SECOND_HARMONIC_FIRST_FREQUENCY
-				if (i == 0U)
-				{
-					frequencies[i].sin_coefficient = (int16)(sin(math_2pi * freq_ratio) * 8192.0);
-					frequencies[NBR_INPUT_FREQ].freq_value = 2 * frequencies[i].freq_value;
-					frequencies[NBR_INPUT_FREQ].cos_coefficient = (int16)(cos(2.0 * math_2pi * freq_ratio) * 8192.0);
-					frequencies[NBR_INPUT_FREQ].sin_coefficient = (int16)(sin(2.0 * math_2pi * freq_ratio) * 8192.0);
-					frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_DEFAULT;
-				}
-				#endif
-				++load_fail;
-			}
-			else
-			{
-				double freq_ratio = (double)frequencies[i].freq_value / (double)ADC_SAMPLING_FREQ_Hz;
-				frequencies[i].cos_coefficient = (int16)(cos(math_2pi * freq_ratio) * 8192.0);
-				frequencies[i].sin_coefficient = 0;
-				frequencies[i].coeff_status = WG_COEFF_STATUS_USER;
-				#if SECOND_HARMONIC_FIRST_FREQUENCY
-				if (i == 0U)
-				{
-					frequencies[i].sin_coefficient = (int16)(sin(math_2pi * freq_ratio) * 8192.0);
-					frequencies[NBR_INPUT_FREQ].freq_value = 2 * frequencies[i].freq_value;
-					frequencies[NBR_INPUT_FREQ].cos_coefficient = (int16)(cos(2.0 * math_2pi * freq_ratio) * 8192.0);
-					frequencies[NBR_INPUT_FREQ].sin_coefficient = (int16)(sin(2.0 * math_2pi * freq_ratio) * 8192.0);
-					frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_USER;
-				}
-				#endif
-			}
+			/* Use default Freq. value if no stored value present in EEPROM address or loading failed */
+			ant_set_default_freq(frequencies, i);
+			++load_fail;
 		}
-		// Set Coeff. status to Default, if all loadings failed/no Freq. values were present in EEPROM		
-		if (load_fail == NBR_INPUT_FREQ)
-			*status = WG_COEFF_STATUS_DEFAULT;
-	}
-	// No Freq. values are stored in EEPROM, use default Freq. values.
-	else
-	{
-		*status = WG_COEFF_STATUS_DEFAULT;
-		for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+		else
 		{
-			frequencies[i].freq_value = Input_Freq_Table[i];
+			frequencies[i].freq_value = stored_freqs[i];
 			double freq_ratio = (double)frequencies[i].freq_value / (double)ADC_SAMPLING_FREQ_Hz;
 			frequencies[i].cos_coefficient = (int16)(cos(math_2pi * freq_ratio) * 8192.0);
 			frequencies[i].sin_coefficient = 0;
-			frequencies[i].coeff_status = WG_COEFF_STATUS_DEFAULT;
+			frequencies[i].coeff_status = WG_COEFF_STATUS_USER;
 			#if SECOND_HARMONIC_FIRST_FREQUENCY
 			if (i == 0U)
 			{
@@ -968,31 +1116,56 @@ void ANT_Load_Freqs(T_wg_coefficient_t *frequencies, E_wg_coeff_status_t *status
 				frequencies[NBR_INPUT_FREQ].freq_value = 2 * frequencies[i].freq_value;
 				frequencies[NBR_INPUT_FREQ].cos_coefficient = (int16)(cos(2.0 * math_2pi * freq_ratio) * 8192.0);
 				frequencies[NBR_INPUT_FREQ].sin_coefficient = (int16)(sin(2.0 * math_2pi * freq_ratio) * 8192.0);
-				frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_DEFAULT;
+				frequencies[NBR_INPUT_FREQ].coeff_status = WG_COEFF_STATUS_USER;
 			}
 			#endif
 		}
 	}
-	//	Copy loaded Frequency Coefficients to local variables
+	// Set Coeff. status to Default, if all loadings failed/no Freq. values were present in EEPROM		
+	if (load_fail == NBR_INPUT_FREQ)
+		*status = WG_COEFF_STATUS_DEFAULT;
+
+	//	Copy loaded Frequency Coefficients to the staging set, active at the next batch
+	ant_stage_freqs(frequencies);
+	
+	return;
+}
+
+//*****************************************************************************
+//! This function stages new calibration gains. They are applied at the next batch
+//! boundary, so that a batch is never computed with mixed gains.
+void ANT_Stage_Gains(const Uint16 *gain_left, const Uint16 *gain_right)
+{
+	Uint8 i;
+	T_ant_coeff_set_t *pStaging = ant_open_staging();
+
 	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 	{
-		#if BIT_WIREGUID_ACTIVE
-		freq_idx = i + 1;
-		#else
-		freq_idx = i;
-		#endif
-
-		AntCoeff[freq_idx] = frequencies[i].cos_coefficient;
+		pStaging->gain_left[i] = (int16)gain_left[i];
+		pStaging->gain_right[i] = (int16)gain_right[i];
 	}
-	#if BIT_WIREGUID_ACTIVE
-	AntCoeff[0] = (int16)(cos(math_2pi * ((double)TEST_FREQUENCY_HZ /
-										(double)ADC_SAMPLING_FREQ_Hz) ) * 8192.0);
-	#endif
-	#if SECOND_HARMONIC_FIRST_FREQUENCY
-	AntSINECoeff[0] = frequencies[0].sin_coefficient;
-	AntCoeff[NBR_FREQUENCIES-1] = frequencies[NBR_INPUT_FREQ].cos_coefficient;
-	AntSINECoeff[1] = frequencies[NBR_INPUT_FREQ].sin_coefficient;
-	#endif
-	
+	AntCoeffPending = true;
+
+	return;
+}
+
+//*****************************************************************************
+//! This function enables the start of the windows at a received SYNC. When
+//! disabled (SYNC lost), a waiting window is started at once.
+void ANT_Sync_Window(sbool enable)
+{
+	AntSyncWindow = enable;
+	if (!enable)
+		ANT_WaitSync = false;
+
+	return;
+}
+
+//*****************************************************************************
+//! This function starts a waiting window, called by the CAN interrupt at a SYNC.
+void ANT_Sync_Start(void)
+{
+	ANT_WaitSync = false;
+
 	return;
 }
@@ -25,3 +25,30 @@ void Guid_process(T_guidData_t  *guidanceData)
 
 	return;
 }
+
+void Guid_bit(T_guidData_t  *guidanceData)
+{
+	#if GUIDANCE_WIRE
+	WireGuid_bit(&(guidanceData->wireGuidData));
+	#endif
+
+	return;
+}
+
+void Guid_store(T_guidData_t  *guidanceData)
+{
+	#if GUIDANCE_WIRE
+	WireGuid_store(&(guidanceData->wireGuidData));
+	#endif
+
+	return;
+}
+
+sbool Guid_batch(T_guidData_t  *guidanceData)
+{
+	#if GUIDANCE_WIRE
+	return WireGuid_batch(&(guidanceData->wireGuidData));
+	#else
+	return false;
+	#endif
+}
@@ -17,15 +17,11 @@
 static const Uint8 __attribute__((space(auto_psv))) WG_SYNC_WDW_SZ = (Uint8)HN_WDW_SZ;
 // Shifting Length of the Hanning Window for synchronization procedure
 static const Uint8 __attribute__((space(auto_psv))) WG_SYNC_WDW_VAR = (Uint8)HN_WDW_VAR;
-// Component Noise
-static const int16 __attribute__((space(auto_psv))) WG_QAM_COMP_NOISE = 5;
 // 
 static const int16 __attribute__((space(auto_psv))) WG_QAM_COMP_MAX = 75;
 static const int16 __attribute__((space(auto_psv))) WG_QAM_COMP_MIN	= 25;
 static const int16 __attribute__((space(auto_psv))) WG_QAM_COMP_MAX_NEG = -75;
 static const int16 __attribute__((space(auto_psv))) WG_QAM_COMP_MIN_NEG = -25;
-// Square Amplitude Noise
-static const Uint16 __attribute__((space(auto_psv))) WG_QAM_NOISE	= 50U;
 // Max Square Amplitude: (+/-75,+/-75) constellations. 2*(75^2)
 static const Uint16 __attribute__((space(auto_psv))) WG_QAM_MAX_VAL = 11250U;
 // Max Square Amplitude with Noise: (+/-80,+/-80) constellations. WG_QAM_MAX_VAL + 75*20 + WG_QAM_NOISE
@@ -34,15 +30,29 @@ static const Uint16 __attribute__((space(auto_psv))) WG_QAM_MAX_VAL_NOISE = 1280
 static const Uint16 __attribute__((space(auto_psv))) WG_QAM_MID_VAL = 5000U;
 #endif
 //
-static const Uint32 __attribute__((space(auto_psv))) DEVIATION_SCALE = 20000UL;
-static const int16 __attribute__((space(auto_psv))) DEVIATION_RNG_MAX = 5000;
-static const int16 __attribute__((space(auto_psv))) DEVIATION_RNG_MIN = -5000;
-static const Uint32 __attribute__((space(auto_psv))) AMPLITUDE_MIN = 26UL;
-//
-static const int16 __attribute__((space(auto_psv))) 
-BIT_MAX_REFVOLT_SHORT_CIRCUIT = (int16)BIT_ANT_MAX_REFVOLT_SHORT_CIRCUIT;
-static const int16 __attribute__((space(auto_psv))) BIT_MAX_REFVOLT = (int16)BIT_ANT_MAX_REFVOLT;
-static const int16 __attribute__((space(auto_psv))) BIT_MIN_REFVOLT = (int16)BIT_ANT_MIN_REFVOLT;
+/* Default runtime parameters, see T_wg_param_t */
+static const T_wg_param_t __attribute__((space(auto_psv)))
+WgParamDefault = {
+	20000U,		// deviation_scale
+	5000U,		// deviation_range
+	26U,		// amplitude_min
+	5,			// qam_comp_noise: component noise
+	50U,		// qam_noise: square amplitude noise
+	WG_DELAY_CALIBRATION_COUNTER,	// calib_delay
+	WG_MIN_CALIBRATION_TIME,		// calib_min_time
+	WG_MAX_CALIBRATION_TIME,		// calib_max_time
+	WG_MIN_CALIBRATION_PARAM,		// calib_min_param
+	(int16)BIT_ANT_MAX_REFVOLT_SHORT_CIRCUIT,	// bit_max_refvolt_short_circuit
+	(int16)BIT_ANT_MIN_REFVOLT,		// bit_min_refvolt
+	(int16)BIT_ANT_MAX_REFVOLT		// bit_max_refvolt
+};
+
+#if DEVIATION_LUT && ((2 + WG_LUT_POINTS) > EEPROM_RECORD_PAYLOAD_WORDS)
+	#error "Deviation lookup table does not fit into an EEPROM record! Reduce WG_LUT_POINTS."
+#endif
+
+// Global variables
+T_wg_param_t	gWireGuidParam;
 
 //*****************************************************************************************************************************************
 // Static functions
@@ -63,22 +73,22 @@ static void wireGuid_antennaGood(T_wireGuid_t  *pWireGuidData)
 	pWireGuidData->status_right_antenna.antenna_cable_ok = 1;
 	pWireGuidData->status_right_antenna.no_short_circuit = 1;
 
-	if (refVoltLeft < BIT_MAX_REFVOLT_SHORT_CIRCUIT)
+	if (refVoltLeft < gWireGuidParam.bit_max_refvolt_short_circuit)
 	{
 		pWireGuidData->status_left_antenna.no_short_circuit = 0;
 	}
-	else if ( (refVoltLeft <  BIT_MIN_REFVOLT) ||
-				(refVoltLeft >  BIT_MAX_REFVOLT) )
+	else if ( (refVoltLeft <  gWireGuidParam.bit_min_refvolt) ||
+				(refVoltLeft >  gWireGuidParam.bit_max_refvolt) )
 	{
 		pWireGuidData->status_left_antenna.antenna_cable_ok = 0;
 	}
 
-	if (refVoltRight <  BIT_MAX_REFVOLT_SHORT_CIRCUIT)
+	if (refVoltRight <  gWireGuidParam.bit_max_refvolt_short_circuit)
 	{
 		pWireGuidData->status_right_antenna.no_short_circuit = 0;
 	}
-	else if ( (refVoltRight <  BIT_MIN_REFVOLT) ||
-				(refVoltRight >  BIT_MAX_REFVOLT) )
+	else if ( (refVoltRight <  gWireGuidParam.bit_min_refvolt) ||
+				(refVoltRight >  gWireGuidParam.bit_max_refvolt) )
 	{
 		pWireGuidData->status_right_antenna.antenna_cable_ok = 0;
 	}
@@ -109,6 +119,7 @@ static void wireGuid_set_deviation_invalid(T_wireGuid_t  *pWireGuidData)
 	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 	{
 		pWireGuidData->deviation_m2ecm[i] = WG_DEVIATION_INVALID;
+		pWireGuidData->deviation_fine[i] = WG_DEVIATION_INVALID;
 	}
 	#if SECOND_HARMONIC_FIRST_FREQUENCY
 	pWireGuidData->rel_phaseLeft[0] = WG_REL_PHASE_INVALID;
@@ -125,6 +136,271 @@ static void wireGuid_set_deviation_invalid(T_wireGuid_t  *pWireGuidData)
 	return;
 }
 
+//*****************************************************************************************************************************************
+/* Deviation of frequency i from valid amplitudes, and the same deviation with 
+	WG_DEVIATION_FINE_SCALE times the resolution */
+static void wireGuid_compute_deviation(T_wireGuid_t  *pWireGuidData, Uint8 i)
+{
+	int32	fine;
+
+	// Range: ]-20000 ; 20000[, scaled in 200cm
+	ANT_Deviation[i] = (int16)((Uint32)gWireGuidParam.deviation_scale / pWireGuidData->amplitudeLeft[i]) - 
+								(int16)((Uint32)gWireGuidParam.deviation_scale / pWireGuidData->amplitudeRight[i]);
+	// CHECK RANGE -5000 ... 5000
+	if (ANT_Deviation[i] >  (int16)gWireGuidParam.deviation_range)
+				ANT_Deviation[i] =  (int16)gWireGuidParam.deviation_range;
+	else if (ANT_Deviation[i] < (-(int16)gWireGuidParam.deviation_range))
+				ANT_Deviation[i] = (-(int16)gWireGuidParam.deviation_range);
+	pWireGuidData->deviation_m2ecm[i] = ANT_Deviation[i];
+
+	// Same range, WG_DEVIATION_FINE_SCALE times the resolution
+	fine = (int32)(((Uint32)gWireGuidParam.deviation_scale * WG_DEVIATION_FINE_SCALE) / pWireGuidData->amplitudeLeft[i]) - 
+			(int32)(((Uint32)gWireGuidParam.deviation_scale * WG_DEVIATION_FINE_SCALE) / pWireGuidData->amplitudeRight[i]);
+	if (fine > ((int32)(int16)gWireGuidParam.deviation_range * WG_DEVIATION_FINE_SCALE))
+		fine = (int32)(int16)gWireGuidParam.deviation_range * WG_DEVIATION_FINE_SCALE;
+	else if (fine < ((int32)(-(int16)gWireGuidParam.deviation_range) * WG_DEVIATION_FINE_SCALE))
+		fine = (int32)(-(int16)gWireGuidParam.deviation_range) * WG_DEVIATION_FINE_SCALE;
+	pWireGuidData->deviation_fine[i] = (int16)fine;
+
+	return;
+}
+
+#if DEVIATION_LUT
+//*****************************************************************************************************************************************
+/* Normalised amplitude difference (L-R)/(L+R) of frequency i, Q15. The 
+	amplitudes are valid, so their sum is not 0. */
+static int16 wireGuid_norm_diff(const T_wireGuid_t  *pWireGuidData, Uint8 i)
+{
+	int32	diff;
+
+	diff = (((int32)pWireGuidData->amplitudeLeft[i] - (int32)pWireGuidData->amplitudeRight[i]) << 15) /
+			((int32)pWireGuidData->amplitudeLeft[i] + (int32)pWireGuidData->amplitudeRight[i]);
+	// Right amplitude 0
+	if (diff > 32767L)
+		diff = 32767L;
+
+	return (int16)diff;
+}
+
+//*****************************************************************************************************************************************
+/* Deviation of frequency i from the lookup table. One division for the normalised
+	difference instead of the two of wireGuid_compute_deviation, the table is
+	indexed with a multiplication. */
+static void wireGuid_lut_deviation(T_wireGuid_t  *pWireGuidData, Uint8 i)
+{
+	const T_wg_lut_t	*pLut = &(pWireGuidData->lut);
+	int16				diff = wireGuid_norm_diff(pWireGuidData, i);
+	int32				range = (int32)(int16)gWireGuidParam.deviation_range * WG_DEVIATION_FINE_SCALE;
+	int32				fine;
+
+	if (diff <= -pLut->span)
+		fine = pLut->point[0];
+	else if (diff >= pLut->span)
+		fine = pLut->point[WG_LUT_POINTS-1];
+	else
+	{
+		/* Position in the table: index in bits 31-24, below WG_LUT_POINTS-1 as the
+			scale is rounded down; 15-bit fraction in bits 23-9 */
+		Uint32	position = (Uint32)((int32)diff + (int32)pLut->span) * pLut->scale;
+		Uint8	index = (Uint8)(position >> 24);
+		int32	fraction = (int32)((position >> 9) & 0x7FFFUL);
+
+		fine = (int32)pLut->point[index] +
+				((((int32)pLut->point[index+1] - (int32)pLut->point[index]) * fraction) >> 15);
+	}
+
+	// Same range as the deviation from the amplitudes
+	if (fine > range)
+		fine = range;
+	else if (fine < -range)
+		fine = -range;
+	pWireGuidData->deviation_fine[i] = (int16)fine;
+	ANT_Deviation[i] = (int16)(fine / WG_DEVIATION_FINE_SCALE);
+	pWireGuidData->deviation_m2ecm[i] = ANT_Deviation[i];
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* Index scale of a table with a valid span */
+static void wireGuid_lut_scale(T_wg_lut_t *pLut)
+{
+	pLut->scale = ((Uint32)(WG_LUT_POINTS - 1) << 24) / (2UL * (Uint32)pLut->span);
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* Extended calibration: averages the normalised difference of the reference 
+	frequency, every batch while calibrated. A batch without a valid deviation
+	fails the reference. */
+static void wireGuid_lut_measure(T_wireGuid_t  *pWireGuidData)
+{
+	Uint8	freq = pWireGuidData->lut_freq;
+
+	if (pWireGuidData->lut_status != WG_LUT_STATUS_MEASURING)
+		return;
+
+	if (pWireGuidData->deviation_m2ecm[freq] == WG_DEVIATION_INVALID)
+	{
+		pWireGuidData->lut_status = WG_LUT_STATUS_FAILED;
+		return;
+	}
+
+	pWireGuidData->lut_sum += wireGuid_norm_diff(pWireGuidData, freq);
+	if (++pWireGuidData->lut_count < WG_LUT_AVERAGE)
+		return;
+
+	pWireGuidData->lut_ref_diff[pWireGuidData->lut_refs] = (int16)(pWireGuidData->lut_sum / WG_LUT_AVERAGE);
+	++pWireGuidData->lut_refs;
+	pWireGuidData->lut_status = WG_LUT_STATUS_IDLE;
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* Computes the table from the references. Sorted by normalised difference, the
+	offsets must be strictly monotonic; points beyond the outer references are
+	extrapolated. Returns false with less than 3 references or when not monotonic. */
+static sbool wireGuid_lut_build(T_wireGuid_t  *pWireGuidData, T_wg_lut_t *pLut)
+{
+	int16	*diff = pWireGuidData->lut_ref_diff;
+	int16	*offset = pWireGuidData->lut_ref_offset;
+	Uint8	refs = pWireGuidData->lut_refs;
+	int32	span;
+	int32	x;
+	int32	value;
+	Uint8	i;
+	Uint8	j;
+
+	if (refs < 3U)
+		return false;
+
+	/* Insertion sort by normalised difference */
+	for (i = 1U; i < refs; ++i)
+	{
+		int16	diff_i = diff[i];
+		int16	offset_i = offset[i];
+
+		for (j = i; (j > 0U) && (diff[j-1] > diff_i); --j)
+		{
+			diff[j] = diff[j-1];
+			offset[j] = offset[j-1];
+		}
+		diff[j] = diff_i;
+		offset[j] = offset_i;
+	}
+
+	/* Differences strictly increasing, offsets strictly increasing or decreasing */
+	for (i = 1U; i < refs; ++i)
+	{
+		if (diff[i] == diff[i-1])
+			return false;
+		if ((i > 1U) && ((((int32)offset[i] - (int32)offset[i-1]) * ((int32)offset[i-1] - (int32)offset[i-2])) <= 0L))
+			return false;
+	}
+
+	span = (-(int32)diff[0] > (int32)diff[refs-1]) ? -(int32)diff[0] : (int32)diff[refs-1];
+	if (span < WG_LUT_MIN_SPAN)
+		span = WG_LUT_MIN_SPAN;
+	pLut->freq = pWireGuidData->lut_freq;
+	pLut->span = (int16)span;
+
+	for (i = 0U; i < WG_LUT_POINTS; ++i)
+	{
+		x = -span + ((2L * span * (int32)i) / (WG_LUT_POINTS - 1));
+
+		/* Segment of the references, the outer segments extrapolate. The offsets
+			are limited to WG_LUT_MAX_OFFSET, so the product fits 32 bits. */
+		for (j = 1U; (j < (refs - 1U)) && (x > diff[j]); ++j)
+			;
+		value = (int32)offset[j-1] + ((((int32)offset[j] - (int32)offset[j-1]) * (x - (int32)diff[j-1])) /
+									  ((int32)diff[j] - (int32)diff[j-1]));
+		if (value > 32767L)
+			value = 32767L;
+		else if (value < -32767L)
+			value = -32767L;
+		pLut->point[i] = (int16)value;
+	}
+	wireGuid_lut_scale(pLut);
+
+	return true;
+}
+
+//*****************************************************************************************************************************************
+/* Called when the table record is written, from the NVM interrupt or directly
+	from eeprom_record_store() */
+static void wireGuid_lut_callback(Uint16 tag, sbool success)
+{
+	T_wireGuid_t	*pWireGuidData = &(gGuidanceData.wireGuidData);
+
+	pWireGuidData->lut_store_failed = !success;
+	pWireGuidData->lut_store_pending = false;
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* Queues the new table (an empty one erases the table) */
+static void wireGuid_lut_store(T_wireGuid_t  *pWireGuidData)
+{
+	Uint16	payload[2 + WG_LUT_POINTS];
+
+	payload[0] = WG_LUT_VERSION | ((Uint16)pWireGuidData->lut_new.freq << 8);
+	payload[1] = (Uint16)pWireGuidData->lut_new.span;
+	memcpy((void*)&payload[2], (void*)pWireGuidData->lut_new.point, sizeof(pWireGuidData->lut_new.point));
+
+	pWireGuidData->lut_store_failed = false;
+	pWireGuidData->lut_store_pending = true;
+	pWireGuidData->lut_status = WG_LUT_STATUS_STORING;
+	if (!eeprom_record_store(EEPROM_RECORD_LUT, payload, 2 + WG_LUT_POINTS, wireGuid_lut_callback, 0U))
+	{
+		pWireGuidData->lut_store_pending = false;
+		pWireGuidData->lut_status = WG_LUT_STATUS_FAILED;
+	}
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* The stored table is used from the next batch */
+static void wireGuid_lut_stored(T_wireGuid_t  *pWireGuidData)
+{
+	if (pWireGuidData->lut_store_failed)
+	{
+		pWireGuidData->lut_status = WG_LUT_STATUS_FAILED;
+		return;
+	}
+
+	pWireGuidData->lut = pWireGuidData->lut_new;
+	pWireGuidData->lut_valid = (pWireGuidData->lut.span >= WG_LUT_MIN_SPAN);
+	pWireGuidData->lut_status = WG_LUT_STATUS_SUCCEEDED;
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* Lookup table: stored record if its layout version matches and it is not empty */
+static void wireGuid_lut_load(T_wireGuid_t  *pWireGuidData)
+{
+	Uint16	payload[2 + WG_LUT_POINTS];
+
+	pWireGuidData->lut_valid = false;
+	if (!eeprom_record_load(EEPROM_RECORD_LUT, payload, 2 + WG_LUT_POINTS) ||
+		((payload[0] & 0x00FFU) != WG_LUT_VERSION) || ((payload[0] >> 8) >= NBR_INPUT_FREQ) ||
+		((int16)payload[1] < WG_LUT_MIN_SPAN))
+		return;
+
+	pWireGuidData->lut.freq = (Uint8)(payload[0] >> 8);
+	pWireGuidData->lut.span = (int16)payload[1];
+	memcpy((void*)pWireGuidData->lut.point, (void*)&payload[2], sizeof(pWireGuidData->lut.point));
+	wireGuid_lut_scale(&(pWireGuidData->lut));
+	pWireGuidData->lut_valid = true;
+
+	return;
+}
+#endif
+
 //*****************************************************************************************************************************************
 static void wireGuid_computeDefaultFreqDeviation(T_wireGuid_t  *pWireGuidData)
 {
@@ -134,23 +410,16 @@ static void wireGuid_computeDefaultFreqDeviation(T_wireGuid_t  *pWireGuidData)
 	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 	{
 		// Calculate the Deviations
-		if ((pWireGuidData->amplitudeLeft[i] > AMPLITUDE_MIN) &&
-			(pWireGuidData->amplitudeRight[i] > AMPLITUDE_MIN))
+		if ((pWireGuidData->amplitudeLeft[i] > (Uint32)gWireGuidParam.amplitude_min) &&
+			(pWireGuidData->amplitudeRight[i] > (Uint32)gWireGuidParam.amplitude_min))
 		{				
-			// Range: ]-20000 ; 20000[, scaled in 200cm
-			ANT_Deviation[i] = (int16)(DEVIATION_SCALE / pWireGuidData->amplitudeLeft[i]) - 
-										(int16)(DEVIATION_SCALE / pWireGuidData->amplitudeRight[i]);
-			// CHECK RANGE -5000 ... 5000
-			if (ANT_Deviation[i] >  DEVIATION_RNG_MAX)
-						ANT_Deviation[i] =  DEVIATION_RNG_MAX;
-			else if (ANT_Deviation[i] < DEVIATION_RNG_MIN)
-						ANT_Deviation[i] = DEVIATION_RNG_MIN;
-			pWireGuidData->deviation_m2ecm[i] = ANT_Deviation[i];
+			wireGuid_compute_deviation(pWireGuidData, i);
 		}
 		// Invalidate the Deviations
 		else
 		{
 			pWireGuidData->deviation_m2ecm[i] = WG_DEVIATION_INVALID;
+			pWireGuidData->deviation_fine[i] = WG_DEVIATION_INVALID;
 			/* Invalidate relative phase in case Resulting Amplitudes
 				of the first Input Frequency is very low */
 			#if SECOND_HARMONIC_FIRST_FREQUENCY
@@ -177,25 +446,25 @@ static void wireGuid_computeCalibFreqDeviation(T_wireGuid_t  *pWireGuidData)
 	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 	{
 		// Calculate the Deviations
-		if ((pWireGuidData->amplitudeLeft[i] > AMPLITUDE_MIN) &&
-			(pWireGuidData->amplitudeRight[i] > AMPLITUDE_MIN) &&
+		if ((pWireGuidData->amplitudeLeft[i] > (Uint32)gWireGuidParam.amplitude_min) &&
+			(pWireGuidData->amplitudeRight[i] > (Uint32)gWireGuidParam.amplitude_min) &&
 			(pWireGuidData->calibration_left.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED) &&
 			(pWireGuidData->calibration_right.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED))
 		{
-			// Range: ]-20000 ; 20000[, scaled in 200cm
-			ANT_Deviation[i] = (int16)(DEVIATION_SCALE / pWireGuidData->amplitudeLeft[i]) - 
-										(int16)(DEVIATION_SCALE / pWireGuidData->amplitudeRight[i]);
-			// CHECK RANGE -5000 ... 5000
-			if (ANT_Deviation[i] >  DEVIATION_RNG_MAX)
-						ANT_Deviation[i] =  DEVIATION_RNG_MAX;
-			else if (ANT_Deviation[i] < DEVIATION_RNG_MIN)
-						ANT_Deviation[i] = DEVIATION_RNG_MIN;
-			pWireGuidData->deviation_m2ecm[i] = ANT_Deviation[i];
+			#if DEVIATION_LUT
+			if (pWireGuidData->lut_valid && (i == pWireGuidData->lut.freq))
+			{
+				wireGuid_lut_deviation(pWireGuidData, i);
+				continue;
+			}
+			#endif
+			wireGuid_compute_deviation(pWireGuidData, i);
 		}
 		// Invalidate the Deviations
 		else
 		{
 			pWireGuidData->deviation_m2ecm[i] = WG_DEVIATION_INVALID;
+			pWireGuidData->deviation_fine[i] = WG_DEVIATION_INVALID;
 			/* Invalidate relative phase in case Resulting Amplitudes
 				of the first Input Frequency is very low */
 			#if SECOND_HARMONIC_FIRST_FREQUENCY
@@ -220,18 +489,18 @@ static sbool wireGuid_eval_antenna_direction(T_wireGuid_t *pWireGuidData, const
 	// I_value = -Q_value
 
 	// check direction of the left coil
-	if ((pWireGuidData->rel_phaseLeft[0] > (I_value - WG_QAM_COMP_NOISE)) &&
-		(pWireGuidData->rel_phaseLeft[0] < (I_value + WG_QAM_COMP_NOISE)) &&
-		(pWireGuidData->rel_phaseLeft[1] > (Q_value - WG_QAM_COMP_NOISE)) &&
-		(pWireGuidData->rel_phaseLeft[1] < (Q_value + WG_QAM_COMP_NOISE)))
+	if ((pWireGuidData->rel_phaseLeft[0] > (I_value - gWireGuidParam.qam_comp_noise)) &&
+		(pWireGuidData->rel_phaseLeft[0] < (I_value + gWireGuidParam.qam_comp_noise)) &&
+		(pWireGuidData->rel_phaseLeft[1] > (Q_value - gWireGuidParam.qam_comp_noise)) &&
+		(pWireGuidData->rel_phaseLeft[1] < (Q_value + gWireGuidParam.qam_comp_noise)))
 	{
 		AntRelPhaseLeftSign = 1;
 		pWireGuidData->rel_phaseLeft_sign = AntRelPhaseLeftSign;
 	}
-	else if (	(pWireGuidData->rel_phaseLeft[0] > (Q_value - WG_QAM_COMP_NOISE)) &&
-				(pWireGuidData->rel_phaseLeft[0] < (Q_value + WG_QAM_COMP_NOISE)) &&
-				(pWireGuidData->rel_phaseLeft[1] > (I_value - WG_QAM_COMP_NOISE)) &&
-				(pWireGuidData->rel_phaseLeft[1] < (I_value + WG_QAM_COMP_NOISE)))
+	else if (	(pWireGuidData->rel_phaseLeft[0] > (Q_value - gWireGuidParam.qam_comp_noise)) &&
+				(pWireGuidData->rel_phaseLeft[0] < (Q_value + gWireGuidParam.qam_comp_noise)) &&
+				(pWireGuidData->rel_phaseLeft[1] > (I_value - gWireGuidParam.qam_comp_noise)) &&
+				(pWireGuidData->rel_phaseLeft[1] < (I_value + gWireGuidParam.qam_comp_noise)))
 	{
 		AntRelPhaseLeftSign = -1;
 		pWireGuidData->rel_phaseLeft_sign = AntRelPhaseLeftSign;
@@ -241,18 +510,18 @@ static sbool wireGuid_eval_antenna_direction(T_wireGuid_t *pWireGuidData, const
 		return false;
 	
 	// check direction of the right coil
-	if ((pWireGuidData->rel_phaseRight[0] > (I_value - WG_QAM_COMP_NOISE)) &&
-		(pWireGuidData->rel_phaseRight[0] < (I_value + WG_QAM_COMP_NOISE)) &&
-		(pWireGuidData->rel_phaseRight[1] > (Q_value - WG_QAM_COMP_NOISE)) &&
-		(pWireGuidData->rel_phaseRight[1] < (Q_value + WG_QAM_COMP_NOISE)))
+	if ((pWireGuidData->rel_phaseRight[0] > (I_value - gWireGuidParam.qam_comp_noise)) &&
+		(pWireGuidData->rel_phaseRight[0] < (I_value + gWireGuidParam.qam_comp_noise)) &&
+		(pWireGuidData->rel_phaseRight[1] > (Q_value - gWireGuidParam.qam_comp_noise)) &&
+		(pWireGuidData->rel_phaseRight[1] < (Q_value + gWireGuidParam.qam_comp_noise)))
 	{
 		AntRelPhaseRightSign = 1;
 		pWireGuidData->rel_phaseRight_sign = AntRelPhaseRightSign;
 	}
-	else if (	(pWireGuidData->rel_phaseRight[0] > (Q_value - WG_QAM_COMP_NOISE)) &&
-					(pWireGuidData->rel_phaseRight[0] < (Q_value + WG_QAM_COMP_NOISE)) &&
-					(pWireGuidData->rel_phaseRight[1] > (I_value - WG_QAM_COMP_NOISE)) &&
-					(pWireGuidData->rel_phaseRight[1] < (I_value + WG_QAM_COMP_NOISE)))
+	else if (	(pWireGuidData->rel_phaseRight[0] > (Q_value - gWireGuidParam.qam_comp_noise)) &&
+					(pWireGuidData->rel_phaseRight[0] < (Q_value + gWireGuidParam.qam_comp_noise)) &&
+					(pWireGuidData->rel_phaseRight[1] > (I_value - gWireGuidParam.qam_comp_noise)) &&
+					(pWireGuidData->rel_phaseRight[1] < (I_value + gWireGuidParam.qam_comp_noise)))
 	{
 		AntRelPhaseRightSign = -1;
 		pWireGuidData->rel_phaseRight_sign = AntRelPhaseRightSign;
@@ -271,23 +540,23 @@ static sbool wireGuid_eval_antenna_direction(T_wireGuid_t *pWireGuidData, const
 /* Helper Function with the Quadrature Component for the Nibble Codeword Evaluation */
 static Uint8 wireGuid_QAM_Nibble_Q(int16 *Quad)
 {
-	if ( (*Quad > (WG_QAM_COMP_MAX_NEG - WG_QAM_COMP_NOISE)) &&
-		 (*Quad < (WG_QAM_COMP_MAX_NEG + WG_QAM_COMP_NOISE))   )
+	if ( (*Quad > (WG_QAM_COMP_MAX_NEG - gWireGuidParam.qam_comp_noise)) &&
+		 (*Quad < (WG_QAM_COMP_MAX_NEG + gWireGuidParam.qam_comp_noise))   )
 	// (I, -75) -> ...+ 0x00
 		return (0x00U);
 		
-	else if ( (*Quad > (WG_QAM_COMP_MIN_NEG - WG_QAM_COMP_NOISE)) && 
-				(*Quad < (WG_QAM_COMP_MIN_NEG + WG_QAM_COMP_NOISE))   )
+	else if ( (*Quad > (WG_QAM_COMP_MIN_NEG - gWireGuidParam.qam_comp_noise)) && 
+				(*Quad < (WG_QAM_COMP_MIN_NEG + gWireGuidParam.qam_comp_noise))   )
 	// (I, -25) -> ...+ 0x01
 		return (0x01U);
 		
-	else if ( (*Quad > (WG_QAM_COMP_MAX - WG_QAM_COMP_NOISE)) &&
-				(*Quad < (WG_QAM_COMP_MAX + WG_QAM_COMP_NOISE))    )
+	else if ( (*Quad > (WG_QAM_COMP_MAX - gWireGuidParam.qam_comp_noise)) &&
+				(*Quad < (WG_QAM_COMP_MAX + gWireGuidParam.qam_comp_noise))    )
 	// (I, 75) -> ...+ 0x02
 		return (0x02U);
 		
-	else if ( (*Quad > (WG_QAM_COMP_MIN - WG_QAM_COMP_NOISE)) &&
-				(*Quad < (WG_QAM_COMP_MIN + WG_QAM_COMP_NOISE))   )
+	else if ( (*Quad > (WG_QAM_COMP_MIN - gWireGuidParam.qam_comp_noise)) &&
+				(*Quad < (WG_QAM_COMP_MIN + gWireGuidParam.qam_comp_noise))   )
 	// (I, 25) -> ...+ 0x03
 		return (0x03U);
 		
@@ -302,26 +571,26 @@ static Uint8 wireGuid_QAM_Nibble(int16 InPhase, int16 Quad)
 {
 	// (I, Q) -> bxxyy -> 0x0X
 
-	if ( (InPhase > (WG_QAM_COMP_MAX_NEG - WG_QAM_COMP_NOISE)) &&
-		 (InPhase < (WG_QAM_COMP_MAX_NEG + WG_QAM_COMP_NOISE))    )
+	if ( (InPhase > (WG_QAM_COMP_MAX_NEG - gWireGuidParam.qam_comp_noise)) &&
+		 (InPhase < (WG_QAM_COMP_MAX_NEG + gWireGuidParam.qam_comp_noise))    )
 	// (-75, Q) constellation -> 0x00 + 0x00...0x03
 	// If invalid -> 0x10
 		return (wireGuid_QAM_Nibble_Q(&Quad));
 		
-	else if (  (InPhase > (WG_QAM_COMP_MIN_NEG - WG_QAM_COMP_NOISE)) && 
-				(InPhase < (WG_QAM_COMP_MIN_NEG + WG_QAM_COMP_NOISE))    )
+	else if (  (InPhase > (WG_QAM_COMP_MIN_NEG - gWireGuidParam.qam_comp_noise)) && 
+				(InPhase < (WG_QAM_COMP_MIN_NEG + gWireGuidParam.qam_comp_noise))    )
 	// (-25, Q) constellation -> 0x04 + 0x00...0x03
 	// If invalid 0x14
 		return (0x04U + wireGuid_QAM_Nibble_Q(&Quad));
 		
-	else if (  (InPhase > (WG_QAM_COMP_MAX - WG_QAM_COMP_NOISE)) &&
-				(InPhase < (WG_QAM_COMP_MIN + WG_QAM_COMP_NOISE))     )
+	else if (  (InPhase > (WG_QAM_COMP_MAX - gWireGuidParam.qam_comp_noise)) &&
+				(InPhase < (WG_QAM_COMP_MAX + gWireGuidParam.qam_comp_noise))     )
 	// (75, Q) constellation -> 0x08 + 0x00...0x03
 	// If invalid 0x18
 		return (0x08U + wireGuid_QAM_Nibble_Q(&Quad));
 
-	else if (  (InPhase > (WG_QAM_COMP_MIN - WG_QAM_COMP_NOISE)) &&
-				(InPhase < (WG_QAM_COMP_MIN + WG_QAM_COMP_NOISE))    )
+	else if (  (InPhase > (WG_QAM_COMP_MIN - gWireGuidParam.qam_comp_noise)) &&
+				(InPhase < (WG_QAM_COMP_MIN + gWireGuidParam.qam_comp_noise))    )
 	// (25, Q) constellation -> 0x0C + 0x00...0x03
 	// If invalid 0x1C
 		return (0x0CU + wireGuid_QAM_Nibble_Q(&Quad));
@@ -385,7 +654,7 @@ static void wireGuid_QAM_status_synchronize(T_wireGuid_t *pWireGuidData)
 		// Increase Hanning Window Size to include more samples of the Start Parity QAM Position
 		ANT_k_max += WG_SYNC_WDW_VAR;	
 	}
-	else if (buffer >= WG_QAM_NOISE)
+	else if (buffer >= gWireGuidParam.qam_noise)
 	// Most samples of the batch processed by Goertzel Algorithm were of the lone baseband signal
 	// Remaining samples were of the NEXT QAM Position: Start Data
 	// Left shift in the time axis needed for the next batch to exclude 
@@ -398,7 +667,7 @@ static void wireGuid_QAM_status_synchronize(T_wireGuid_t *pWireGuidData)
 		// Decrease Hanning Window Size to avoid including in the batch samples of the Start Parity QAM Position
 		ANT_k_max -= WG_SYNC_WDW_VAR;	
 	}
-	//else if (buffer < WG_QAM_NOISE)
+	//else if (buffer < gWireGuidParam.qam_noise)
 		// No 2nd Harmonic, synchronization procedure
 
 	return;
@@ -425,10 +694,10 @@ static void wireGuid_QAM_status_start(T_wireGuid_t *pWireGuidData)
 			}
 			else
 			{
-				check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MAX - WG_QAM_COMP_NOISE)) &&
-							(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MAX + WG_QAM_COMP_NOISE)) &&
-							(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MAX_NEG - WG_QAM_COMP_NOISE)) &&
-							(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MAX_NEG + WG_QAM_COMP_NOISE));
+				check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MAX - gWireGuidParam.qam_comp_noise)) &&
+							(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MAX + gWireGuidParam.qam_comp_noise)) &&
+							(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MAX_NEG - gWireGuidParam.qam_comp_noise)) &&
+							(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MAX_NEG + gWireGuidParam.qam_comp_noise));
 			}
 			if (check)
 			// (75,-75) constellation -> 0x08 Codeword
@@ -447,10 +716,10 @@ static void wireGuid_QAM_status_start(T_wireGuid_t *pWireGuidData)
 			}
 			else
 			{
-				check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MIN_NEG - WG_QAM_COMP_NOISE)) &&
-							(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MIN_NEG + WG_QAM_COMP_NOISE)) &&
-							(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MIN - WG_QAM_COMP_NOISE)) &&
-							(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MIN + WG_QAM_COMP_NOISE));
+				check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MIN_NEG - gWireGuidParam.qam_comp_noise)) &&
+							(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MIN_NEG + gWireGuidParam.qam_comp_noise)) &&
+							(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MIN - gWireGuidParam.qam_comp_noise)) &&
+							(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MIN + gWireGuidParam.qam_comp_noise));
 			}
 			if (check)
 			// (-25, 25) constellation -> 0x07 Codeword
@@ -548,10 +817,10 @@ static void wireGuid_QAM_status_switches(T_wireGuid_t *pWireGuidData)
 static void wireGuid_QAM_status_reserved(T_wireGuid_t *pWireGuidData)
 {
 	// (-75,-75) constellation -> 0x00 Codeword
-	sbool check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MAX_NEG - WG_QAM_COMP_NOISE)) &&
-						(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MAX_NEG + WG_QAM_COMP_NOISE)) &&
-						(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MAX_NEG - WG_QAM_COMP_NOISE)) &&
-						(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MAX_NEG + WG_QAM_COMP_NOISE));
+	sbool check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MAX_NEG - gWireGuidParam.qam_comp_noise)) &&
+						(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MAX_NEG + gWireGuidParam.qam_comp_noise)) &&
+						(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MAX_NEG - gWireGuidParam.qam_comp_noise)) &&
+						(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MAX_NEG + gWireGuidParam.qam_comp_noise));
 
 	if (!check)
 	// Other constellation due to Noise or Hardware/Software Failure
@@ -597,10 +866,10 @@ static void wireGuid_QAM_status_reserved(T_wireGuid_t *pWireGuidData)
 static void wireGuid_QAM_status_end(T_wireGuid_t *pWireGuidData)
 {
 	// (75,75) constellation -> 0x0A Codeword
-	sbool check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MAX - WG_QAM_COMP_NOISE)) &&
-						(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MAX + WG_QAM_COMP_NOISE)) &&
-						(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MAX - WG_QAM_COMP_NOISE)) &&
-						(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MAX + WG_QAM_COMP_NOISE));
+	sbool check = (pWireGuidData->rel_phaseHIGH[0] > (WG_QAM_COMP_MAX - gWireGuidParam.qam_comp_noise)) &&
+						(pWireGuidData->rel_phaseHIGH[0] < (WG_QAM_COMP_MAX + gWireGuidParam.qam_comp_noise)) &&
+						(pWireGuidData->rel_phaseHIGH[1] > (WG_QAM_COMP_MAX - gWireGuidParam.qam_comp_noise)) &&
+						(pWireGuidData->rel_phaseHIGH[1] < (WG_QAM_COMP_MAX + gWireGuidParam.qam_comp_noise));
 			
 	if (!check)
 	// Other constellation due to Noise or Hardware/Software Failure
@@ -637,7 +906,7 @@ static void wireGuid_QAM_status_unknown(T_wireGuid_t *pWireGuidData)
                     pWireGuidData->rel_phaseHIGH[1] * pWireGuidData->rel_phaseHIGH[1]);
 
 	// Detect baseband signal
-	if (buffer < WG_QAM_NOISE)
+	if (buffer < gWireGuidParam.qam_noise)
 		// No 2nd Harmonic present -> go to synchronization procedure
 		pWireGuidData->nibble_status = WG_NIBBLE_STATUS_SYNC;
 
@@ -729,6 +998,7 @@ static void wireGuid_reset_calibration_data(T_wireGuid_t  *pWireGuidData)
 
 	/* Reset calibration procedure when start calibration is requested */
 	pWireGuidData->calibration_counter = 0U;
+	pWireGuidData->calibration_start_msec = gSystemData.clockT1SysData.ticks_free_msec;
 	pWireGuidData->calibration_status = WG_CALIB_STATUS_ONGOING;
 	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 	{
@@ -739,9 +1009,15 @@ static void wireGuid_reset_calibration_data(T_wireGuid_t  *pWireGuidData)
 		/* Reset calibration parameter to default value WG_CALIBRATION_DEFAULT_PARAM */
 		pWireGuidData->calibration_left.calibration_param[i]  = WG_CALIBRATION_DEFAULT_PARAM;
 		pWireGuidData->calibration_right.calibration_param[i] = WG_CALIBRATION_DEFAULT_PARAM;
-		AntAmpGainLeft[i] = pWireGuidData->calibration_left.calibration_param[i];
-		AntAmpGainRight[i] = pWireGuidData->calibration_right.calibration_param[i];
 	}
+	ANT_Stage_Gains(pWireGuidData->calibration_left.calibration_param,
+					pWireGuidData->calibration_right.calibration_param);
+
+	#if DEVIATION_LUT
+	/* A reference being averaged is lost */
+	if (pWireGuidData->lut_status == WG_LUT_STATUS_MEASURING)
+		pWireGuidData->lut_status = WG_LUT_STATUS_FAILED;
+	#endif
 
 	return;
 }
@@ -763,14 +1039,14 @@ static Uint16 wireGuid_calibrate_coil(
 
 			/* Calibration is ok, and minimum calibration time has expired */
 			if ((meas_amplitude[i] == (Uint32)WG_MAX_AMPLITUDE) &&
-				(calibration_counter > WG_MIN_CALIBRATION_COUNTER))
+				(calibration_counter > (gWireGuidParam.calib_delay + gWireGuidParam.calib_min_time)))
 			{
 				calib_data->calibration_status_freq[i] = WG_CALIB_STATUS_SUCCEEDED;
 			}
 			/* Calibration parameter remains below limits after minimum calibration time.
 			   Frequency is probably not present. */
-			else if ((calibration_counter > WG_MIN_CALIBRATION_COUNTER) &&
-					  (calib_data->calibration_param[i] < WG_MIN_CALIBRATION_PARAM))
+			else if ((calibration_counter > (gWireGuidParam.calib_delay + gWireGuidParam.calib_min_time)) &&
+					  (calib_data->calibration_param[i] < gWireGuidParam.calib_min_param))
 			{
 				calib_data->calibration_status_freq[i] = WG_CALIB_STATUS_NOTPRESENT;
 				/* Reset calibration parameter */
@@ -778,7 +1054,7 @@ static Uint16 wireGuid_calibrate_coil(
 			}
 			/* Calibration criteria are not met after maximum time, so calibration has
 				failed */
-			else if (calibration_counter > WG_MAX_CALIBRATION_COUNTER)
+			else if (calibration_counter > (gWireGuidParam.calib_delay + gWireGuidParam.calib_max_time))
 			{
 				calib_data->calibration_status_freq[i] = WG_CALIB_STATUS_FAILED;
 				/* Reset calibration parameter and scale factor */
@@ -801,10 +1077,15 @@ static void wireGuid_calibrate_antenna(T_wireGuid_t  *pWireGuidData)
 	Uint8    i;
 	Uint16   calib_ongoing_left  = 0;
 	Uint16   calib_ongoing_right = 0;
+	Uint16   elapsed = (Uint16)(gSystemData.clockT1SysData.ticks_free_msec - 
+								pWireGuidData->calibration_start_msec) / WG_CALIBRATION_TICK_MSEC;
 
-	++pWireGuidData->calibration_counter;
+	/* Counted from the tick, so the calibration times do not depend on the batch
+		period. It only increases, also when the 16-bit tick difference wraps. */
+	if (elapsed > pWireGuidData->calibration_counter)
+		pWireGuidData->calibration_counter = elapsed;
 
-	if (pWireGuidData->calibration_counter > WG_DELAY_CALIBRATION_COUNTER)
+	if (pWireGuidData->calibration_counter > gWireGuidParam.calib_delay)
 	{
 		calib_ongoing_left = wireGuid_calibrate_coil(
 								pWireGuidData->calibration_counter,
@@ -814,12 +1095,9 @@ static void wireGuid_calibrate_antenna(T_wireGuid_t  *pWireGuidData)
 								pWireGuidData->calibration_counter,
 								&(pWireGuidData->amplitudeRight[0]),
 								&(pWireGuidData->calibration_right));
-        /* Update Calibration Gains for the Goertzel Step */
-		for (i = 0U; i < NBR_INPUT_FREQ; ++i)
-		{
-			AntAmpGainLeft[i] = pWireGuidData->calibration_left.calibration_param[i];
-			AntAmpGainRight[i] = pWireGuidData->calibration_right.calibration_param[i];
-		}
+        /* Update Calibration Gains for the Goertzel Step (applied at the next batch) */
+		ANT_Stage_Gains(pWireGuidData->calibration_left.calibration_param,
+						pWireGuidData->calibration_right.calibration_param);
 		/* If all frequencies left and right are calibrated (or not present), set
 			calib. status to succeeded/failed/etc. */
 		if (!calib_ongoing_left && !calib_ongoing_right)
@@ -873,109 +1151,129 @@ static void wireGuid_calibrate_antenna(T_wireGuid_t  *pWireGuidData)
 }
 
 //*****************************************************************************************************************************************
-/* Executing this function will hold other processes and interrupts as interrupts
-   have to be disabled when writing to EEPROM */
+/* Called when the calibration record is written, from the NVM interrupt or
+	directly from eeprom_record_store() */
+static void wireGuid_store_callback(Uint16 tag, sbool success)
+{
+	T_wireGuid_t	*pWireGuidData = &(gGuidanceData.wireGuidData);
+
+	pWireGuidData->store_failed = !success;
+	pWireGuidData->store_pending = false;
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* The parameters are written as one EEPROM record, so either all new or all 
+   previous parameters are retrieved after a reset. This function is called 
+   every batch until the record is written, so Goertzel batches and CAN 
+   transmission continue while writing. */
 static void wireGuid_store_parameters(T_wireGuid_t  *pWireGuidData)
 {
 	Uint8		i;
-	Uint8		fail_count = 0U;
-	Uint32    	write_address;
-	Uint16    	write_data;
-	sbool	check_write;
-  
-	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
-	{
-		/* Store parameters of Left Antenna */
-		write_address = eeprom_get_read_write_address(i);
-		// Left Antenna calibrated for Input Frequency i
-		if (pWireGuidData->calibration_left.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED)
-			write_data = pWireGuidData->calibration_left.calibration_param[i];
-		// Input i-th Frequency not present or calibration failed
-		else
-			write_data = 0xFFFFU;	
-		// Save Calibration in EEPROM
-		check_write = eeprom_write_word(write_address, write_data);
-		// If writing procedure fails, calibration of Freq. fails
-		if (!check_write)
-			pWireGuidData->calibration_left.calibration_status_freq[i] = WG_CALIB_STATUS_FAILED;
-
-		/* Store parameters of Right Antenna */	
-		write_address = eeprom_get_read_write_address(i + EEPROM_ANT_RIGHT_FREQ1);
-		// Right Antenna calibrated for Input Frequency i
-		if (pWireGuidData->calibration_right.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED)
-			write_data =  pWireGuidData->calibration_right.calibration_param[i];
-		// Input Frequency i not present or calibration failed
-		else
-			write_data = 0xFFFFU;
-		// Save Calibration in EEPROM
-		check_write = eeprom_write_word(write_address, write_data);
-		// If writing procedure fails, calibration of Freq. fails
-		if (!check_write)
-			pWireGuidData->calibration_right.calibration_status_freq[i] = WG_CALIB_STATUS_FAILED;
-	}
-	
-	/* Check success/failure of storing the calibration parameters. */
-    for(i = 0U; i < NBR_INPUT_FREQ; ++i)
+	Uint16		params[2*NBR_INPUT_FREQ];
+
+	switch (pWireGuidData->store_step)
 	{
-		if ((pWireGuidData->calibration_left.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED) &&
-			(pWireGuidData->calibration_right.calibration_status_freq[i]) == WG_CALIB_STATUS_SUCCEEDED)
-		{
-			// At least one Frequency Pair successfully calibrated
+		case WG_STORE_STEP_START:
+			for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+			{
+				/* Parameters of Left Antenna */
+				// Left Antenna calibrated for Input Frequency i
+				if (pWireGuidData->calibration_left.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED)
+					params[i] = pWireGuidData->calibration_left.calibration_param[i];
+				// Input i-th Frequency not present or calibration failed
+				else
+					params[i] = 0xFFFFU;	
+
+				/* Parameters of Right Antenna */	
+				// Right Antenna calibrated for Input Frequency i
+				if (pWireGuidData->calibration_right.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED)
+					params[i+NBR_INPUT_FREQ] = pWireGuidData->calibration_right.calibration_param[i];
+				// Input Frequency i not present or calibration failed
+				else
+					params[i+NBR_INPUT_FREQ] = 0xFFFFU;
+			}
+
+			pWireGuidData->store_failed = false;
+			pWireGuidData->store_pending = true;
+			if (!eeprom_record_store(EEPROM_RECORD_CALIB, params, 2*NBR_INPUT_FREQ,
+									 wireGuid_store_callback, 0U))
+			{
+				pWireGuidData->store_failed = true;
+				pWireGuidData->store_pending = false;
+			}
+			pWireGuidData->store_step = WG_STORE_STEP_RECORD;
+			break;
+
+		case WG_STORE_STEP_RECORD:
+			if (pWireGuidData->store_pending)
+				return;
+
+			pWireGuidData->store_step = WG_STORE_STEP_START;
+			/* Change calibration status */
+			// If writing procedure fails, calibration of all Freqs. fails
+			if (pWireGuidData->store_failed)
+			{
+				for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+				{
+					if (pWireGuidData->calibration_left.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED)
+						pWireGuidData->calibration_left.calibration_status_freq[i] = WG_CALIB_STATUS_FAILED;
+					if (pWireGuidData->calibration_right.calibration_status_freq[i] == WG_CALIB_STATUS_SUCCEEDED)
+						pWireGuidData->calibration_right.calibration_status_freq[i] = WG_CALIB_STATUS_FAILED;
+				}
+				pWireGuidData->calibration_status = WG_CALIB_STATUS_FAILED;
+				return;
+			}
+			// Writing procedure succeeded, calibration is successful
+			pWireGuidData->calibration_status = WG_CALIB_STATUS_SUCCEEDED; 
+			LATBbits.LATB10 = 1;
+			break;
+
+		default:
+			pWireGuidData->store_step = WG_STORE_STEP_START;
 			break;
-		}
-		else
-			++fail_count;
-	}
-	// If storing was a failure, set calibration status as failed and quit writing process
-	if (fail_count == NBR_INPUT_FREQ)
-	{
-		pWireGuidData->calibration_status = WG_CALIB_STATUS_FAILED;
-		/* Store invalid data to EEPROM. We don't care if it fails, since in this case something
-			is wrong w/ the EEPROM */
-		write_address = eeprom_get_read_write_address(EEPROM_ANT_CALIB_DATA_WRITTEN);
-		eeprom_write_word(write_address, 0xFFFFU);
-		return;
-	}
-	
-	/* Write flag to tell that calibration data has been sent */
-	write_address = eeprom_get_read_write_address(EEPROM_ANT_CALIB_DATA_WRITTEN);
-	write_data = WG_EEPROM_PARAM_STORED;
-	check_write = eeprom_write_word(write_address, write_data);
-	
-	/* Change calibration status */
-	// If writing procedure fails, calibration fails and quit writing process
-	if (!check_write)
-	{
-		pWireGuidData->calibration_status = WG_CALIB_STATUS_FAILED;
-		return;
 	}
-	// Writing procedure succeeded, calibration is successful
-	pWireGuidData->calibration_status = WG_CALIB_STATUS_SUCCEEDED; 
-	LATBbits.LATB10 = 1;
 
 	return;
 }
 
 //*****************************************************************************************************************************************
-static void wireGuid_retrieve_parameters(T_wireGuid_t  *pWireGuidData)
+/* Read stored parameters (left Freq. 1-4, right Freq. 1-4) from the newest 
+   calibration record. When no record is present, parameters stored at fixed
+   addresses by earlier versions are used. Both are read from the RAM copy made
+   at start-up. Returns false when none are stored. */
+static sbool wireGuid_read_stored_parameters(Uint16 *params)
 {
-	Uint8     i;
-	Uint32   read_address;
-	Uint16   read_data;
+	Uint8	i;
+
+	if (eeprom_record_load(EEPROM_RECORD_CALIB, params, 2*NBR_INPUT_FREQ))
+		return true;
 
 	/* Check whether valid parameters have been written to EEPROM before */
-	read_address = eeprom_get_read_write_address(EEPROM_ANT_CALIB_DATA_WRITTEN);
-	read_data = eeprom_read_word(read_address);
+	if (eeprom_read_legacy(EEPROM_ANT_CALIB_DATA_WRITTEN) != WG_EEPROM_PARAM_STORED)
+		return false;
+
+	for (i = 0U; i < 2*NBR_INPUT_FREQ; ++i)
+		params[i] = eeprom_read_legacy((E_eeprom_ID_t)(EEPROM_ANT_LEFT_FREQ1 + i));
+
+	return true;
+}
+
+//*****************************************************************************************************************************************
+static void wireGuid_retrieve_parameters(T_wireGuid_t  *pWireGuidData)
+{
+	Uint8     i;
+	Uint16   params[2*NBR_INPUT_FREQ];
 
-	if (read_data == WG_EEPROM_PARAM_STORED)
+	if (wireGuid_read_stored_parameters(params))
 	{
 		pWireGuidData->calibration_status = WG_CALIB_STATUS_SUCCEEDED;
 		
 		for (i = 0U; i < NBR_INPUT_FREQ; ++i)
 		{
 			/* Retrieve parameters left antenna */
-			read_address = eeprom_get_read_write_address(i);
-			pWireGuidData->calibration_left.calibration_param[i] = eeprom_read_word(read_address);
+			pWireGuidData->calibration_left.calibration_param[i] = params[i];
 
 			if (pWireGuidData->calibration_left.calibration_param[i] == 0xFFFFU)
 			{
@@ -988,8 +1286,7 @@ static void wireGuid_retrieve_parameters(T_wireGuid_t  *pWireGuidData)
 			}
 			
 			/* Retrieve parameters right antenna */
-			read_address = eeprom_get_read_write_address(i+EEPROM_ANT_RIGHT_FREQ1);
-			pWireGuidData->calibration_right.calibration_param[i] = eeprom_read_word(read_address);
+			pWireGuidData->calibration_right.calibration_param[i] = params[i+NBR_INPUT_FREQ];
 
 			if (pWireGuidData->calibration_right.calibration_param[i] == 0xFFFFU)
 			{	
@@ -1021,6 +1318,23 @@ static void wireGuid_retrieve_parameters(T_wireGuid_t  *pWireGuidData)
   return;
 }
 
+//*****************************************************************************************************************************************
+/* Runtime parameters: stored record if its layout version matches, else defaults */
+static void wireGuid_load_param(void)
+{
+	Uint16	payload[1 + sizeof(T_wg_param_t)/sizeof(Uint16)];
+
+	gWireGuidParam = WgParamDefault;
+
+	if (eeprom_record_load(EEPROM_RECORD_PARAM, payload, 1 + sizeof(T_wg_param_t)/sizeof(Uint16)) &&
+		(payload[0] == WG_PARAM_VERSION))
+	{
+		memcpy((void*)&gWireGuidParam, (void*)&payload[1], sizeof(T_wg_param_t));
+	}
+
+	return;
+}
+
 //*****************************************************************************************************************************************
 /* For the BIT, a PWM signal is continuously provided to the antenna input,
    in addition to the input signals from the signal generator (and used for 
@@ -1055,6 +1369,41 @@ static void wireGuid_checkBIT(T_wireGuid_t  *pWireGuidData)
 
 //*****************************************************************************************************************************************
 // Local functions
+//*****************************************************************************************************************************************
+/* Frequencies with a valid deviation, bit per frequency */
+static Uint8 wireGuid_valid_mask(const T_wireGuid_t  *pWireGuidData)
+{
+	Uint8	valid = 0x00U;
+	Uint8	i;
+
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+	{
+		if (pWireGuidData->deviation_m2ecm[i] != WG_DEVIATION_INVALID)
+			valid |= (Uint8)(1U << i);
+	}
+
+	return valid;
+}
+
+//*****************************************************************************************************************************************
+static void wireGuid_check_first_deviation(T_wireGuid_t  *pWireGuidData)
+{
+	Uint8	i;
+
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+	{
+		if (pWireGuidData->deviation_m2ecm[i] != WG_DEVIATION_INVALID)
+		{
+			/* 0 is used as 'not yet measured' */
+			gSystemData.bootTiming.first_deviation_msec = 
+				(gSystemData.clockT1SysData.ticks_boot_msec > 0U) ? gSystemData.clockT1SysData.ticks_boot_msec : 1U;
+			break;
+		}
+	}
+
+	return;
+}
+
 //*****************************************************************************************************************************************
 void WireGuid_init(T_wireGuid_t  *pWireGuidData)
 {
@@ -1064,8 +1413,16 @@ void WireGuid_init(T_wireGuid_t  *pWireGuidData)
 	/* Initialize antenna type to default antenna type */
 	pWireGuidData->antennaType =  WG_ANT_TYPE_COIL_2V;
   
+	/* Runtime parameters, read from EEPROM */
+	wireGuid_load_param();
+
 	/* Set calibration status, read data from EEPROM */
 	wireGuid_retrieve_parameters(pWireGuidData);
+
+	#if DEVIATION_LUT
+	/* Deviation lookup table, read from EEPROM */
+	wireGuid_lut_load(pWireGuidData);
+	#endif
   
     /* Antenna initialization for amplitude computation*/
 	ANT_Initialize(pWireGuidData);
@@ -1084,79 +1441,255 @@ void WireGuid_init(T_wireGuid_t  *pWireGuidData)
 
 //*****************************************************************************************************************************************
 void WireGuid_process(T_wireGuid_t  *pWireGuidData)
+{
+	#if PERF_COUNTERS
+	Uint16	perf_start = PERF_STAMP();
+	#endif
+
+	/* Goertzel is started with the default Frequencies. Stored user-defined
+		Frequencies are applied from the next batch. */
+	if (!pWireGuidData->user_freqs_loaded)
+	{
+		ANT_Load_Freqs(pWireGuidData->frequencies, &(pWireGuidData->freq_status));
+		pWireGuidData->user_freqs_loaded = true;
+	}
+
+	/* Apply Frequency configuration received through CAN. The new coefficients
+		are staged and become active at the next batch boundary. */
+	if (pWireGuidData->freq_request_pending && !ANT_Store_Busy())
+	{
+		Uint8 freq_request[8];
+
+		/* Clear request first: a request received while copying is processed again */
+		pWireGuidData->freq_request_pending = false;
+		memcpy((void*)freq_request, (void*)pWireGuidData->freq_request, sizeof(freq_request));
+		ANT_Set_Freqs(freq_request, pWireGuidData->frequencies, &(pWireGuidData->freq_status));
+	}
+
+	#if DEVIATION_LUT
+	if ((pWireGuidData->lut_status == WG_LUT_STATUS_STORING) && !pWireGuidData->lut_store_pending)
+		wireGuid_lut_stored(pWireGuidData);
+	#endif
+
+	#if PERF_COUNTERS
+	Perf_record(PERF_PROBE_WIREGUID_PROCESS, perf_start);
+	#endif
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* WireGuid_bit() checks the antenna reference voltages and the BIT result */
+void WireGuid_bit(T_wireGuid_t  *pWireGuidData)
 {
 	/* Check whether antenna data is ok (refV within spec) */
 	wireGuid_antennaGood(pWireGuidData);
-  
+
+	/* Check that BIT succeeded, when active */
+	#if BIT_WIREGUID_ACTIVE
+	wireGuid_checkBIT(pWireGuidData);
+	#endif 
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* WireGuid_store() queues updated Frequency values to EEPROM, status is updated
+   when written */
+void WireGuid_store(T_wireGuid_t  *pWireGuidData)
+{
+	ANT_Store_Freqs(pWireGuidData->frequencies, &(pWireGuidData->freq_status));
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* WireGuid_batch() post-processes a completed batch as soon as the A/D interrupt
+   signals it, without waiting for the next 100Hz tick. Returns true when a batch
+   has been processed. */
+sbool WireGuid_batch(T_wireGuid_t  *pWireGuidData)
+{
+	Uint8	valid;
+	#if PERF_COUNTERS
+	Uint16	perf_start;
+	Uint16	perf_final;
+	#endif
+
 	// COMPUTE DEVIATION FUNCTION CALL from antenna_calculation.c
 	/* CHECK IF ANTENNA HAS FINISHED COLLECTING SAMPLES */
-	if (ANT_k >= ANT_k_max)
+	if (!ANT_BatchReady)
+		return false;
+	ANT_BatchReady = false;
+	#if PERF_COUNTERS
+	perf_start = PERF_STAMP();
+	#endif
+
+	#if DISABLE_ADC_ISR_GOERTZEL
+	// Disable A/D Interrupt to compute real Final Step exec. time
+	IEC0bits.ADIE = 0; // Control Bit for individual enabling/disabling of A/D ISR
+	#endif
+	#if defined(FUNCTION_CALL)
+	/* ########################################### */
+	t[1] = clock(); // start final step instruction-counter
+	/* ########################################### */
+	#endif
+	#if PERF_COUNTERS
+	perf_final = PERF_STAMP();
+	ANT_FinalStep(pWireGuidData);
+	Perf_record(PERF_PROBE_ANT_FINAL_STEP, perf_final);
+	#else
+	ANT_FinalStep(pWireGuidData);
+	#endif
+	/* Perform calibration or set deviation to invalid if needed */
+	switch (pWireGuidData->calibration_status)
 	{
-		#if DISABLE_ADC_ISR_GOERTZEL
-		// Disable A/D Interrupt to compute real Final Step exec. time
-		IEC0bits.ADIE = 0; // Control Bit for individual enabling/disabling of A/D ISR
-		#endif
-		#if defined(FUNCTION_CALL)
-		/* ########################################### */
-		t[1] = clock(); // start final step instruction-counter
-		/* ########################################### */
-		#endif
-		ANT_FinalStep(pWireGuidData);
-		/* Perform calibration or set deviation to invalid if needed */
-		switch (pWireGuidData->calibration_status)
-		{
-			case WG_CALIB_STATUS_START:
-				wireGuid_set_deviation_invalid(pWireGuidData);
-				wireGuid_reset_calibration_data(pWireGuidData);
-				break;
+		case WG_CALIB_STATUS_START:
+			wireGuid_set_deviation_invalid(pWireGuidData);
+			wireGuid_reset_calibration_data(pWireGuidData);
+			break;
 
-			case WG_CALIB_STATUS_ONGOING:
-				wireGuid_set_deviation_invalid(pWireGuidData);
-				wireGuid_calibrate_antenna(pWireGuidData);
-				break;
+		case WG_CALIB_STATUS_ONGOING:
+			wireGuid_set_deviation_invalid(pWireGuidData);
+			wireGuid_calibrate_antenna(pWireGuidData);
+			break;
 
-			case WG_CALIB_STORE_PARAM_IN_EEPROM:
-				wireGuid_set_deviation_invalid(pWireGuidData);
-				wireGuid_store_parameters(pWireGuidData);
-				break;
+		case WG_CALIB_STORE_PARAM_IN_EEPROM:
+			wireGuid_set_deviation_invalid(pWireGuidData);
+			wireGuid_store_parameters(pWireGuidData);
+			break;
 
-			case WG_CALIB_STATUS_SUCCEEDED:
-				#if SECOND_HARMONIC_FIRST_FREQUENCY
-				wireGuid_QAM_decode(pWireGuidData);
-				#endif
-				wireGuid_computeCalibFreqDeviation(pWireGuidData);
-				break;
+		case WG_CALIB_STATUS_SUCCEEDED:
+			#if SECOND_HARMONIC_FIRST_FREQUENCY
+			wireGuid_QAM_decode(pWireGuidData);
+			#endif
+			wireGuid_computeCalibFreqDeviation(pWireGuidData);
+			#if DEVIATION_LUT
+			wireGuid_lut_measure(pWireGuidData);
+			#endif
+			break;
+
+		case WG_CALIB_STATUS_DEFAULT:
+			wireGuid_computeDefaultFreqDeviation(pWireGuidData);
+			break;
+
+		case WG_CALIB_STATUS_NOTPRESENT:
+		case WG_CALIB_STATUS_FAILED:
+		default:
+			wireGuid_set_deviation_invalid(pWireGuidData);
+			break;
+	}
+	/* Measure start-up time until the first valid deviation */
+	if (gSystemData.bootTiming.first_deviation_msec == 0U)
+		wireGuid_check_first_deviation(pWireGuidData);
+
+	/* A capture may wait for a batch that lost a valid deviation */
+	valid = wireGuid_valid_mask(pWireGuidData);
+	#if SAMPLE_CAPTURE
+	Capture_batch(pWireGuidData->window_end, (pWireGuidData->valid_mask & (Uint8)~valid) != 0U);
+	#endif
+	pWireGuidData->valid_mask = valid;
+	#if defined(FUNCTION_CALL)
+	/* ##################################################### */
+	t[1] = clock() - t[1]; // update final step function instruction-counter 
+	t[2] += t[1];	// update batch instruction-counter
+	t[3] += t[2];	// update total instruction-counter
+	t[2] = 0; // reset batch instruction-counter
+	/* ##################################################### */
+	#endif
+	#if DISABLE_ADC_ISR_GOERTZEL
+	// Re-enable A/D interrupt
+	IEC0bits.ADIE = 1;
+	#endif
+	#if PERF_COUNTERS
+	Perf_record(PERF_PROBE_WIREGUID_BATCH, perf_start);
+	#endif
+  
+	return true;
+}
 
-			case WG_CALIB_STATUS_DEFAULT:
-				wireGuid_computeDefaultFreqDeviation(pWireGuidData);
+//*****************************************************************************************************************************************
+/* Restore the default runtime parameters, in RAM only */
+void WireGuid_param_defaults(void)
+{
+	gWireGuidParam = WgParamDefault;
+
+	return;
+}
+
+//*****************************************************************************************************************************************
+/* Queue the runtime parameters for storage in EEPROM. Returns false when the
+   record could not be queued (write ongoing or EEPROM queue full). */
+sbool WireGuid_param_store(void)
+{
+	Uint16	payload[1 + sizeof(T_wg_param_t)/sizeof(Uint16)];
+
+	payload[0] = WG_PARAM_VERSION;
+	memcpy((void*)&payload[1], (void*)&gWireGuidParam, sizeof(T_wg_param_t));
+
+	return eeprom_record_store(EEPROM_RECORD_PARAM, payload, 1 + sizeof(T_wg_param_t)/sizeof(Uint16),
+							   NULL, 0U);
+}
+
+#if DEVIATION_LUT
+//*****************************************************************************************************************************************
+/* Extended calibration, CAN_CMD_LUT: sub-command (byte 1, E_wg_lut_cmd_t),
+   reference offset (bytes 2-3, MSB first), frequency (byte 4). With the 
+   antenna calibrated, the vehicle is stopped at known offsets from the wire,
+   a reference is taken at each; the table is computed and stored from them.
+   The table is of the Input Frequency of the first reference, a reference of
+   another Input Frequency fails until the references are cleared. Commands are
+   ignored while a table is stored. */
+void WireGuid_lut_command(T_wireGuid_t  *pWireGuidData, const Uint8 *param)
+{
+	int16	offset = (int16)(((Uint16)param[1] << 8) | (Uint16)param[2]);
+
+	if (pWireGuidData->lut_status == WG_LUT_STATUS_STORING)
+		return;
+
+	switch (param[0])
+	{
+		case WG_LUT_CMD_CLEAR:
+			pWireGuidData->lut_refs = 0U;
+			pWireGuidData->lut_freq = 0U;
+			pWireGuidData->lut_status = WG_LUT_STATUS_IDLE;
+			break;
+
+		case WG_LUT_CMD_REFERENCE:
+			if ((pWireGuidData->calibration_status != WG_CALIB_STATUS_SUCCEEDED) ||
+				(pWireGuidData->lut_refs >= WG_LUT_MAX_REFS) || (param[3] >= NBR_INPUT_FREQ) ||
+				((pWireGuidData->lut_refs > 0U) && (param[3] != pWireGuidData->lut_freq)) ||
+				(offset > WG_LUT_MAX_OFFSET) || (offset < -WG_LUT_MAX_OFFSET))
+			{
+				pWireGuidData->lut_status = WG_LUT_STATUS_FAILED;
 				break;
+			}
+			pWireGuidData->lut_ref_offset[pWireGuidData->lut_refs] = offset;
+			pWireGuidData->lut_freq = param[3];
+			pWireGuidData->lut_count = 0U;
+			pWireGuidData->lut_sum = 0L;
+			pWireGuidData->lut_status = WG_LUT_STATUS_MEASURING;
+			break;
 
-			case WG_CALIB_STATUS_NOTPRESENT:
-			case WG_CALIB_STATUS_FAILED:
-			default:
-				wireGuid_set_deviation_invalid(pWireGuidData);
+		case WG_LUT_CMD_STORE:
+			if (!wireGuid_lut_build(pWireGuidData, &(pWireGuidData->lut_new)))
+			{
+				pWireGuidData->lut_status = WG_LUT_STATUS_FAILED;
 				break;
-		}
-		#if defined(FUNCTION_CALL)
-		/* ##################################################### */
-		t[1] = clock() - t[1]; // update final step function instruction-counter 
-		t[2] += t[1];	// update batch instruction-counter
-		t[3] += t[2];	// update total instruction-counter
-		t[2] = 0; // reset batch instruction-counter
-		/* ##################################################### */
-		#endif
-		#if DISABLE_ADC_ISR_GOERTZEL
-		// Re-enable A/D interrupt
-		IEC0bits.ADIE = 1;
-		#endif
+			}
+			wireGuid_lut_store(pWireGuidData);
+			break;
+
+		case WG_LUT_CMD_ERASE:
+			memset((void*)&(pWireGuidData->lut_new), 0, sizeof(T_wg_lut_t));
+			wireGuid_lut_store(pWireGuidData);
+			break;
+
+		default:
+			break;
 	}
-  
-	/* Check that BIT succeeded, when active */
-	#if BIT_WIREGUID_ACTIVE
-	wireGuid_checkBIT(pWireGuidData);
-	#endif 
-  
+
 	return;
 }
+#endif
 
 #endif
@@ -9,12 +9,19 @@
 
 #include "systemtypes.h" // for E_LEDColor_t
 
+/* Defines */
+/* A/D interrupt period [TCY]: 4 inputs of 15 TAD (SAMC 1, conversion 14),
+   TAD = (ADCS + 1) / 2 TCY = 22 TCY */
+#define ADC_PERIOD_TCY		(1320U)
+
 /* Global variables */
 extern int16 ADC_refVoltLeft_1;     /* Needed to check that antenna still ok */
 extern int16 ADC_refVoltRight_1;    /* Needed to check that antenna still ok */
+extern volatile Uint32 ADC_sampleCounter;	/* Free-running number of A/D interrupts */
 
 /* Function declarations */
 void  Adc_init(void);
+Uint32 Adc_sample_counter(void);
 void  Adc_BlinkLED(E_LEDColor_t ledColor, sbool ledON);
 
 #endif // End of __HAL_ADC_H definition
@@ -10,20 +10,38 @@
 #include <time.h> // timers for execution time measuring
 #include "guidance.h"
 
+/* Defines */
+/* Number of messages waiting for a free transmit buffer */
+#define CAN_TX_QUEUE_SIZE	(8)
+
+/* Bytes of the command PDO following the command code */
+#define CAN_COMMAND_PARAM_SIZE	(7)
+
+/* Number of received messages waiting for Can_process() */
+#define CAN_RX_FIFO_SIZE	(4)
+
 /* Typedefs */
 typedef struct
 {
 	Uint16  sid;
 	Uint8   length;
-	Uint8   content[8];
+	Uint8   content[8] __attribute__((aligned(2)));	/* Copied to the transmit buffer as words */
 }T_can_msg_t;
 
+/* Transmit priority, also used as TXPRI of the transmit buffer */
 typedef enum
 {
-	CAN_RX_MSG_BUFFER_0 = 0,
-	CAN_RX_MSG_BUFFER_1,
-	CAN_RX_MSG_BUFFER_LAST
-}E_can_rx_buffer_t;
+	CAN_TX_PRIORITY_LOW = 0,
+	CAN_TX_PRIORITY_MEDIUM_LOW,
+	CAN_TX_PRIORITY_MEDIUM_HIGH,
+	CAN_TX_PRIORITY_HIGH
+}E_can_tx_priority_t;
+
+typedef struct
+{
+	T_can_msg_t		msg;
+	Uint8			priority;	/* E_can_tx_priority_t */
+}T_can_tx_entry_t;
 
 typedef enum
 {
@@ -31,14 +49,189 @@ typedef enum
 	CAN_TX_MSG_BUFFER_1,
 	CAN_TX_MSG_BUFFER_2,
 	CAN_TX_MSG_BUFFER_3,
+	CAN_TX_MSG_BUFFER_4,		/* Diagnostic */
+	CAN_TX_MSG_BUFFER_5,		/* SDO response */
 	CAN_TX_MSG_BUFFER_LAST
 }E_can_tx_buffer_t;
 
+typedef enum
+{
+	CAN_STATE_CONFIG_REQUESTED = 0,	/* Waiting for configuration mode */
+	CAN_STATE_NORMAL_REQUESTED,		/* Configured, waiting for normal operation mode */
+	CAN_STATE_RUNNING,
+	CAN_STATE_BUS_OFF				/* Bus-off, waiting for the back-off time before restart */
+}E_can_state_t;
+
+/* Command PDO, byte 0 */
+typedef enum
+{
+	CAN_CMD_NONE = 0,
+	CAN_CMD_EEPROM_SELFTEST,	/* Start EEPROM self-test, result in diagnostic page 0 */
+	CAN_CMD_DIAGNOSTIC,			/* Transmit diagnostic page (byte 1), item (byte 2) */
+	CAN_CMD_PDO_CONFIG,			/* Set transmission of PDO (byte 1): type (byte 2), period (byte 3), 
+									inhibit time (byte 4), deadband (bytes 5-6); stored in EEPROM */
+	CAN_CMD_BITRATE,			/* Set bit rate (byte 1), stored in EEPROM; CAN restarts */
+	CAN_CMD_PDO_LAYOUT,			/* Set PDO layout (byte 1) and frequency of the compact PDO (byte 2),
+									stored in EEPROM */
+	CAN_CMD_CAPTURE,			/* Sample capture (SAMPLE_CAPTURE): mode (byte 1), trigger (byte 2),
+									pairs (byte 3), see capture.h */
+	CAN_CMD_LUT					/* Deviation lookup table (DEVIATION_LUT): command (byte 1), reference
+									offset (bytes 2-3), frequency (byte 4), see WireGuid_lut_command */
+}E_can_command_t;
+
+/* PDO layout. Compact: only the 0x18n PDO is transmitted, with the deviation of
+	one frequency, quality and status:
+	- msg: [0x18n  8  fine deviation (2 bytes), quality, antenna status, 
+							valid | calibrated | frequency | calibration status,
+							coefficient version | direction checked, switch states, 
+							valid deviation per frequency] */
+typedef enum
+{
+	CAN_PDO_LAYOUT_STANDARD = 0,
+	CAN_PDO_LAYOUT_COMPACT,
+	CAN_PDO_LAYOUT_LAST
+}E_can_pdo_layout_t;
+
+typedef enum
+{
+	CAN_BITRATE_125K = 0,
+	CAN_BITRATE_250K,
+	CAN_BITRATE_500K,
+	CAN_BITRATE_1M,
+	CAN_BITRATE_LAST
+}E_can_bitrate_t;
+
+/* Transmitted PDO's, configured by CAN_CMD_PDO_CONFIG */
+typedef enum
+{
+	CAN_PDO_RESULT = 0,			/* 0x18n deviations */
+	CAN_PDO_STATUS,				/* 0x28n status and quality */
+	CAN_PDO_RAW,				/* 0x38n amplitudes */
+	CAN_PDO_SWITCHES,			/* 0x48n switch states */
+	CAN_PDO_LAST
+}E_can_pdo_t;
+
+/* Transmission type of a PDO. Periods and inhibit times are in 100Hz ticks. */
+typedef enum
+{
+	CAN_TX_TYPE_CYCLIC = 0,		/* Every 'period' ticks, never when period is 0 */
+	CAN_TX_TYPE_ON_CHANGE,		/* When a value changed more than 'deadband' since it was sent */
+	CAN_TX_TYPE_EVENT,			/* When the application signals new data */
+	CAN_TX_TYPE_SYNC,			/* Every 'period'-th SYNC (0x080), the latest computed values */
+	CAN_TX_TYPE_LAST
+}E_can_tx_type_t;
+
+typedef struct
+{
+	Uint8			type;		/* E_can_tx_type_t */
+	Uint8			period;		/* Cyclic: period; SYNC: SYNC messages; on change, event: maximum time between messages (0: none) */
+	Uint8			inhibit;	/* On change, event: minimum time between messages */
+	Uint16			deadband;
+}T_can_pdo_config_t;
+
+typedef struct
+{
+	Uint8			ticks;			/* 100Hz ticks (SYNC PDO: SYNC messages) since last transmission, saturating */
+	sbool			event_pending;	/* Event not yet transmitted due to the inhibit time */
+	sbool			event_level;	/* Last level of the event signal, an event is its rising edge */
+	Uint8			sent[8];		/* Content of the last transmitted message */
+}T_can_pdo_state_t;
+
+/* Diagnostic PDO, byte 0 */
+typedef enum
+{
+	CAN_DIAG_PAGE_BOOT = 0,		/* Start-up timing, EEPROM self-test */
+	CAN_DIAG_PAGE_TX_QUEUE,		/* Transmit queue depth and dropped messages */
+	CAN_DIAG_PAGE_BITRATE,		/* Active and selected bit rate */
+	CAN_DIAG_PAGE_RX,			/* Receive overruns, dropped and invalid messages, errors */
+	CAN_DIAG_PAGE_ERRORS,		/* Error counters, bus-off and error-passive events; sent after bus-off */
+	CAN_DIAG_PAGE_SYNC,			/* Received SYNC messages, window re-phase */
+	CAN_DIAG_PAGE_TIMESTAMP,	/* End of the window of the deviations and its age, in ADC samples */
+	CAN_DIAG_PAGE_SCHED,		/* Statistics of a scheduler task (item); sent on a deadline miss or overrun */
+	CAN_DIAG_PAGE_LOAD,			/* CPU load and Idle mode entries; sent every second (SCHED_LOAD_REPORT) */
+	CAN_DIAG_PAGE_INT,			/* Entry latency of an interrupt (item); Timer1 is sent when above its bound */
+	CAN_DIAG_PAGE_INT_HIST,		/* Entry latency histogram: item = interrupt + 16 * part, 3 bins per part */
+	CAN_DIAG_PAGE_PERF,			/* Execution time of a performance probe (item) */
+	CAN_DIAG_PAGE_PERF_HIST,	/* Execution time histogram: item = probe + 16 * part, 3 bins per part */
+	CAN_DIAG_PAGE_CAPTURE,		/* Sample capture state; first message of a streamed capture */
+	CAN_DIAG_PAGE_CAPTURE_DATA,	/* Captured samples: segment (item), 2 packed pairs */
+	CAN_DIAG_PAGE_LUT,			/* Deviation lookup table: state, Input Frequency, span, point (item) */
+	CAN_DIAG_PAGE_LAST
+}E_can_diag_page_t;
+
+/* Bus error statistics. Retransmissions and lost arbitration are sampled per
+	transmit buffer at 100Hz. */
+typedef struct
+{
+	Uint16			bus_off;			/* Bus-off events */
+	Uint16			error_passive;		/* Transitions to error-passive */
+	Uint16			retransmissions;	/* Transmit errors (TXERR) */
+	Uint16			lost_arbitration;	/* Lost arbitration (TXLARB) */
+	Uint8			tec_max;			/* Highest transmit error counter */
+	Uint8			rec_max;			/* Highest receive error counter */
+	Uint8			bus_off_sequence;	/* Bus-off events without stable period in between */
+	Uint16			stable_counter;		/* 100Hz ticks without bus-off */
+	Uint16			backoff;			/* Back-off time in 100Hz ticks */
+	sbool			passive;			/* Error-passive at last check */
+	Uint8			tx_flags[3];		/* TXERR, TXLARB of each transmit buffer at last check */
+	sbool			report_pending;		/* Error page is sent when running again */
+}T_can_errors_t;
+
 typedef struct
 {
 	T_can_msg_t		can_tx_msg_buffer[CAN_TX_MSG_BUFFER_LAST];
-	T_can_msg_t		can_rx_msg_buffer[CAN_RX_MSG_BUFFER_LAST];
 	Uint8			nodeID_DIP;    /* Node ID as set by DIP switches 2,3,4,5 */
+
+	/* Start-up of the CAN module, advanced by Can_process() */
+	E_can_state_t	state;
+	Uint16			state_counter;	/* 100Hz ticks in current state */
+	Uint8			init_retries;	/* Number of timeouts during start-up */
+
+	/* Receive FIFO, filled by the CAN interrupt and emptied by Can_process() */
+	T_can_msg_t		rx_fifo[CAN_RX_FIFO_SIZE];
+	Uint8			rx_fifo_head;
+	volatile Uint8	rx_fifo_count;
+	Uint8			rx_fifo_max;	/* Highest number of messages in the FIFO */
+	Uint16			rx_dropped;		/* Messages dropped as the FIFO was full */
+	Uint16			rx_overrun;		/* Messages lost as both receive buffers were full */
+	Uint16			invalid_msg;	/* Invalid message interrupts (IVRIF) */
+	Uint16			error_irq;		/* Error interrupts (ERRIF) */
+	sbool			boot_reported;	/* Start-up timing has been transmitted */
+
+	/* Transmit queue, ordered by priority (first entry is transmitted first).
+		Shared with the CAN interrupt, which loads free transmit buffers. */
+	T_can_tx_entry_t	tx_queue[CAN_TX_QUEUE_SIZE];
+	Uint8			tx_queue_count;
+	Uint8			tx_queue_max;	/* Highest number of queued messages */
+	Uint16			tx_dropped;		/* Messages dropped as the queue was full */
+
+	/* Transmission of the PDO's, configuration is stored in EEPROM */
+	T_can_pdo_config_t	pdo_config[CAN_PDO_LAST];
+	T_can_pdo_state_t	pdo_state[CAN_PDO_LAST];
+	sbool			config_loaded;	/* Stored configuration has been read */
+	sbool			config_store_pending;	/* Configuration changed, not yet queued for EEPROM */
+
+	/* Bit rate: stored by CAN_CMD_BITRATE, active (may be set by DIP switches or fallback) */
+	Uint8			bitrate_stored;		/* E_can_bitrate_t */
+	Uint8			bitrate;			/* E_can_bitrate_t */
+	sbool			bitrate_fallback;	/* Default bit rate is used as bus stayed error-passive */
+	Uint16			passive_counter;	/* 100Hz ticks the bus is error-passive */
+
+	T_can_errors_t	errors;
+
+	/* PDO layout (E_can_pdo_layout_t) and frequency of the compact PDO */
+	Uint8			pdo_layout;
+	Uint8			compact_freq;
+
+	/* SYNC: counted by the CAN interrupt, PDO's are evaluated by the PDO task
+		at every 100Hz tick (tick_pass), after a completed batch (batch_pass) 
+		and after a SYNC (sync_pass) */
+	volatile Uint16	sync_received;
+	Uint16			sync_handled;	/* sync_received at the last PDO pass */
+	sbool			tick_pass;
+	sbool			batch_pass;
+	sbool			sync_pass;
+	Uint8			sync_timeout;	/* 100Hz ticks since the last SYNC, saturating */
 }T_can_data_t;
 
 /* Global variables */
@@ -48,6 +241,10 @@ extern clock_t t_can[5]; // C1 ISR, TX Results, TX Status, TX Raw, actual Transm
 
 /* Function declarations */
 void Can_init(void);
+void Can_process(T_can_data_t *can_data);
+sbool Can_pdo_pass(T_can_data_t *can_data, sbool tick, sbool batch);
+void Can_store(T_can_data_t *can_data);
+void Can_diagnostic(T_can_data_t *can_data, Uint8 page, Uint8 index);
 void Can_transmit_wireguid_result(const T_wireGuid_t *wire_guid_data, T_can_data_t *can_data, Uint8 *msg_content);
 void Can_transmit_wireguid_status(const T_wireGuid_t *wire_guid_data, T_can_data_t *can_data, Uint8 *msg_content);
 void Can_transmit_wireguid_raw(const T_wireGuid_t *wire_guid_data, T_can_data_t *can_data, Uint8 *msg_content);
@@ -0,0 +1,87 @@
+// 2014 - 2015
+
+/*! \file capture.h
+    \brief Contains the capture of antenna samples for offline analysis. Left
+           and right samples are recorded into RAM on a trigger, raw (A/D
+           values less the 0x800 offset) or windowed (Hanning window and
+           sign applied, the Goertzel input), and streamed through the
+           diagnostic PDO (CAN_DIAG_PAGE_CAPTURE, CAN_DIAG_PAGE_CAPTURE_DATA).
+
+           A pair is packed as two 12-bit two's complement values in 3 bytes:
+           left bits 11-4, left bits 3-0 | right bits 11-8, right bits 7-0.
+*/
+
+#ifndef __HAL_CAPTURE_H
+#define __HAL_CAPTURE_H
+
+#include "stypes.h"
+
+/* Defines */
+/* Bytes of a packed pair, pairs per streamed segment */
+#define CAPTURE_PAIR_SIZE		(3U)
+#define CAPTURE_SEGMENT_PAIRS	(2U)
+
+/* Segment numbers returned by Capture_next_segment() besides the data */
+#define CAPTURE_SEGMENT_HEADER	(0xFEU)
+#define CAPTURE_SEGMENT_NONE	(0xFFU)
+
+/* Active hooks (Capture_hook) */
+#define CAPTURE_HOOK_ADC		(0x01U)		/* Capture_adc() from the A/D interrupt */
+#define CAPTURE_HOOK_STEP		(0x02U)		/* Capture_step() from ANT_Step() */
+
+/* Typedefs */
+/* Command byte 1 */
+typedef enum
+{
+	CAPTURE_MODE_RAW = 0,		/* A/D samples */
+	CAPTURE_MODE_WINDOWED,		/* Goertzel input, from the window start on */
+	CAPTURE_MODE_STOP,			/* Abort recording or streaming */
+	CAPTURE_MODE_RESEND,		/* Stream the last capture again */
+	CAPTURE_MODE_LAST
+} E_capture_mode_t;
+
+/* Command byte 2 */
+typedef enum
+{
+	CAPTURE_TRIGGER_NOW = 0,	/* Next sample (raw mode), else the next window start */
+	CAPTURE_TRIGGER_WINDOW,		/* Next window start */
+	CAPTURE_TRIGGER_LOST,		/* A window whose batch lost a valid deviation; every
+									other window is recorded while waiting */
+	CAPTURE_TRIGGER_LAST
+} E_capture_trigger_t;
+
+typedef enum
+{
+	CAPTURE_STATE_IDLE = 0,
+	CAPTURE_STATE_WAIT_WINDOW,	/* Armed, waiting for the window start */
+	CAPTURE_STATE_RECORDING,
+	CAPTURE_STATE_CHECK,		/* Window recorded, waiting for its batch (CAPTURE_TRIGGER_LOST) */
+	CAPTURE_STATE_STREAMING,
+	CAPTURE_STATE_DONE			/* Streamed, kept for CAPTURE_MODE_RESEND */
+} E_capture_state_t;
+
+typedef struct
+{
+	volatile Uint8	state;			/* E_capture_state_t */
+	Uint8			mode;			/* E_capture_mode_t */
+	Uint8			trigger;		/* E_capture_trigger_t */
+	Uint8			pairs;			/* Pairs to record */
+	volatile Uint8	count;			/* Pairs recorded */
+	Uint8			segment;		/* Next streamed segment, CAPTURE_SEGMENT_HEADER first */
+	Uint32			start;			/* ADC sample counter of the first pair */
+} T_capture_t;
+
+/* Global variables */
+extern volatile Uint8 Capture_hook;
+
+/* Function declarations */
+void Capture_init(void);
+void Capture_command(const Uint8 *param);
+void Capture_adc(int16 left, int16 right);
+void Capture_step(int16 rawLeft, int16 rawRight, int16 winLeft, int16 winRight);
+void Capture_batch(Uint32 window_end, sbool lost);
+Uint8 Capture_next_segment(void);
+const T_capture_t *Capture_state(void);
+void Capture_segment(Uint8 segment, Uint8 *content);
+
+#endif // End of __HAL_CAPTURE_H definition
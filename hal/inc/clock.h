@@ -20,7 +20,6 @@
  *  10 kHz: 1999
  */
 #define   TIMECOUNTER_1000MSEC 1000
-#define   TIMECOUNTER_10MSEC   10
 
 void Clock_init(void);
 
@@ -9,13 +9,56 @@
 
 #include "stypes.h"
 
+/* Number of writes that can be queued for the write engine */
+#define EEPROM_QUEUE_SIZE	(12)
+
+/* An EEPROM row is erased and written in one operation */
+#define EEPROM_ROW_WORDS	(16)
+#define EEPROM_ROW_SIZE		(2*EEPROM_ROW_WORDS)
+
+/* Completion callback of a queued write. It is called from the NVM interrupt,
+   or directly from the queueing function when the data is already stored (for a
+   record: when the payload is unchanged), before that function returns. So it
+   shall be short, and the caller sets its state before queueing. It may queue a
+   new write. */
+typedef void (*T_eeprom_callback_t)(Uint16 tag, sbool success);
+
+typedef struct{
+	Uint32					address;
+	Uint16					data;
+	const Uint16			*row;		/* EEPROM_ROW_WORDS words for a row write, NULL for a word write */
+	Uint16					tag;		/* Passed to the callback, identifies the write */
+	T_eeprom_callback_t	callback;	/* May be NULL */
+} T_eeprom_request_t;
+
+typedef enum{
+	EEPROM_ENGINE_IDLE = 0,	/* No write ongoing */
+	EEPROM_ENGINE_CHECK,		/* Skipping requests whose data is already stored */
+	EEPROM_ENGINE_ERASE,		/* Erase of the head request started */
+	EEPROM_ENGINE_WRITE		/* Write of the head request started */
+} E_eeprom_engine_state_t;
+
+typedef enum{
+	EEPROM_SELFTEST_NOT_RUN = 0,
+	EEPROM_SELFTEST_BUSY,
+	EEPROM_SELFTEST_PASSED,
+	EEPROM_SELFTEST_FAILED
+} E_eeprom_selftest_t;
+
 /* Global variables */
 typedef struct{
-	Uint16    wait_read_counter;
-	Uint16    write_enable;
-	Uint16    read_enable;
-	Uint32    read_address;
-	Uint32    write_address;
+	/* Self-test, started on request */
+	volatile E_eeprom_selftest_t	selftest_status;
+	Uint16					selftest_pattern;
+
+	/* Write engine, advanced by the NVM interrupt */
+	T_eeprom_request_t		queue[EEPROM_QUEUE_SIZE];
+	Uint16					queue_head;
+	Uint16					queue_count;
+	E_eeprom_engine_state_t	engine_state;
+	Uint16					retry_count;	/* Erase-write attempts of the head request */
+	Uint16					writes_done;
+	Uint16					writes_failed;
 } T_eeprom_data_t;
 
 typedef enum{
@@ -38,9 +81,16 @@ typedef enum{
 /* Function declarations */
 void  eeprom_init(T_eeprom_data_t *eeprom_data);
 Uint16 eeprom_read_word(Uint32 read_address);
+void eeprom_read_row(Uint32 row_address, Uint16 *row_data);
 sbool eeprom_write_word(Uint32 write_address, Uint16 word_to_write);
-void eeprom_test_read_write(T_eeprom_data_t *eeprom_data);
+sbool eeprom_write_word_async(Uint32 write_address, Uint16 word_to_write,
+							  T_eeprom_callback_t callback, Uint16 tag);
+sbool eeprom_write_row_async(Uint32 row_address, const Uint16 *row_data,
+							 T_eeprom_callback_t callback, Uint16 tag);
+sbool eeprom_write_busy(void);
+void eeprom_self_test(T_eeprom_data_t *eeprom_data);
 Uint32 eeprom_get_read_write_address(E_eeprom_ID_t eeprom_ID);
+Uint16 eeprom_read_legacy(E_eeprom_ID_t eeprom_ID);
 
 #endif // End of __HAL_EEPROM_H definition
 
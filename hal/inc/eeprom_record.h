@@ -0,0 +1,41 @@
+// 2014 - 2015
+
+/*! \file eeprom_record.h
+    \brief Contains declarations of the EEPROM record store. Each record type
+           owns a partition of EEPROM rows. A record is written as a whole row
+           to the next slot of its partition, the newest valid record is used.
+*/
+
+#ifndef __HAL_EEPROM_RECORD_H
+#define __HAL_EEPROM_RECORD_H
+
+#include "stypes.h"
+#include "eeprom.h"
+
+/* Row layout of a record: header, sequence number, payload, CRC */
+#define EEPROM_RECORD_PAYLOAD_WORDS	(EEPROM_ROW_WORDS - 3)
+
+typedef enum{
+	EEPROM_RECORD_CALIB = 0,	/* Calibration parameters left/right antenna */
+	EEPROM_RECORD_FREQS,		/* User-defined Input Frequency values */
+	EEPROM_RECORD_CAN,			/* CAN bit rate, transmission of the PDO's */
+	EEPROM_RECORD_PARAM,		/* Wire guidance runtime parameters */
+	EEPROM_RECORD_LUT,			/* Deviation lookup table */
+	EEPROM_RECORD_LAST
+} E_eeprom_record_t;
+
+typedef struct{
+	Uint16	header;			/* EEPROM_RECORD_MAGIC | record type */
+	Uint16	sequence;		/* Incremented for every write, newest record has highest */
+	Uint16	payload[EEPROM_RECORD_PAYLOAD_WORDS];
+	Uint16	crc;			/* CRC-16 of the words above */
+} T_eeprom_record_t;
+
+/* Function declarations */
+void eeprom_record_init(void);
+sbool eeprom_record_load(E_eeprom_record_t record, Uint16 *payload, Uint16 nbr_words);
+sbool eeprom_record_store(E_eeprom_record_t record, const Uint16 *payload, Uint16 nbr_words,
+						  T_eeprom_callback_t callback, Uint16 tag);
+sbool eeprom_record_busy(E_eeprom_record_t record);
+
+#endif // End of __HAL_EEPROM_RECORD_H definition
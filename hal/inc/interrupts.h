@@ -9,7 +9,50 @@
 #ifndef __HAL_INTERRUPTS_H
 #define __HAL_INTERRUPTS_H
 
+#include "stypes.h"
+
+/* Defines */
+/* Interrupt priority plan (7 highest). The short interrupts with timing
+   requirements are above the A/D interrupt, which runs a Goertzel step per
+   sample; with INT_NESTING they preempt it. All priorities stay below 7, so
+   the DISI instruction of the EEPROM write sequence still covers them. */
+#define INT_PRIORITY_T1			(6)		/* 1 msec tick, scheduler time base */
+#define INT_PRIORITY_C1			(5)		/* CAN receive FIFO, transmit queue, SYNC */
+#define INT_PRIORITY_ADC		(4)		/* Samples, Goertzel step */
+#define INT_PRIORITY_CN			(2)		/* Node ID DIP switches */
+#define INT_PRIORITY_NVM		(2)		/* EEPROM erase/write completion */
+#define INT_PRIORITY_MAIN		(1)		/* CPU priority of the scheduler */
+
+/* Entry latency histogram: bin 0 < 16 TCY, bin n from 2^(n+3) TCY, the last
+   bin from 1024 TCY (51.2 usec) on */
+#define INT_LATENCY_BINS		(8)
+
+/* Timer1 entry latency bound [TCY] */
+#define INT_T1_LATENCY_MAX		((Uint16)((INT_T1_JITTER_MAX_USEC * 1000UL) / TCY_NANOSEC))
+
+/* Typedefs */
+/* Interrupts with entry latency measurement */
+typedef enum
+{
+	INT_SOURCE_T1 = 0,		/* Latency from the period match (TMR1) */
+	INT_SOURCE_ADC,			/* Deviation of the interval from the A/D period */
+	INT_SOURCE_C1,			/* Latency from the message receipt (IC2 capture of TMR3) */
+	INT_SOURCE_LAST
+} E_int_source_t;
+
+typedef struct
+{
+	Uint16	histogram[INT_LATENCY_BINS];	/* Entries per bin, saturated */
+	Uint16	max;							/* Highest entry latency [TCY] */
+	Uint16	exceeded;						/* Entries above the bound (Timer1) */
+	Uint16	reported;						/* exceeded at the last report */
+} T_int_latency_t;
+
+/* Function declarations */
 /*! Initializes the system, incl. ADC, timers, etc. */
 void Interrupt_init(void);
+void Interrupt_latency(Uint8 source, Uint16 latency);
+const T_int_latency_t *Interrupt_latency_state(Uint8 source);
+sbool Interrupt_bound_report(void);
 
 #endif // End of __HAL_INTERRUPTS_H definition
@@ -0,0 +1,27 @@
+// 2014 - 2015
+
+/*! \file objdict.h
+    \brief Contains the object dictionary and the SDO server. The runtime
+           parameters are read and written with expedited SDO transfers
+           (CANopen CiA 301, 4 data bytes at most, no segmented transfer).
+*/
+
+#ifndef __HAL_OBJDICT_H
+#define __HAL_OBJDICT_H
+
+#include "stypes.h"
+
+/* Defines */
+/* Length of an SDO request and response */
+#define OBJDICT_SDO_LENGTH		(8)
+
+/* Object indexes */
+#define OBJDICT_DEVICE_TYPE		(0x1000U)	/* Device type, read-only */
+#define OBJDICT_STORE			(0x1010U)	/* Sub 1: write "save" to store the parameters */
+#define OBJDICT_RESTORE			(0x1011U)	/* Sub 1: write "load" to restore the defaults */
+#define OBJDICT_WG_PARAM		(0x2000U)	/* Sub 1-12: T_wg_param_t fields, in order */
+
+/* Function declarations */
+void Objdict_sdo_request(const Uint8 *request, Uint8 *response);
+
+#endif // End of __HAL_OBJDICT_H definition
@@ -0,0 +1,56 @@
+// 2014 - 2015
+
+/*! \file perf.h
+    \brief Contains the run-time performance counters. A probe measures the
+           execution time of a function in TCY with the free-running Timer2
+           and keeps min, max, mean and a log2 histogram. The counters are
+           read through the diagnostic PDO (CAN_DIAG_PAGE_PERF).
+*/
+
+#ifndef __HAL_PERF_H
+#define __HAL_PERF_H
+
+#include "stypes.h"
+
+/* Defines */
+/* Histogram: bin 0 < 64 TCY, bin n from 2^(n+5) TCY, the last bin from
+   16384 TCY (819 usec) on */
+#define PERF_BINS				(10)
+
+/* The probes of the A/D interrupt measure 1 of PERF_ADC_DECIMATION samples.
+   Being prime to the window length, all steps of the window are measured. */
+#define PERF_ADC_DECIMATION		(16U)
+
+/* Cycle stamp, Timer2 counts TCY from 0 to 0xFFFF (3.28 msec) */
+#define PERF_STAMP()			(TMR2)
+
+/* Typedefs */
+typedef enum
+{
+	PERF_PROBE_ADC_ISR = 0,		/* _ADCInterrupt (decimated) */
+	PERF_PROBE_ANT_STEP,		/* ANT_Step (decimated) */
+	PERF_PROBE_ANT_FINAL_STEP,	/* ANT_FinalStep */
+	PERF_PROBE_WIREGUID_BATCH,	/* WireGuid_batch, a completed batch */
+	PERF_PROBE_WIREGUID_PROCESS,/* WireGuid_process */
+	PERF_PROBE_CAN_TRANSMIT,	/* Can_transmit_message */
+	PERF_PROBE_C1_ISR,			/* _C1Interrupt */
+	PERF_PROBE_LAST
+} E_perf_probe_t;
+
+/* Written by the context of the probe only */
+typedef struct
+{
+	Uint16	min;					/* [TCY] */
+	Uint16	max;					/* [TCY] */
+	Uint32	sum;					/* [TCY], halved with count when count is full */
+	Uint16	count;
+	Uint16	histogram[PERF_BINS];	/* Measurements per bin, saturated */
+} T_perf_probe_t;
+
+/* Function declarations */
+void Perf_init(void);
+void Perf_record(Uint8 probe, Uint16 start);
+const T_perf_probe_t *Perf_probe(Uint8 probe);
+Uint16 Perf_mean(Uint8 probe);
+
+#endif // End of __HAL_PERF_H definition
@@ -0,0 +1,82 @@
+// 2014 - 2015
+
+/*! \file scheduler.h
+    \brief Contains the cooperative run-to-completion task scheduler. Tasks
+           are released periodically (1 msec time base of Timer1) and/or by
+           an event (Sched_signal, also from interrupts). The pending task
+           with the lowest index runs first; a task is never preempted by
+           another task.
+*/
+
+#ifndef __HAL_SCHEDULER_H
+#define __HAL_SCHEDULER_H
+
+#include "stypes.h"
+
+/* Defines */
+/* Release reasons, passed to the task */
+#define SCHED_RELEASE_PERIOD	(0x01U)
+#define SCHED_RELEASE_EVENT		(0x02U)
+
+/* The usec timebase wraps with the 16-bit msec counter */
+#define SCHED_TIME_WRAP_USEC	(65536000UL)
+
+/* Typedefs */
+/* Tasks, in order of priority (highest first) */
+typedef enum
+{
+	SCHED_TASK_BATCH = 0,	/* Event: Goertzel post-processing of a completed batch */
+	SCHED_TASK_PDO,			/* 10 msec and event (batch, SYNC): PDO transmission */
+	SCHED_TASK_CAN,			/* 10 msec: CAN start-up, received messages, error monitor */
+	SCHED_TASK_GUIDANCE,	/* 10 msec: Input Frequency configuration */
+	SCHED_TASK_BIT,			/* 10 msec: antenna reference voltages, BIT */
+	SCHED_TASK_EEPROM,		/* 100 msec: queue pending EEPROM records */
+	SCHED_TASK_DIAGNOSTIC,	/* 1 sec: CPU load, report deadline misses and overruns */
+	SCHED_TASK_LAST
+} E_sched_task_t;
+
+typedef void (*T_sched_run_t)(Uint8 release);
+
+typedef struct
+{
+	T_sched_run_t	run;
+	Uint16			period;		/* [msec], 0 for an event task */
+	Uint16			deadline;	/* [msec] from release to completion */
+} T_sched_task_t;
+
+/* Run-time statistics of a task */
+typedef struct
+{
+	volatile sbool	signalled;		/* Event received, set by Sched_signal() */
+	volatile Uint16	signal_time;	/* [msec] of the first event not yet handled */
+	sbool			released;		/* Period expired, not yet run */
+	Uint16			release_time;	/* [msec] of the period release */
+	Uint16			next_release;	/* [msec] */
+	Uint16			runs;
+	Uint16			wcet;			/* Worst-case execution time [usec] */
+	Uint8			latency_max;	/* Highest release to start time [msec] */
+	Uint16			deadline_miss;	/* Completed later than the deadline */
+	Uint16			overrun;		/* Periods skipped as the task was still pending */
+	Uint16			reported;		/* deadline_miss + overrun at the last report */
+} T_sched_state_t;
+
+/* CPU load, measured as the time the scheduler idles */
+typedef struct
+{
+	Uint32			idle_usec;		/* Idle time in the current window [usec] */
+	Uint32			window_start;	/* [usec] */
+	Uint16			load;			/* CPU load of the last window [0.1 %] */
+	Uint16			load_max;		/* Highest load of a window [0.1 %] */
+	Uint16			idle_entries;	/* Idle mode entries in the last window */
+	Uint16			entries;		/* Idle mode entries in the current window */
+} T_sched_load_t;
+
+/* Function declarations */
+void Sched_init(void);
+void Sched_run(void);
+void Sched_signal(Uint8 task);
+const T_sched_state_t *Sched_state(Uint8 task);
+Uint8 Sched_report_next(void);
+const T_sched_load_t *Sched_load(void);
+
+#endif // End of __HAL_SCHEDULER_H definition
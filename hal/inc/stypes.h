@@ -7,12 +7,23 @@
 #define __STYPES_H
 
 /* typecast standard types */
+#ifdef HOST_BUILD
+/* Host build of the guidance code (host/), sizes as on the dsPIC */
+#include <stdint.h>
+typedef char            int8;
+typedef int16_t         int16;
+typedef int32_t         int32;
+typedef uint8_t         Uint8;
+typedef uint16_t        Uint16;
+typedef uint32_t        Uint32;
+#else
 typedef char            int8;
 typedef int             int16;
 typedef long            int32;
 typedef unsigned char   Uint8;
 typedef unsigned int    Uint16;
 typedef unsigned long   Uint32;
+#endif
 
 /* Make a boolean type and add TRUE/FALSE (if not defined by processor) */
 #define true            (1)
@@ -20,8 +31,10 @@ typedef unsigned long   Uint32;
 typedef char            sbool;
 
 /* special defines, related to type */
+#ifndef INT16_MAX
 #define  INT16_MAX       (32767)
 #define  INT16_MIN       (-32768)
+#endif
 
 #define  UINT16_INVALID  (65535)
 
@@ -15,12 +15,18 @@
 
 /* Real-time clock */
 typedef struct {
-  Uint16    puls_100Hz;     /* Every 100Hz, set to 1 */
-  Uint16    ticks_10msec;   /* relative time    [msec] */
   Uint16    ticks_1msec;    /* relative time    [msec] */
   Uint16    ticks_1sec;     /* absolute time    [sec] */
+  Uint16    ticks_boot_msec;  /* time since start-up [msec], stops at 0xFFFF */
+  volatile Uint16 ticks_free_msec;  /* free-running time [msec], scheduler time base */
 }T_clockTimer_t;
 
+/* Start-up timing, [msec] since start-up */
+typedef struct {
+  Uint16    can_ready_msec;        /* CAN module in normal operation mode */
+  Uint16    first_deviation_msec;  /* First valid deviation computed, 0 while none */
+}T_bootTiming_t;
+
 /* ADC LEDs */
 typedef enum {
   LED_COLOR_GREEN = 0,
@@ -44,6 +50,7 @@ typedef struct{
   int16              		ledBlinkingTime[LED_COLOR_LAST];
   T_can_data_t		can_data;
   T_eeprom_data_t	eeprom_data;
+  T_bootTiming_t	bootTiming;
 }T_systemData_t;
 
 extern T_systemData_t    gSystemData;
@@ -10,10 +10,18 @@
 // Global variables
 int16 ADC_refVoltLeft_1;
 int16 ADC_refVoltRight_1;
+volatile Uint32 ADC_sampleCounter;
 
 // Local variables
 int16 Adc_antennaMeasLeft_1;
 int16 Adc_antennaMeasRight_1;
+#if PERF_COUNTERS
+static Uint8  AdcPerfSkip;	// A/D interrupts until the next measured one
+#endif
+#if INT_LATENCY_MONITOR
+static Uint16 AdcEntryTime;	// TMR1 at the previous interrupt entry
+static sbool  AdcEntryValid;
+#endif
 
 //*****************************************************************************
 // Local functions
@@ -93,10 +101,33 @@ void Adc_init(void)
 				  instructions*/
 	TRISBbits.TRISB9  = 0;        // Initialize AN9  as output (LED 0, green)
 	TRISBbits.TRISB10 = 0;        // Initialize AN10 as output (LED 1, red)
+
+	ADC_sampleCounter = 0UL;
+	#if PERF_COUNTERS
+	AdcPerfSkip = PERF_ADC_DECIMATION;
+	#endif
+	#if INT_LATENCY_MONITOR
+	AdcEntryValid = false;
+	#endif
   
 	return;
 }
 
+/* Adc_sample_counter() returns the number of A/D interrupts since start-up,
+   read with the A/D interrupt disabled as the counter is 32 bits. */
+Uint32 Adc_sample_counter(void)
+{
+	Uint16	ad_ie;
+	Uint32	counter;
+
+	ad_ie = IEC0bits.ADIE;
+	IEC0bits.ADIE = 0;
+	counter = ADC_sampleCounter;
+	IEC0bits.ADIE = ad_ie;
+
+	return counter;
+}
+
 //*****************************************************************************
 // Interrupt functions
 //*****************************************************************************
@@ -111,6 +142,16 @@ void Adc_init(void)
 */
 void __attribute__ ((interrupt, auto_psv)) _ADCInterrupt(void)
 {
+	#if INT_LATENCY_MONITOR
+	Uint16	entry = TMR1;
+	Uint16	interval;
+	#endif
+	#if PERF_COUNTERS
+	Uint16	perf_start = PERF_STAMP();
+	Uint16	perf_step;
+	sbool	perf = (--AdcPerfSkip == 0U);
+	#endif
+
 	/* Copy data from ADC buffer to variables, depending on the number of
 		antennas. Inputs that are scanned are set using ADCSSL-register.
 	*/
@@ -121,6 +162,19 @@ void __attribute__ ((interrupt, auto_psv)) _ADCInterrupt(void)
 	#endif
 
    LATBbits.LATB9 = 1;
+   #if INT_LATENCY_MONITOR
+   /* The conversions are not timer triggered: the entry jitter is the deviation
+      of the interval from the A/D period. Timer1 counts 0..PR1. */
+   interval = (entry >= AdcEntryTime) ? (entry - AdcEntryTime) : (entry + (PR1 + 1U) - AdcEntryTime);
+   AdcEntryTime = entry;
+   if (AdcEntryValid)
+      Interrupt_latency(INT_SOURCE_ADC, (interval > ADC_PERIOD_TCY) ?
+                        (interval - ADC_PERIOD_TCY) : (ADC_PERIOD_TCY - interval));
+   AdcEntryValid = true;
+   #endif
+
+   /* Timestamp of the samples, wraps after 79 hours at 15kHz */
+   ++ADC_sampleCounter;
    #if (NBR_ANTENNAS==1)
    ADC_refVoltLeft_1       		= (int16)ADCBUF0;
    ADC_refVoltRight_1      		= (int16)ADCBUF1;
@@ -134,10 +188,15 @@ void __attribute__ ((interrupt, auto_psv)) _ADCInterrupt(void)
 		#error "Unexpected number of antennas"
    #endif
 
+   #if SAMPLE_CAPTURE
+   if (Capture_hook & CAPTURE_HOOK_ADC)
+      Capture_adc(Adc_antennaMeasLeft_1, Adc_antennaMeasRight_1);
+   #endif
+
    #if GUIDANCE_WIRE
 		#ifdef FUNCTION_CALL // Goertzel debug time (function + call) mode
 		// Put sample in calculation
-		if (ANT_k < ANT_k_max)
+		if ((ANT_k < ANT_k_max) && !ANT_WaitSync)
 		{
 			/* ################################################################# */
 			t[0] = clock(); // start step instruction-counter
@@ -151,9 +210,18 @@ void __attribute__ ((interrupt, auto_psv)) _ADCInterrupt(void)
 					t[2] = t[0]; 	// new batch instruction-counter
 			/* ################################################################# */
 		}
+		#elif PERF_COUNTERS // Goertzel normal mode, decimated performance probe
+		// Put sample in calculation
+		if ((ANT_k < ANT_k_max) && !ANT_WaitSync)
+		{
+			perf_step = PERF_STAMP();
+			ANT_Step(Adc_antennaMeasLeft_1, Adc_antennaMeasRight_1);
+			if (perf)
+				Perf_record(PERF_PROBE_ANT_STEP, perf_step);
+		}
 		#else // Goertzel normal mode
 		// Put sample in calculation
-		if (ANT_k < ANT_k_max)
+		if ((ANT_k < ANT_k_max) && !ANT_WaitSync)
 			ANT_Step(Adc_antennaMeasLeft_1, Adc_antennaMeasRight_1);
 		#endif // end deviation calculation method loop
    #endif
@@ -162,6 +230,14 @@ void __attribute__ ((interrupt, auto_psv)) _ADCInterrupt(void)
    /* It is necessary to clear manually the interrupt flag for ADC */
    IFS0bits.ADIF = 0;
 
+   #if PERF_COUNTERS
+   if (perf)
+   {
+      AdcPerfSkip = PERF_ADC_DECIMATION;
+      Perf_record(PERF_PROBE_ADC_ISR, perf_start);
+   }
+   #endif
+
 	// End A/D interrupt instruction-counter
 	#if DBG_TIME
 	t[4] = clock() - t[4]; // Store nbr of instructions required by A/D interrupt
@@ -21,6 +21,121 @@ static const Uint16 __attribute__((space(auto_psv)))
 CAN_PDO_SID_TX_RAW = 0x0380U;
 static const Uint16 __attribute__((space(auto_psv)))
 CAN_PDO_SID_TX_SWITCH_STATES = 0x0480U;
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_PDO_SID_RX_COMMAND = 0x0400U;
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_PDO_SID_TX_DIAGNOSTIC = 0x0680U;
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_SDO_SID_RX = 0x0600U;
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_SDO_SID_TX = 0x0580U;
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_SYNC_SID = 0x0080U;
+#if SAMPLE_CAPTURE
+/* Streamed capture segments per 100Hz tick, sent when the transmit queue is empty */
+static const Uint8 __attribute__((space(auto_psv)))
+CAN_CAPTURE_SEGMENTS = 2U;
+#endif
+#if CAN_SYNC_REPHASE
+/* SYNC is lost when not received for 50*100Hz = 500msec */
+static const Uint8 __attribute__((space(auto_psv)))
+CAN_SYNC_TIMEOUT = 50U;
+#endif
+/* Maximum time to enter a requested operation mode at start-up (50*100Hz = 500msec) */
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_INIT_TIMEOUT = 50U;
+
+/* Acceptance filters. Filters 0 and 1 belong to receive buffer 0, which 
+	overflows into buffer 1; filters 2-5 belong to receive buffer 1. Spare 
+	filters repeat the command PDO. The SYNC filter is not offset by the node ID. */
+#define CAN_NBR_RX_FILTERS	(6U)
+#define CAN_RX_FILTER_SYNC	(4U)
+static const Uint16 __attribute__((space(auto_psv)))
+CanRxFilterSid[CAN_NBR_RX_FILTERS] = {
+	0x0200U,	// Start calibration
+	0x0300U,	// Configure Input Frequencies
+	0x0400U,	// Command
+	0x0600U,	// SDO request
+	0x0080U,	// SYNC
+	0x0400U
+};
+
+/* Default transmission of the PDO's, used until a configuration is stored */
+static const T_can_pdo_config_t __attribute__((space(auto_psv)))
+CanPdoDefault[CAN_PDO_LAST] = {
+	{ CAN_TX_TYPE_ON_CHANGE, 10U, 0U, 1U },	// CAN_PDO_RESULT: on change, at least every 100msec
+	{ CAN_TX_TYPE_CYCLIC, 10U, 0U, 0U },		// CAN_PDO_STATUS: 10Hz
+	{ CAN_TX_TYPE_CYCLIC, 10U, 0U, 0U },		// CAN_PDO_RAW: 10Hz
+	{ CAN_TX_TYPE_EVENT, 0U, 0U, 0U }		// CAN_PDO_SWITCHES: new switch states only
+};
+/* Words of stored configuration per PDO: type and period, inhibit time, deadband */
+#define CAN_PDO_CONFIG_WORDS	(3)
+/* Stored configuration: PDO's; bit rate, PDO layout and compact frequency */
+#define CAN_CONFIG_WORDS		(CAN_PDO_LAST * CAN_PDO_CONFIG_WORDS + 1)
+
+/* Bit timing: 10Tq per bit, CAN clock is FCY. Tq = 2 * (BRP + 1) / FCY */
+#define CAN_NBR_TQ			(10UL)
+#define CAN_FCY_HZ			(1000000000UL / TCY_NANOSEC)
+#define CAN_BRP(bitrate)	((Uint8)((CAN_FCY_HZ / (2UL * CAN_NBR_TQ * (bitrate))) - 1UL))
+#if ((CAN_FCY_HZ % (2UL * CAN_NBR_TQ * 1000000UL)) != 0)
+#error "FCY does not allow a bit rate of 1Mbps with 10Tq"
+#endif
+
+static const Uint8 __attribute__((space(auto_psv)))
+CanBitrateBrp[CAN_BITRATE_LAST] = {
+	CAN_BRP(125000UL),	// CAN_BITRATE_125K: BRP = 7 for 20MHz
+	CAN_BRP(250000UL),	// CAN_BITRATE_250K: BRP = 3
+	CAN_BRP(500000UL),	// CAN_BITRATE_500K: BRP = 1
+	CAN_BRP(1000000UL)	// CAN_BITRATE_1M:   BRP = 0
+};
+/* Bit rate without stored configuration and after fallback */
+#define CAN_BITRATE_DEFAULT		(CAN_BITRATE_250K)
+
+#if CAN_BITRATE_DIP
+/* Bit rate of the DIP switches on RF4, RF5. Switches off: stored bit rate */
+static const Uint8 __attribute__((space(auto_psv)))
+CanBitrateDip[4] = { CAN_BITRATE_LAST, CAN_BITRATE_125K, CAN_BITRATE_500K, CAN_BITRATE_1M };
+#endif
+
+/* Time the bus may stay error-passive before the default bit rate is used (200*100Hz = 2sec) */
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_ERROR_PASSIVE_TIMEOUT = 200U;
+/* Bus-off back-off time, doubled for every bus-off in sequence (10*100Hz = 100msec ... 5.12sec) */
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_BUSOFF_BACKOFF_MIN = 10U;
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_BUSOFF_BACKOFF_MAX = 512U;
+/* Running time without bus-off that ends a bus-off sequence (1000*100Hz = 10sec) */
+static const Uint16 __attribute__((space(auto_psv)))
+CAN_BUSOFF_STABLE_TIME = 1000U;
+/* Bus-off events in sequence before the default bit rate is used */
+static const Uint8 __attribute__((space(auto_psv)))
+CAN_BUSOFF_FALLBACK_COUNT = 3U;
+
+/* Register layout of a transmit buffer (CiTXnSID ... CiTXnCON) and a receive
+	buffer (CiRXnSID ... CiRXnCON). Data byte 0 is the low byte of data[0]. */
+typedef struct
+{
+	Uint16	sid;
+	Uint16	eid;
+	Uint16	dlc;
+	Uint16	data[4];
+	Uint16	con;
+}T_can_hw_buffer_t;
+
+#define CAN_NBR_TX_BUFFERS		(3U)
+#define CAN_TXCON_TXREQ			(0x0008)
+#define CAN_TXCON_TXERR			(0x0010)
+#define CAN_TXCON_TXLARB		(0x0020)
+#define CAN_TXCON_TXPRI			(0x0003)
+#define CAN_TXDLC_RESERVED		(0x0180)	/* TXRB0, TXRB1 */
+
+static volatile T_can_hw_buffer_t * const __attribute__((space(auto_psv)))
+CanTxBuffer[CAN_NBR_TX_BUFFERS] = {
+	(volatile T_can_hw_buffer_t *)&C1TX0SID,
+	(volatile T_can_hw_buffer_t *)&C1TX1SID,
+	(volatile T_can_hw_buffer_t *)&C1TX2SID
+};
 
 // Global variables
 #if DBG_TIME_CAN
@@ -30,7 +145,7 @@ clock_t t_can[5]; // C1 ISR, TX Results, TX Status, TX Raw, actual Transmit (TX)
 //*****************************************************************************
 // Static functions
 //*****************************************************************************
-/* Put can into configuration mode */
+/* Request configuration mode. Can_process() waits until it is entered. */
 static void can_set_in_config_mode(void)
 {
 	/* Request configuration mode */
@@ -38,11 +153,19 @@ static void can_set_in_config_mode(void)
   
 	/* CAN master clock is FCY */
 	C1CTRLbits.CANCKS = 1;
-  
-	/* Wait until configuration mode entered */
-	while(C1CTRLbits.OPMODE != 4)
-	{
-	}
+
+	/* Continue in Idle mode, a received message wakes the scheduler */
+	C1CTRLbits.CSIDL  = 0;
+
+	/* Capture Timer3 (IC2) at every received message, for the entry latency
+		of the CAN interrupt. IC2 is not used otherwise, its interrupt stays off. */
+	#if INT_LATENCY_MONITOR
+	C1CTRLbits.CANCAP = 1;
+	IC2CONbits.ICM    = 0;
+	IC2CONbits.ICTMR  = 0;
+	IC2CONbits.ICSIDL = 0;
+	IC2CONbits.ICM    = 1;
+	#endif
   
 	return;
 }
@@ -66,12 +189,12 @@ static void can_set_mask_rx(Uint8   mask_no, Uint16  mask)
             
 		case 1: 
 			C1RXM1SID = 0x0001;
-			C1RXM1SIDbits.SID = mask & 0x7F;
+			C1RXM1SIDbits.SID = mask & 0x7FF;
 			break;
 
 		default:
 			C1RXM0SID = 0x0001;
-			C1RXM0SIDbits.SID = mask & 0x7F;
+			C1RXM0SIDbits.SID = mask & 0x7FF;
 		break;
 	}
 	return;
@@ -128,15 +251,13 @@ static void can_set_filter_rx(Uint8   filter_no, Uint16  sid)
 }
 
 /*********************************************************************/
-/* Sets baud rate to 250Kbps with 10Tq for a clock of 20MHz
-   TODO LVDK: read DIP switches (PORTF) to set baud rate accordingly
-*/
-static void can_configure(void)
+/* Sets bit rate (E_can_bitrate_t) with 10Tq for a clock of FCY */
+static void can_configure(Uint8 bitrate)
 {
 	/*  Nominal Bit Time NBT = (SJW + PRSEG + SEG1PH + SEG2PH) * Tq = 10Tq
-		Nominal Bit Rate NBR = 1 / 10Tq = 1 / 4 usec = 250Kbps 
+		Nominal Bit Rate NBR = 1 / 10Tq, e.g. 1 / 4 usec = 250Kbps (BRP = 3, 20MHz)
 	*/
-	C1CFG1bits.BRP      	= 3;    /* 20 MHz clock */
+	C1CFG1bits.BRP      	= CanBitrateBrp[bitrate];
 	C1CFG1bits.SJW      	= 0;    /* Synchronized jump width time = 1Tq */
 	C1CFG2bits.PRSEG    	= 4;    /* Propagation time segment = 5Tq */
 	C1CFG2bits.SEG1PH   	= 1;    /* Phase buffer Segment 1 = 2Tq */
@@ -146,10 +267,8 @@ static void can_configure(void)
 	C1CTRLbits.REQOP    	= 0;    /* Can clock is Fcy = 20MHz. Request normal operation mode. */
 	/*  NBT = (1 + 5 + 2 + 2) * Tq = 10Tq
 		point where Sampling of bit takes place: (1 + 5 + 2) / 10 = 8 / 10 = 80%
+		Can_process() waits until normal operation mode is entered.
 	*/
-	while(C1CTRLbits.OPMODE != 0)
-	{
-	}
   
 	return;
 }
@@ -182,38 +301,83 @@ static void can_set_priority(Uint8   buffer, Uint8   priority)
 }
 
 /*************************************************************************/
-/* This function returns an available empty transmit buffer.
-   Returns: Transmit buffer number 0-2.
+/* This function writes the message identifier (SID) and the data to be
+   transmitted into a free transmit buffer, and sets the Transmit request bit.
+   The data is written as 4 words.
+   Parameters: 	Uint8: buffer: (Transmit buffer number 0-2)
+						Pointer to the message, transmit priority
 */
-static Uint8 can_get_txbuffer(void)
+static void can_load_txbuffer(
+  Uint8					buffer,
+  const T_can_msg_t		*message,
+  Uint8					priority)
 {
-	Uint8 buffer = 0U;
+	volatile T_can_hw_buffer_t	*hw = CanTxBuffer[buffer];
+	const Uint16				*data = (const Uint16 *)message->content;
+
+	/* Divide 11 bits of sid over 2 SID's in CiTXnSID: xxxx x000 xxxx xx00 (x == 0 OR 1) */
+	hw->sid		= ((message->sid & 0x07C0) << 5) | ((message->sid & 0x003F) << 2);
+	hw->data[0]	= data[0];
+	hw->data[1]	= data[1];
+	hw->data[2]	= data[2];
+	hw->data[3]	= data[3];
+	hw->dlc		= CAN_TXDLC_RESERVED | ((Uint16)message->length << 3);
+	hw->con		= priority & CAN_TXCON_TXPRI;
+	hw->con		|= CAN_TXCON_TXREQ;
 
-	if(C1TX0CONbits.TXREQ == 0)
-	{
-		return buffer; // buffer = 0
-	}
-	else if(C1TX1CONbits.TXREQ == 0)
+	return;
+}
+
+/*************************************************************************/
+/* Returns a free transmit buffer (0-2), CAN_NBR_TX_BUFFERS if all are busy */
+static Uint8 can_free_txbuffer(void)
+{
+	Uint8	buffer;
+
+	for (buffer = 0U; buffer < CAN_NBR_TX_BUFFERS; ++buffer)
 	{
-		buffer = 1U;
+		if ((CanTxBuffer[buffer]->con & CAN_TXCON_TXREQ) == 0U)
+			break;
 	}
-	else if(C1TX2CONbits.TXREQ == 0)
+
+	return buffer;
+}
+
+/*************************************************************************/
+/* Move queued messages to the free transmit buffers, highest priority first.
+   Called from the CAN interrupt (TX done) and with the CAN interrupt disabled. */
+static void can_tx_fill_buffers(T_can_data_t *can_data)
+{
+	Uint8	ix;
+	Uint8	buffer;
+
+	while (can_data->tx_queue_count > 0U)
 	{
-		buffer = 2U;
+		buffer = can_free_txbuffer();
+		if (buffer == CAN_NBR_TX_BUFFERS)
+			break;
+		can_load_txbuffer(buffer, &(can_data->tx_queue[0].msg), can_data->tx_queue[0].priority);
+
+		/* Remove first entry */
+		--can_data->tx_queue_count;
+		for (ix = 0U; ix < can_data->tx_queue_count; ++ix)
+			can_data->tx_queue[ix] = can_data->tx_queue[ix + 1U];
 	}
 
-	return buffer;
+	return;
 }
 
 /*********************************************************************/
-/* This function writes the message identifier(SID), writes the data to be
-   transmitted into the Transmit buffer and sets the corresponding Transmit
-   request bit.
+/* This function adds a message to the transmit queue, behind the messages of 
+   the same or higher priority, and loads free transmit buffers. When the queue 
+   is full, the message with the lowest priority is dropped.
 
    Parameters: Pointer to structure T_can_msg_t defined in can.h
+					 Transmit priority
 */
-static void Can_transmit_message(
-  const T_can_msg_t *message)
+static void can_transmit_queue(
+  const T_can_msg_t		*message,
+  E_can_tx_priority_t	priority)
 {
 	/* Implement internal timer for Transmission function */
 	// start step instruction-counter
@@ -221,49 +385,60 @@ static void Can_transmit_message(
 	t_can[4] = clock();
 	#endif
 
-	Uint8   buffer;
-	Uint16  ix;
+	T_can_data_t	*can_data = &(gSystemData.can_data);
+	Uint8			ix;
+	Uint16			c1_ie;
+	Uint8			buffer;
 
-	/* Divide 11 bits of sid over 2 SID's in CiTXnSID */
-	ix = ((message->sid & 0x07C0) << 5) | ((message->sid & 0x003F) << 2); // result: ix = xxxx x000 xxxx xx00 (x == 0 OR 1)
-	buffer = can_get_txbuffer();
+	/* Nothing is transmitted before the CAN module is started */
+	if (can_data->state != CAN_STATE_RUNNING)
+		return;
 
-	switch(buffer)
+	/* The queue is shared with the CAN interrupt */
+	c1_ie = IEC1bits.C1IE;
+	IEC1bits.C1IE = 0;
+
+	/* Nothing queued and a transmit buffer free: load it without queueing */
+	if (can_data->tx_queue_count == 0U)
 	{
-		case 0:	C1TX0SID = ix;
-					// Reset ix variable and use it as index of the message (range 0 ... 7)
-					for(ix = 0U; ix < message->length; ++ix)
-						*((Uint8 *)&C1TX0B1+ix)= message->content[ix];
-					C1TX0DLC = 0x0180;
-					C1TX0DLCbits.DLC = message->length;
-					C1TX0CONbits.TXREQ = 1;
-					break;
-					
-		case 1:	C1TX1SID = ix;
-					// Reset ix variable and use it as index of the message (range 0 ... 7)
-					for(ix = 0U; ix < message->length; ++ix)
-						*((Uint8 *)&C1TX1B1+ix)= message->content[ix];
-					C1TX1DLC = 0x0180;
-					C1TX1DLCbits.DLC = message->length;
-					C1TX1CONbits.TXREQ = 1;
-					break;
-					
-		case 2:	 C1TX2SID = ix;
-					// Reset ix variable and use it as index of the message (range 0 ... 7)
-					for(ix = 0U; ix < message->length; ++ix)
-						*((Uint8 *)&C1TX2B1+ix)= message->content[ix];
-					C1TX2DLC = 0x0180;	
-					C1TX2DLCbits.DLC = message->length;
-					C1TX2CONbits.TXREQ = 1;
-					break;
-					
-		default:	C1TX0SID = ix;
-					// Reset ix variable and use it as index of the message (range 0 ... 7)
-					for(ix = 0U; ix < message->length; ++ix)
-						*((Uint8 *)&C1TX0B1+ix)= message->content[ix];
-					break;
+		buffer = can_free_txbuffer();
+		if (buffer != CAN_NBR_TX_BUFFERS)
+		{
+			can_load_txbuffer(buffer, message, (Uint8)priority);
+			IEC1bits.C1IE = c1_ie;
+			return;
+		}
+	}
+
+	if (can_data->tx_queue_count == CAN_TX_QUEUE_SIZE)
+	{
+		++can_data->tx_dropped;
+		/* Drop the new message, unless it has a higher priority than the last one */
+		if (can_data->tx_queue[CAN_TX_QUEUE_SIZE - 1U].priority >= (Uint8)priority)
+		{
+			IEC1bits.C1IE = c1_ie;
+			return;
+		}
+		--can_data->tx_queue_count;
 	}
 
+	/* Insert behind the messages of the same or higher priority */
+	ix = can_data->tx_queue_count;
+	while ((ix > 0U) && (can_data->tx_queue[ix - 1U].priority < (Uint8)priority))
+	{
+		can_data->tx_queue[ix] = can_data->tx_queue[ix - 1U];
+		--ix;
+	}
+	can_data->tx_queue[ix].msg		= *message;
+	can_data->tx_queue[ix].priority	= (Uint8)priority;
+	++can_data->tx_queue_count;
+	if (can_data->tx_queue_count > can_data->tx_queue_max)
+		can_data->tx_queue_max = can_data->tx_queue_count;
+
+	can_tx_fill_buffers(can_data);
+
+	IEC1bits.C1IE = c1_ie;
+
 	/*  End timer of Transmission function */
 	#ifdef FUNCTION_INTERNAL_CAN
 	t_can[4] = clock() - t_can[4];
@@ -273,46 +448,926 @@ static void Can_transmit_message(
 }
 
 /*************************************************************************/
-/* If a message has been received, read the data from the receive buffer into 
-   the structure T_can_msg_t and clear the RXFUL bit. */
-static void Can_receive_message(
-  E_can_rx_buffer_t   buffer_id,
-  Uint8              *msg_content)
+/* Can_transmit_message() queues a message, see can_transmit_queue() */
+static void Can_transmit_message(
+  const T_can_msg_t		*message,
+  E_can_tx_priority_t	priority)
 {
-	Uint8         ix;
-	Uint16		check;
-	T_can_msg_t  *message;
+	#if PERF_COUNTERS
+	Uint16	perf_start = PERF_STAMP();
+	#endif
 
-	message = &(gSystemData.can_data.can_rx_msg_buffer[buffer_id]);
+	can_transmit_queue(message, priority);
 
-	switch(buffer_id)
+	#if PERF_COUNTERS
+	Perf_record(PERF_PROBE_CAN_TRANSMIT, perf_start);
+	#endif
+
+	return;
+}
+
+/*************************************************************************/
+/* Copy a received message from the receive buffer into the receive FIFO. The
+   caller clears the RXFUL bit. Messages are processed by Can_process(). A SYNC
+   is handled at once: it is counted and (re-phase) starts the next window. */
+static void can_rx_read(
+  T_can_data_t						*can_data,
+  const volatile T_can_hw_buffer_t	*hw)
+{
+	T_can_msg_t		*message;
+	Uint16			*data;
+
+	if (((hw->sid >> 2) & 0x07FF) == CAN_SYNC_SID)
 	{
-		case 0:	message->sid    = (C1RX0SID >> 2) & 0x07ff;
-					message->length = C1RX0DLCbits.DLC;
-					for(ix = 0U; ix < message->length; ++ix)
-						msg_content[ix] = *((Uint8 *)&C1RX0B1 + ix);
-					break;
-			
-		case 1: message->sid    = (C1RX1SID >> 2) & 0x07ff;
-					message->length = C1RX1DLCbits.DLC;
-					for(ix = 0U; ix < message->length; ++ix)
-						msg_content[ix] = *((Uint8 *)&C1RX1B1 + ix);
-					break;
-					
-		default: break;
+		++can_data->sync_received;
+		#if CAN_SYNC_REPHASE
+		ANT_Sync_Start();
+		#endif
+		Sched_signal(SCHED_TASK_PDO);
+		return;
+	}
+
+	if (can_data->rx_fifo_count == CAN_RX_FIFO_SIZE)
+	{
+		++can_data->rx_dropped;
+		return;
+	}
+
+	message = &(can_data->rx_fifo[(can_data->rx_fifo_head + can_data->rx_fifo_count) % CAN_RX_FIFO_SIZE]);
+	data = (Uint16 *)message->content;
+
+	message->sid	= (hw->sid >> 2) & 0x07FF;
+	message->length	= (Uint8)(hw->dlc & 0x000F);
+	if (message->length > 8U)
+		message->length = 8U;
+	data[0] = hw->data[0];
+	data[1] = hw->data[1];
+	data[2] = hw->data[2];
+	data[3] = hw->data[3];
+
+	++can_data->rx_fifo_count;
+	if (can_data->rx_fifo_count > can_data->rx_fifo_max)
+		can_data->rx_fifo_max = can_data->rx_fifo_count;
+
+	return;
+}
+
+/*************************************************************************/
+/* Configure the CAN module, once configuration mode is entered, and request
+   normal operation mode. */
+static void can_setup(Uint8 bitrate)
+{
+	Uint8	ix;
+
+	/* Receive buffer 0 status and control register
+		- Receive buffer 0 overflows into receive buffer 1 */
+	C1RX0CONbits.DBEN = 1;
+  
+	/* Transmit buffer n Standard identifier
+		- Enable filter for standard identifier */
+	C1TX0SIDbits.TXIDE = 0;
+	C1TX1SIDbits.TXIDE = 0;
+	C1TX2SIDbits.TXIDE = 0;
+
+	/* Reset receive buffer */
+	C1RX0B1 = 0;
+	C1RX0B2 = 0;
+	C1RX0B3 = 0;
+	C1RX0B4 = 0;
+  
+	/* Set masks and filters: all bits of the identifier are compared */
+	can_set_mask_rx(0U,0x07FFU);
+	can_set_mask_rx(1U,0x07FFU);
+
+	for (ix = 0U; ix < CAN_NBR_RX_FILTERS; ++ix)
+	{
+		if (ix == CAN_RX_FILTER_SYNC)
+			can_set_filter_rx(ix, CanRxFilterSid[ix]);
+		else
+			can_set_filter_rx(ix, CanRxFilterSid[ix] + (Uint16)(gSystemData.can_data.nodeID_DIP));
 	}
 
-	check = message->sid - (Uint16)gSystemData.can_data.nodeID_DIP;
+	can_set_priority(0U,2U);
+	can_set_priority(1U,2U);
+	can_set_priority(2U,2U);
+  
+	can_configure(bitrate);
+
+	return;
+}
+
+/*************************************************************************/
+/* Counter saturated to 8 bits, for diagnostic pages */
+static Uint8 can_sat8(Uint16 counter)
+{
+	return (counter > 0x00FFU) ? 0xFFU : (Uint8)counter;
+}
+
+/*************************************************************************/
+/* Transmit a diagnostic page, index selects the item of a page with items:
+	- msg: [0x68n  8  page, page content (7 bytes)] */
+static void can_transmit_diagnostic(T_can_data_t *can_data, Uint8 page, Uint8 index)
+{
+	T_can_msg_t    *can_msg;
+	Uint8          *msg_content;
+	Uint32         timestamp;
+	Uint32         age;
+	const T_sched_state_t *sched;
+	const T_sched_load_t *load;
+	const T_int_latency_t *latency;
+	const T_perf_probe_t *perf;
+	#if SAMPLE_CAPTURE
+	const T_capture_t *capture;
+	#endif
+	#if DEVIATION_LUT
+	const T_wireGuid_t *lut_data;
+	#endif
+	Uint16         mean;
+	Uint8          bin;
+
+	can_msg  	= &(can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_4]);
+	msg_content	= can_msg->content;
+
+	can_msg->sid   	= CAN_PDO_SID_TX_DIAGNOSTIC + (Uint16)can_data->nodeID_DIP;
+	can_msg->length 	= 8U;
+
+	msg_content[0] = page;
+	switch (page)
+	{
+		case CAN_DIAG_PAGE_BOOT:
+			/* Start-up time until first valid deviation, until CAN started [msec] */
+			msg_content[1] = (Uint8)(gSystemData.bootTiming.first_deviation_msec >> 8);
+			msg_content[2] = (Uint8)(gSystemData.bootTiming.first_deviation_msec & 0x00FF);
+			msg_content[3] = (Uint8)(gSystemData.bootTiming.can_ready_msec >> 8);
+			msg_content[4] = (Uint8)(gSystemData.bootTiming.can_ready_msec & 0x00FF);
+			msg_content[5] = can_data->init_retries;
+			msg_content[6] = (Uint8)gSystemData.eeprom_data.selftest_status;
+			msg_content[7] = 0x00U;
+			break;
+
+		case CAN_DIAG_PAGE_TX_QUEUE:
+			/* Queued messages now, highest number of queued messages, dropped messages */
+			msg_content[1] = can_data->tx_queue_count;
+			msg_content[2] = can_data->tx_queue_max;
+			msg_content[3] = (Uint8)(can_data->tx_dropped >> 8);
+			msg_content[4] = (Uint8)(can_data->tx_dropped & 0x00FF);
+			msg_content[5] = 0x00U;
+			msg_content[6] = 0x00U;
+			msg_content[7] = 0x00U;
+			break;
+
+		case CAN_DIAG_PAGE_RX:
+			/* Receive buffer overruns, FIFO dropped messages and highest depth, 
+				invalid messages, error interrupts */
+			msg_content[1] = (Uint8)(can_data->rx_overrun >> 8);
+			msg_content[2] = (Uint8)(can_data->rx_overrun & 0x00FF);
+			msg_content[3] = can_sat8(can_data->rx_dropped);
+			msg_content[4] = can_data->rx_fifo_max;
+			msg_content[5] = can_sat8(can_data->invalid_msg);
+			msg_content[6] = (Uint8)(can_data->error_irq >> 8);
+			msg_content[7] = (Uint8)(can_data->error_irq & 0x00FF);
+			break;
+
+		case CAN_DIAG_PAGE_ERRORS:
+			/* Transmit and receive error counter, highest transmit error counter,
+				bus-off, error-passive, retransmissions, lost arbitration (saturated) */
+			msg_content[1] = (Uint8)(C1EC >> 8);
+			msg_content[2] = (Uint8)(C1EC & 0x00FF);
+			msg_content[3] = can_data->errors.tec_max;
+			msg_content[4] = can_sat8(can_data->errors.bus_off);
+			msg_content[5] = can_sat8(can_data->errors.error_passive);
+			msg_content[6] = can_sat8(can_data->errors.retransmissions);
+			msg_content[7] = can_sat8(can_data->errors.lost_arbitration);
+			break;
+
+		case CAN_DIAG_PAGE_TIMESTAMP:
+			/* ADC sample counter at the end of the window of the last computed
+				deviations, age of that window now (ADC samples, saturated), 
+				window length (ADC samples) */
+			timestamp = gGuidanceData.wireGuidData.window_end;
+			age = Adc_sample_counter() - timestamp;
+			msg_content[1] = (Uint8)(timestamp >> 24);
+			msg_content[2] = (Uint8)(timestamp >> 16);
+			msg_content[3] = (Uint8)(timestamp >> 8);
+			msg_content[4] = (Uint8)(timestamp & 0x000000FF);
+			if (age > 0xFFFFUL)
+				age = 0xFFFFUL;
+			msg_content[5] = (Uint8)(age >> 8);
+			msg_content[6] = (Uint8)(age & 0x000000FF);
+			msg_content[7] = ANT_k_max;
+			break;
+
+		case CAN_DIAG_PAGE_SCHED:
+			/* Task, worst-case execution time [usec], deadline misses, overruns
+				(saturated), highest release to start latency [msec] */
+			if (index >= SCHED_TASK_LAST)
+				index = SCHED_TASK_LAST - 1U;
+			sched = Sched_state(index);
+			msg_content[1] = index;
+			msg_content[2] = (Uint8)(sched->wcet >> 8);
+			msg_content[3] = (Uint8)(sched->wcet & 0x00FF);
+			msg_content[4] = (Uint8)(sched->deadline_miss >> 8);
+			msg_content[5] = (Uint8)(sched->deadline_miss & 0x00FF);
+			msg_content[6] = can_sat8(sched->overrun);
+			msg_content[7] = sched->latency_max;
+			break;
+
+		case CAN_DIAG_PAGE_LOAD:
+			/* CPU load of the last second and highest load [0.1 %], Idle mode
+				entries in the last second, Idle mode enabled */
+			load = Sched_load();
+			msg_content[1] = (Uint8)(load->load >> 8);
+			msg_content[2] = (Uint8)(load->load & 0x00FF);
+			msg_content[3] = (Uint8)(load->load_max >> 8);
+			msg_content[4] = (Uint8)(load->load_max & 0x00FF);
+			msg_content[5] = (Uint8)(load->idle_entries >> 8);
+			msg_content[6] = (Uint8)(load->idle_entries & 0x00FF);
+			msg_content[7] = (Uint8)SCHED_IDLE;
+			break;
+
+		case CAN_DIAG_PAGE_INT:
+			/* Interrupt, highest entry latency [TCY], entries above the bound
+				(Timer1), priority, nesting enabled */
+			if (index >= INT_SOURCE_LAST)
+				index = INT_SOURCE_LAST - 1U;
+			latency = Interrupt_latency_state(index);
+			msg_content[1] = index;
+			msg_content[2] = (Uint8)(latency->max >> 8);
+			msg_content[3] = (Uint8)(latency->max & 0x00FF);
+			msg_content[4] = (Uint8)(latency->exceeded >> 8);
+			msg_content[5] = (Uint8)(latency->exceeded & 0x00FF);
+			msg_content[6] = (index == INT_SOURCE_T1) ? INT_PRIORITY_T1 :
+								((index == INT_SOURCE_ADC) ? INT_PRIORITY_ADC : INT_PRIORITY_C1);
+			msg_content[7] = (Uint8)INT_NESTING;
+			break;
+
+		case CAN_DIAG_PAGE_INT_HIST:
+			/* Item, 3 bins of the entry latency histogram from bin 3 * part */
+			if ((index & 0x0FU) >= INT_SOURCE_LAST)
+				index = (index & 0xF0U) | (INT_SOURCE_LAST - 1U);
+			latency = Interrupt_latency_state(index & 0x0FU);
+			msg_content[1] = index;
+			for (bin = 0U; bin < 3U; ++bin)
+			{
+				if (((index >> 4) * 3U + bin) < INT_LATENCY_BINS)
+				{
+					msg_content[2U + 2U * bin] = (Uint8)(latency->histogram[(index >> 4) * 3U + bin] >> 8);
+					msg_content[3U + 2U * bin] = (Uint8)(latency->histogram[(index >> 4) * 3U + bin] & 0x00FF);
+				}
+				else
+				{
+					msg_content[2U + 2U * bin] = 0x00U;
+					msg_content[3U + 2U * bin] = 0x00U;
+				}
+			}
+			break;
+
+		case CAN_DIAG_PAGE_PERF:
+			/* Probe, min, max and mean execution time [TCY] */
+			if (index >= PERF_PROBE_LAST)
+				index = PERF_PROBE_LAST - 1U;
+			perf = Perf_probe(index);
+			mean = Perf_mean(index);
+			msg_content[1] = index;
+			msg_content[2] = (Uint8)(perf->min >> 8);
+			msg_content[3] = (Uint8)(perf->min & 0x00FF);
+			msg_content[4] = (Uint8)(perf->max >> 8);
+			msg_content[5] = (Uint8)(perf->max & 0x00FF);
+			msg_content[6] = (Uint8)(mean >> 8);
+			msg_content[7] = (Uint8)(mean & 0x00FF);
+			break;
+
+		case CAN_DIAG_PAGE_PERF_HIST:
+			/* Item, 3 bins of the execution time histogram from bin 3 * part */
+			if ((index & 0x0FU) >= PERF_PROBE_LAST)
+				index = (index & 0xF0U) | (PERF_PROBE_LAST - 1U);
+			perf = Perf_probe(index & 0x0FU);
+			msg_content[1] = index;
+			for (bin = 0U; bin < 3U; ++bin)
+			{
+				if (((index >> 4) * 3U + bin) < PERF_BINS)
+				{
+					msg_content[2U + 2U * bin] = (Uint8)(perf->histogram[(index >> 4) * 3U + bin] >> 8);
+					msg_content[3U + 2U * bin] = (Uint8)(perf->histogram[(index >> 4) * 3U + bin] & 0x00FF);
+				}
+				else
+				{
+					msg_content[2U + 2U * bin] = 0x00U;
+					msg_content[3U + 2U * bin] = 0x00U;
+				}
+			}
+			break;
+
+		#if SAMPLE_CAPTURE
+		case CAN_DIAG_PAGE_CAPTURE:
+			/* State, mode | trigger << 4, recorded pairs, ADC sample counter of
+				the first pair */
+			capture = Capture_state();
+			msg_content[1] = capture->state;
+			msg_content[2] = capture->mode | (Uint8)(capture->trigger << 4);
+			msg_content[3] = capture->count;
+			msg_content[4] = (Uint8)(capture->start >> 24);
+			msg_content[5] = (Uint8)(capture->start >> 16);
+			msg_content[6] = (Uint8)(capture->start >> 8);
+			msg_content[7] = (Uint8)(capture->start & 0x000000FF);
+			break;
+
+		case CAN_DIAG_PAGE_CAPTURE_DATA:
+			/* Segment, pairs 2 * segment and 2 * segment + 1 */
+			msg_content[1] = index;
+			Capture_segment(index, &msg_content[2]);
+			break;
+		#endif
+
+		#if DEVIATION_LUT
+		case CAN_DIAG_PAGE_LUT:
+			/* Status of the extended calibration, Input Frequency of the table
+				(0xFF without a valid table), references, span of the stored table,
+				point (item) */
+			lut_data = &(gGuidanceData.wireGuidData);
+			msg_content[1] = (Uint8)lut_data->lut_status;
+			msg_content[2] = lut_data->lut_valid ? lut_data->lut.freq : 0xFFU;
+			msg_content[3] = lut_data->lut_refs;
+			msg_content[4] = (Uint8)((Uint16)lut_data->lut.span >> 8);
+			msg_content[5] = (Uint8)((Uint16)lut_data->lut.span & 0x00FF);
+			if (index < WG_LUT_POINTS)
+			{
+				msg_content[6] = (Uint8)((Uint16)lut_data->lut.point[index] >> 8);
+				msg_content[7] = (Uint8)((Uint16)lut_data->lut.point[index] & 0x00FF);
+			}
+			else
+			{
+				msg_content[6] = 0xFFU;
+				msg_content[7] = 0xFFU;
+			}
+			break;
+		#endif
+
+		case CAN_DIAG_PAGE_SYNC:
+			/* Received SYNC messages, ticks since the last SYNC, window re-phase active */
+			msg_content[1] = (Uint8)(can_data->sync_received >> 8);
+			msg_content[2] = (Uint8)(can_data->sync_received & 0x00FF);
+			msg_content[3] = can_data->sync_timeout;
+			#if CAN_SYNC_REPHASE
+			msg_content[4] = (Uint8)(can_data->sync_timeout < CAN_SYNC_TIMEOUT);
+			#else
+			msg_content[4] = 0x00U;
+			#endif
+			msg_content[5] = 0x00U;
+			msg_content[6] = 0x00U;
+			msg_content[7] = 0x00U;
+			break;
+
+		case CAN_DIAG_PAGE_BITRATE:
+			/* Active bit rate, stored bit rate, fallback active */
+			msg_content[1] = can_data->bitrate;
+			msg_content[2] = can_data->bitrate_stored;
+			msg_content[3] = (Uint8)can_data->bitrate_fallback;
+			msg_content[4] = 0x00U;
+			msg_content[5] = 0x00U;
+			msg_content[6] = 0x00U;
+			msg_content[7] = 0x00U;
+			break;
+
+		default:
+			/* Unknown page */
+			memset((void*)&msg_content[1], 0xFF, 7);
+			break;
+	}
+
+	/* The timestamp directly follows the deviation PDO */
+	Can_transmit_message(can_msg, (page == CAN_DIAG_PAGE_TIMESTAMP) ? CAN_TX_PRIORITY_HIGH : CAN_TX_PRIORITY_LOW);
+
+	return;
+}
+
+#if SAMPLE_CAPTURE
+/*************************************************************************/
+/* Stream a completed capture: the state page, then the data segments. At most
+	CAN_CAPTURE_SEGMENTS per tick and only when no other message is queued, so
+	that the guidance PDO's are not delayed. */
+static void can_capture_stream(T_can_data_t *can_data)
+{
+	Uint8	sent;
+	Uint8	segment;
+
+	for (sent = 0U; (sent < CAN_CAPTURE_SEGMENTS) && (can_data->tx_queue_count == 0U); ++sent)
+	{
+		segment = Capture_next_segment();
+		if (segment == CAPTURE_SEGMENT_NONE)
+			break;
+
+		if (segment == CAPTURE_SEGMENT_HEADER)
+			can_transmit_diagnostic(can_data, CAN_DIAG_PAGE_CAPTURE, 0U);
+		else
+			can_transmit_diagnostic(can_data, CAN_DIAG_PAGE_CAPTURE_DATA, segment);
+	}
+
+	return;
+}
+#endif
+
+/*************************************************************************/
+/* Restart the transmission of a PDO. A PDO transmitted on change is sent at the
+	next tick, a cyclic PDO when its period has expired. */
+static void can_pdo_reset(T_can_data_t *can_data, Uint8 pdo)
+{
+	T_can_pdo_state_t	*state = &(can_data->pdo_state[pdo]);
+
+	state->ticks			= 0xFFU;
+	state->event_pending	= (can_data->pdo_config[pdo].type == CAN_TX_TYPE_ON_CHANGE);
+	state->event_level		= false;
+
+	return;
+}
+
+/*************************************************************************/
+/* Read the stored configuration; a bit rate or PDO without valid configuration 
+	keeps its default. Called once, after EEPROM init. */
+static void can_load_config(T_can_data_t *can_data)
+{
+	Uint16	payload[CAN_CONFIG_WORDS];
+	Uint16	*word;
+	Uint8	pdo;
+
+	if (!eeprom_record_load(EEPROM_RECORD_CAN, payload, CAN_CONFIG_WORDS))
+		return;
+
+	word = &payload[CAN_CONFIG_WORDS - 1];
+	if ((*word & 0x00FF) < CAN_BITRATE_LAST)
+		can_data->bitrate_stored = (Uint8)(*word & 0x00FF);
+	if (((*word >> 12) < CAN_PDO_LAYOUT_LAST) && (((*word >> 8) & 0x000F) < NBR_INPUT_FREQ))
+	{
+		can_data->pdo_layout = (Uint8)(*word >> 12);
+		can_data->compact_freq = (Uint8)((*word >> 8) & 0x000F);
+	}
+
+	for (pdo = 0U; pdo < CAN_PDO_LAST; ++pdo)
+	{
+		word = &payload[pdo * CAN_PDO_CONFIG_WORDS];
+		if ((word[0] >> 8) >= CAN_TX_TYPE_LAST)
+			continue;
+
+		can_data->pdo_config[pdo].type		= (Uint8)(word[0] >> 8);
+		can_data->pdo_config[pdo].period	= (Uint8)(word[0] & 0x00FF);
+		can_data->pdo_config[pdo].inhibit	= (Uint8)word[1];
+		can_data->pdo_config[pdo].deadband	= word[2];
+		can_pdo_reset(can_data, pdo);
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* Queue the configuration for EEPROM. Retried by Can_process() when the 
+	record cannot be queued. */
+static void can_store_config(T_can_data_t *can_data)
+{
+	Uint16	payload[CAN_CONFIG_WORDS];
+	Uint16	*word;
+	Uint8	pdo;
+
+	for (pdo = 0U; pdo < CAN_PDO_LAST; ++pdo)
+	{
+		word = &payload[pdo * CAN_PDO_CONFIG_WORDS];
+		word[0] = ((Uint16)can_data->pdo_config[pdo].type << 8) | can_data->pdo_config[pdo].period;
+		word[1] = can_data->pdo_config[pdo].inhibit;
+		word[2] = can_data->pdo_config[pdo].deadband;
+	}
+	payload[CAN_CONFIG_WORDS - 1] = ((Uint16)can_data->pdo_layout << 12) | 
+										((Uint16)can_data->compact_freq << 8) | can_data->bitrate_stored;
+
+	can_data->config_store_pending = !eeprom_record_store(EEPROM_RECORD_CAN, payload,
+										CAN_CONFIG_WORDS, NULL, 0U);
+
+	return;
+}
+
+/*************************************************************************/
+/* CAN_CMD_PDO_CONFIG: param: PDO, type, period, inhibit time, deadband (MSB, LSB) */
+static void can_pdo_configure(T_can_data_t *can_data, const Uint8 *param)
+{
+	T_can_pdo_config_t	*config;
+
+	if ((param[0] >= CAN_PDO_LAST) || (param[1] >= CAN_TX_TYPE_LAST))
+		return;
+
+	config = &(can_data->pdo_config[param[0]]);
+	config->type		= param[1];
+	config->period		= param[2];
+	config->inhibit		= param[3];
+	config->deadband	= ((Uint16)param[4] << 8) | param[5];
+	can_pdo_reset(can_data, param[0]);
+
+	can_store_config(can_data);
+
+	return;
+}
+
+/*************************************************************************/
+/* Bit rate to configure: default after fallback, else DIP switches (if used)
+	or the stored bit rate */
+static Uint8 can_select_bitrate(const T_can_data_t *can_data)
+{
+	#if CAN_BITRATE_DIP
+	Uint8	dip;
+	#endif
+
+	if (can_data->bitrate_fallback)
+		return CAN_BITRATE_DEFAULT;
+
+	#if CAN_BITRATE_DIP
+	dip = CanBitrateDip[((~PORTF) >> 4) & 0x0003];
+	if (dip != CAN_BITRATE_LAST)
+		return dip;
+	#endif
+
+	return can_data->bitrate_stored;
+}
+
+/*************************************************************************/
+/* Restart the CAN module to apply a new bit rate. Pending transmissions are 
+	aborted, otherwise configuration mode is not entered on an error-passive bus. */
+static void can_restart(T_can_data_t *can_data)
+{
+	Uint16	c1_ie;
+
+	c1_ie = IEC1bits.C1IE;
+	IEC1bits.C1IE = 0;
+	can_data->tx_queue_count = 0U;
+	IEC1bits.C1IE = c1_ie;
+
+	C1CTRLbits.ABAT = 1;
+	can_set_in_config_mode();
+	can_data->state = CAN_STATE_CONFIG_REQUESTED;
+	can_data->state_counter = 0U;
+	can_data->passive_counter = 0U;
+
+	return;
+}
+
+/*************************************************************************/
+/* Returns true when a value of the message changed more than deadband since it
+	was transmitted. Deviations are signed 16-bit values (MSB first), the other
+	PDO's contain 8-bit values. In the compact PDO, only deviation and quality 
+	have a deadband. */
+static sbool can_pdo_changed(
+  const T_can_data_t		*can_data,
+  Uint8						pdo,
+  const Uint8				*msg_content,
+  Uint16					deadband)
+{
+	const T_can_pdo_state_t	*state = &(can_data->pdo_state[pdo]);
+	int32	diff;
+	Uint8	ix;
+
+	if ((pdo == CAN_PDO_RESULT) && (can_data->pdo_layout == CAN_PDO_LAYOUT_COMPACT))
+	{
+		diff = (int32)(int16)(((Uint16)msg_content[0] << 8) | msg_content[1]) -
+				(int32)(int16)(((Uint16)state->sent[0] << 8) | state->sent[1]);
+		if ((diff > (int32)deadband) || (diff < -(int32)deadband))
+			return true;
+		diff = (int32)msg_content[2] - (int32)state->sent[2];
+		if ((diff > (int32)deadband) || (diff < -(int32)deadband))
+			return true;
+		return (memcmp((const void*)&msg_content[3], (const void*)&(state->sent[3]), 5) != 0);
+	}
+
+	for (ix = 0U; ix < 8U; ++ix)
+	{
+		if (pdo == CAN_PDO_RESULT)
+		{
+			diff = (int32)(int16)(((Uint16)msg_content[ix] << 8) | msg_content[ix + 1U]) -
+					(int32)(int16)(((Uint16)state->sent[ix] << 8) | state->sent[ix + 1U]);
+			++ix;
+		}
+		else
+			diff = (int32)msg_content[ix] - (int32)state->sent[ix];
+
+		if ((diff > (int32)deadband) || (diff < -(int32)deadband))
+			return true;
+	}
+
+	return false;
+}
+
+/*************************************************************************/
+/* Called every 100Hz tick with the content of a PDO. Returns true when the PDO
+	has to be transmitted according to its transmission type. An event is the
+	signal of new data by the application. */
+static sbool can_pdo_due(
+  T_can_data_t	*can_data,
+  Uint8			pdo,
+  const Uint8	*msg_content,
+  sbool			event)
+{
+	const T_can_pdo_config_t	*config = &(can_data->pdo_config[pdo]);
+	T_can_pdo_state_t			*state = &(can_data->pdo_state[pdo]);
+	sbool						due;
+
+	switch (config->type)
+	{
+		case CAN_TX_TYPE_ON_CHANGE:
+			if (can_pdo_changed(can_data, pdo, msg_content, config->deadband))
+				state->event_pending = true;
+			break;
+
+		case CAN_TX_TYPE_EVENT:
+			if (event)
+				state->event_pending = true;
+			break;
+
+		case CAN_TX_TYPE_SYNC:
+		case CAN_TX_TYPE_CYCLIC:
+		default:
+			state->event_pending = false;
+			break;
+	}
+
+	/* A SYNC PDO is evaluated after a SYNC and counts SYNC messages. The others
+		are evaluated every tick and directly after a completed batch, but count 
+		ticks only. Events are kept until evaluated. */
+	if (config->type == CAN_TX_TYPE_SYNC)
+	{
+		if (!can_data->sync_pass)
+			return false;
+		if (state->ticks < 0xFFU)
+			++state->ticks;
+	}
+	else
+	{
+		if (!can_data->tick_pass && !can_data->batch_pass)
+			return false;
+		if (can_data->tick_pass && (state->ticks < 0xFFU))
+			++state->ticks;
+	}
+
+	/* Pending change or event after the inhibit time, or period expired */
+	due = (state->event_pending && (state->ticks >= config->inhibit)) ||
+			((config->period != 0U) && (state->ticks >= config->period));
+
+	if (due)
+	{
+		state->ticks			= 0U;
+		state->event_pending	= false;
+		memcpy((void*)state->sent, (const void*)msg_content, 8);
+	}
+
+	return due;
+}
+
+/*************************************************************************/
+/* Status of left (upper nibble) and right (lower nibble) antenna: cable ok,
+	no short circuit, pilot tone ok, antenna ok */
+static Uint8 can_antenna_status(const T_wireGuid_t *wire_guid_data)
+{
+	int16           left_ok  = 0;
+	int16           right_ok = 0;
+
+	if ((wire_guid_data->status_left_antenna.antenna_cable_ok +
+        wire_guid_data->status_left_antenna.no_short_circuit +
+        wire_guid_data->status_left_antenna.pilot_tone_ok) == 3)
+	{
+		left_ok = 1;
+	}
+
+	if ((wire_guid_data->status_right_antenna.antenna_cable_ok +
+		wire_guid_data->status_right_antenna.no_short_circuit +
+		wire_guid_data->status_right_antenna.pilot_tone_ok) == 3)
+	{
+		right_ok = 1;
+	}
+
+	return (Uint8)(((((wire_guid_data->status_left_antenna.antenna_cable_ok & 0x0001) << 3) |
+					((wire_guid_data->status_left_antenna.no_short_circuit  & 0x0001) << 2) |
+					((wire_guid_data->status_left_antenna.pilot_tone_ok     & 0x0001) << 1) |
+					(left_ok & 0x0001)) << 4) |
+					((((wire_guid_data->status_right_antenna.antenna_cable_ok & 0x0001) << 3) |
+					((wire_guid_data->status_right_antenna.no_short_circuit  & 0x0001) << 2) |
+					((wire_guid_data->status_right_antenna.pilot_tone_ok     & 0x0001) << 1) |
+					(right_ok & 0x0001))));
+}
+
+/*************************************************************************/
+/* Fill the compact PDO, see E_can_pdo_layout_t. Quality is the sum of left and
+	right amplitude of the selected frequency, 255 at 2*WG_MAX_AMPLITUDE. */
+static void can_fill_compact(
+  const T_wireGuid_t	*wire_guid_data,
+  const T_can_data_t	*can_data,
+  Uint8					*msg_content)
+{
+	Uint8	freq = can_data->compact_freq;
+	Uint32	quality;
+	Uint8	valid = 0x00U;
+	Uint8	i;
+
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+	{
+		if (wire_guid_data->deviation_m2ecm[i] != WG_DEVIATION_INVALID)
+			valid |= (Uint8)(1U << i);
+	}
+
+	quality = ((wire_guid_data->amplitudeLeft[freq] + wire_guid_data->amplitudeRight[freq]) * 255UL) /
+				(2UL * WG_MAX_AMPLITUDE);
+	if (quality > 255UL)
+		quality = 255UL;
+
+	/* Deviation, WG_DEVIATION_FINE_SCALE times the resolution of 0x18n */
+	msg_content[0] = (Uint8)(((Uint16)wire_guid_data->deviation_fine[freq] & 0xFF00) >> 8);
+	msg_content[1] = (Uint8)((Uint16)wire_guid_data->deviation_fine[freq] & 0x00FF);
+	msg_content[2] = (Uint8)quality;
+	msg_content[3] = can_antenna_status(wire_guid_data);
+	/* Deviation valid, frequency calibrated, frequency, overall calibration status */
+	msg_content[4] = (Uint8)((((valid >> freq) & 0x01U) << 7) | (freq << 4) |
+								((Uint8)wire_guid_data->calibration_status & 0x0F));
+	if ((wire_guid_data->calibration_left.calibration_status_freq[freq] == WG_CALIB_STATUS_SUCCEEDED) &&
+		(wire_guid_data->calibration_right.calibration_status_freq[freq] == WG_CALIB_STATUS_SUCCEEDED))
+		msg_content[4] |= 0x40U;
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	msg_content[5] = (Uint8)((wire_guid_data->coeff_version & 0x7F) << 1) |
+								(wire_guid_data->direction_checked & 0x01);
+	msg_content[6] = wire_guid_data->switch_states_to_be_sent;
+	#else
+	msg_content[5] = (Uint8)((wire_guid_data->coeff_version & 0x7F) << 1);
+	msg_content[6] = 0x00U;
+	#endif
+	msg_content[7] = valid;
+
+	return;
+}
+
+/*************************************************************************/
+/* Error manager, called every 100Hz tick while running:
+	- statistics of error counters (C1EC), error-passive, transmit errors and
+	  lost arbitration
+	- bus-off: the module is stopped and restarted after a back-off time that
+	  doubles for every bus-off in sequence
+	- default bit rate when the bus stays error-passive, or after a sequence of
+	  bus-off events */
+static void can_error_monitor(T_can_data_t *can_data)
+{
+	T_can_errors_t	*errors = &(can_data->errors);
+	Uint8			tec = (Uint8)(C1EC >> 8);
+	Uint8			rec = (Uint8)(C1EC & 0x00FF);
+	Uint8			flags;
+	Uint8			buffer;
+	sbool			passive;
+
+	if (tec > errors->tec_max)
+		errors->tec_max = tec;
+	if (rec > errors->rec_max)
+		errors->rec_max = rec;
+
+	/* Count new transmit errors and lost arbitration of each transmit buffer */
+	for (buffer = 0U; buffer < CAN_NBR_TX_BUFFERS; ++buffer)
+	{
+		flags = (Uint8)(CanTxBuffer[buffer]->con & (CAN_TXCON_TXERR | CAN_TXCON_TXLARB));
+		if ((flags & CAN_TXCON_TXERR) && !(errors->tx_flags[buffer] & CAN_TXCON_TXERR))
+			++errors->retransmissions;
+		if ((flags & CAN_TXCON_TXLARB) && !(errors->tx_flags[buffer] & CAN_TXCON_TXLARB))
+			++errors->lost_arbitration;
+		errors->tx_flags[buffer] = flags;
+	}
+
+	if (C1INTFbits.TXBO)
+	{
+		++errors->bus_off;
+		if (errors->bus_off_sequence < 0xFFU)
+			++errors->bus_off_sequence;
+		errors->stable_counter = 0U;
+		errors->report_pending = true;
+
+		if ((errors->bus_off_sequence >= CAN_BUSOFF_FALLBACK_COUNT) &&
+			(can_data->bitrate != CAN_BITRATE_DEFAULT))
+			can_data->bitrate_fallback = true;
+
+		/* Stop the module; restart after the back-off time */
+		errors->backoff = CAN_BUSOFF_BACKOFF_MIN << ((errors->bus_off_sequence > 6U) ? 6U : (errors->bus_off_sequence - 1U));
+		if (errors->backoff > CAN_BUSOFF_BACKOFF_MAX)
+			errors->backoff = CAN_BUSOFF_BACKOFF_MAX;
+		can_restart(can_data);
+		can_data->state = CAN_STATE_BUS_OFF;
+		return;
+	}
+
+	if (errors->stable_counter < CAN_BUSOFF_STABLE_TIME)
+		++errors->stable_counter;
+	else
+		errors->bus_off_sequence = 0U;
+
+	passive = (C1INTFbits.TXEP || C1INTFbits.RXEP);
+	if (passive && !errors->passive)
+		++errors->error_passive;
+	errors->passive = passive;
+
+	/* Use the default bit rate when the bus stays error-passive */
+	if (passive)
+	{
+		if ((++can_data->passive_counter > CAN_ERROR_PASSIVE_TIMEOUT) &&
+			(can_data->bitrate != CAN_BITRATE_DEFAULT))
+		{
+			can_data->bitrate_fallback = true;
+			can_restart(can_data);
+		}
+	}
+	else
+		can_data->passive_counter = 0U;
+
+	return;
+}
+
+/*************************************************************************/
+/* Process a command PDO: code, parameters (missing bytes are 0) */
+static void can_process_command(T_can_data_t *can_data, const T_can_msg_t *message)
+{
+	Uint8	param[CAN_COMMAND_PARAM_SIZE];
+	Uint8	ix;
+
+	for(ix = 0U; ix < CAN_COMMAND_PARAM_SIZE; ++ix)
+		param[ix] = ((ix + 1U) < message->length) ? message->content[ix + 1U] : 0x00U;
+
+	switch (message->content[0])
+	{
+		case CAN_CMD_EEPROM_SELFTEST:
+			eeprom_self_test(&(gSystemData.eeprom_data));
+			break;
+
+		case CAN_CMD_DIAGNOSTIC:
+			can_transmit_diagnostic(can_data, param[0], param[1]);
+			break;
+
+		case CAN_CMD_PDO_CONFIG:
+			can_pdo_configure(can_data, param);
+			break;
+
+		case CAN_CMD_PDO_LAYOUT:
+			if ((param[0] < CAN_PDO_LAYOUT_LAST) && (param[1] < NBR_INPUT_FREQ))
+			{
+				can_data->pdo_layout = param[0];
+				can_data->compact_freq = param[1];
+				can_pdo_reset(can_data, CAN_PDO_RESULT);
+				can_store_config(can_data);
+			}
+			break;
+
+		#if SAMPLE_CAPTURE
+		case CAN_CMD_CAPTURE:
+			Capture_command(param);
+			break;
+		#endif
+
+		#if DEVIATION_LUT
+		case CAN_CMD_LUT:
+			WireGuid_lut_command(&(gGuidanceData.wireGuidData), param);
+			break;
+		#endif
+
+		case CAN_CMD_BITRATE:
+			if (param[0] < CAN_BITRATE_LAST)
+			{
+				can_data->bitrate_stored = param[0];
+				can_data->bitrate_fallback = false;
+				can_store_config(can_data);
+				can_restart(can_data);
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* Process a received message, taken from the receive FIFO */
+static void Can_receive_message(T_can_data_t *can_data, const T_can_msg_t *message)
+{
+	Uint8		ix;
+	Uint16		check;
+
+	check = message->sid - (Uint16)can_data->nodeID_DIP;
 	
 	/* Process data */
 	if(check == CAN_PDO_SID_RX_START_CALIBRATION)
 		gGuidanceData.wireGuidData.calibration_status = WG_CALIB_STATUS_START;
 	else if(check ==	CAN_PDO_SID_RX_CONFIG_FREQS)
 	{
-		ANT_Set_Freqs(msg_content, gGuidanceData.wireGuidData.frequencies,
-								&(gGuidanceData.wireGuidData.freq_status));
-		ANT_Store_Freqs(gGuidanceData.wireGuidData.frequencies, 
-									&(gGuidanceData.wireGuidData.freq_status));
+		/* Coefficients are computed and stored in EEPROM by WireGuid_process */
+		for(ix = 0U; ix < 8U; ++ix)
+			gGuidanceData.wireGuidData.freq_request[ix] = (ix < message->length) ? message->content[ix] : 0x00U;
+		gGuidanceData.wireGuidData.freq_request_pending = true;
+	}
+	else if((check == CAN_PDO_SID_RX_COMMAND) && (message->length > 0U))
+		can_process_command(can_data, message);
+	else if((check == CAN_SDO_SID_RX) && (message->length == OBJDICT_SDO_LENGTH))
+	{
+		T_can_msg_t	*can_msg = &(can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_5]);
+
+		can_msg->sid    = CAN_SDO_SID_TX + (Uint16)can_data->nodeID_DIP;
+		can_msg->length = OBJDICT_SDO_LENGTH;
+		Objdict_sdo_request(message->content, can_msg->content);
+		Can_transmit_message(can_msg, CAN_TX_PRIORITY_MEDIUM_LOW);
 	}
 
 	return;
@@ -325,6 +1380,8 @@ static void Can_receive_message(
 */
 void Can_init(void)
 {
+	Uint8	ix;
+
 	// Initialize instruction-counters for the CAN module timing
 	#if DBG_TIME_CAN
 	t_can[0] = 0;
@@ -338,41 +1395,191 @@ void Can_init(void)
 		for CAN message reception (CAN system needs to be in configuration mode) */
 	gSystemData.can_data.nodeID_DIP = ((~PORTB) & 0x000F);
 
-	/* Go into configuration mode */
+	gSystemData.can_data.init_retries = 0U;
+	gSystemData.can_data.rx_fifo_head = 0U;
+	gSystemData.can_data.rx_fifo_count = 0U;
+	gSystemData.can_data.rx_fifo_max = 0U;
+	gSystemData.can_data.rx_dropped = 0U;
+	gSystemData.can_data.rx_overrun = 0U;
+	gSystemData.can_data.invalid_msg = 0U;
+	gSystemData.can_data.error_irq = 0U;
+	memset((void*)&(gSystemData.can_data.errors), 0, sizeof(T_can_errors_t));
+	gSystemData.can_data.boot_reported = false;
+	gSystemData.can_data.tx_queue_count = 0U;
+	gSystemData.can_data.tx_queue_max = 0U;
+	gSystemData.can_data.tx_dropped = 0U;
+
+	/* Default PDO transmission, the stored configuration is read by Can_process() */
+	for (ix = 0U; ix < CAN_PDO_LAST; ++ix)
+	{
+		gSystemData.can_data.pdo_config[ix] = CanPdoDefault[ix];
+		can_pdo_reset(&(gSystemData.can_data), ix);
+	}
+	gSystemData.can_data.config_loaded = false;
+	gSystemData.can_data.config_store_pending = false;
+
+	gSystemData.can_data.bitrate_stored = CAN_BITRATE_DEFAULT;
+	gSystemData.can_data.bitrate = CAN_BITRATE_DEFAULT;
+	gSystemData.can_data.bitrate_fallback = false;
+	gSystemData.can_data.passive_counter = 0U;
+
+	#if CAN_PDO_COMPACT
+	gSystemData.can_data.pdo_layout = CAN_PDO_LAYOUT_COMPACT;
+	#else
+	gSystemData.can_data.pdo_layout = CAN_PDO_LAYOUT_STANDARD;
+	#endif
+	gSystemData.can_data.compact_freq = 0U;
+
+	gSystemData.can_data.sync_received = 0U;
+	gSystemData.can_data.sync_handled = 0U;
+	gSystemData.can_data.tick_pass = false;
+	gSystemData.can_data.batch_pass = false;
+	gSystemData.can_data.sync_pass = false;
+	gSystemData.can_data.sync_timeout = 0xFFU;
+
+	/* Request configuration mode, configuration is done by Can_process() */
 	can_set_in_config_mode();
+	gSystemData.can_data.state = CAN_STATE_CONFIG_REQUESTED;
+	gSystemData.can_data.state_counter = 0U;
 
-	/* Receive buffer 0 status and control register
-		- No receive buffer overflow from RB0 to RB1 (for now) */
-	C1RX0CONbits.DBEN = 0;
-  
-	/* Transmit buffer n Standard identifier
-		- Enable filter for standard identifier */
-	C1TX0SIDbits.TXIDE = 0;
-	C1TX1SIDbits.TXIDE = 0;
-	C1TX2SIDbits.TXIDE = 0;
+	return;
+}
 
-	/* Reset receive buffer */
-	C1RX0B1 = 0;
-	C1RX0B2 = 0;
-	C1RX0B3 = 0;
-	C1RX0B4 = 0;
-  
-	/* Set masks and filters */
-	can_set_mask_rx(0U,0x000FU);
-	can_set_mask_rx(1U,0x000FU);
+/*! Can_process() is called every 100Hz. It completes the start-up of the CAN 
+	module without waiting for the mode changes, and processes received commands.
+*/
+void Can_process(T_can_data_t *can_data)
+{
+	Uint16	c1_ie;
 
-	can_set_filter_rx(0,0x0200 + (Uint16)(gSystemData.can_data.nodeID_DIP));
-	can_set_filter_rx(1,0x0300 + (Uint16)(gSystemData.can_data.nodeID_DIP));
+	switch (can_data->state)
+	{
+		case CAN_STATE_CONFIG_REQUESTED:
+			if (C1CTRLbits.OPMODE == 4)
+			{
+				/* Stored bit rate is needed, EEPROM is initialized */
+				if (!can_data->config_loaded)
+				{
+					can_load_config(can_data);
+					can_data->config_loaded = true;
+				}
+				can_data->bitrate = can_select_bitrate(can_data);
+				can_setup(can_data->bitrate);
+				can_data->state = CAN_STATE_NORMAL_REQUESTED;
+				can_data->state_counter = 0U;
+			}
+			else if (++can_data->state_counter > CAN_INIT_TIMEOUT)
+			{
+				/* Request configuration mode again */
+				++can_data->init_retries;
+				can_set_in_config_mode();
+				can_data->state_counter = 0U;
+			}
+			break;
 
-	can_set_priority(0U,2U);
-	can_set_priority(1U,2U);
-	can_set_priority(2U,2U);
-  
-	can_configure();
+		case CAN_STATE_NORMAL_REQUESTED:
+			if (C1CTRLbits.OPMODE == 0)
+			{
+				can_data->state = CAN_STATE_RUNNING;
+				gSystemData.bootTiming.can_ready_msec = gSystemData.clockT1SysData.ticks_boot_msec;
+			}
+			else if (++can_data->state_counter > CAN_INIT_TIMEOUT)
+			{
+				/* Restart from configuration mode */
+				++can_data->init_retries;
+				can_set_in_config_mode();
+				can_data->state = CAN_STATE_CONFIG_REQUESTED;
+				can_data->state_counter = 0U;
+			}
+			break;
+
+		case CAN_STATE_BUS_OFF:
+			if (++can_data->state_counter >= can_data->errors.backoff)
+				can_restart(can_data);
+			break;
+
+		case CAN_STATE_RUNNING:
+		default:
+			/* Process received messages in order of reception */
+			while (can_data->rx_fifo_count > 0U)
+			{
+				Can_receive_message(can_data, &(can_data->rx_fifo[can_data->rx_fifo_head]));
+
+				c1_ie = IEC1bits.C1IE;
+				IEC1bits.C1IE = 0;
+				can_data->rx_fifo_head = (can_data->rx_fifo_head + 1U) % CAN_RX_FIFO_SIZE;
+				--can_data->rx_fifo_count;
+				IEC1bits.C1IE = c1_ie;
+			}
+
+			can_error_monitor(can_data);
+
+			/* The window follows the SYNC until it is lost */
+			if (can_data->sync_timeout < 0xFFU)
+				++can_data->sync_timeout;
+			#if CAN_SYNC_REPHASE
+			ANT_Sync_Window(can_data->sync_timeout < CAN_SYNC_TIMEOUT);
+			#endif
+
+			if (can_data->errors.report_pending && (can_data->state == CAN_STATE_RUNNING))
+			{
+				can_transmit_diagnostic(can_data, CAN_DIAG_PAGE_ERRORS, 0U);
+				can_data->errors.report_pending = false;
+			}
+
+			/* Report start-up timing once, when the first valid deviation is computed */
+			if (!can_data->boot_reported && (gSystemData.bootTiming.first_deviation_msec != 0U))
+			{
+				can_transmit_diagnostic(can_data, CAN_DIAG_PAGE_BOOT, 0U);
+				can_data->boot_reported = true;
+			}
+
+			#if SAMPLE_CAPTURE
+			can_capture_stream(can_data);
+			#endif
+			break;
+	}
+
+	return;
+}
+
+/*! Can_store() retries queueing a changed configuration for EEPROM */
+void Can_store(T_can_data_t *can_data)
+{
+	if (can_data->config_store_pending && !eeprom_record_busy(EEPROM_RECORD_CAN))
+		can_store_config(can_data);
 
 	return;
 }
 
+/*! Can_diagnostic() transmits a diagnostic page (E_can_diag_page_t) */
+void Can_diagnostic(T_can_data_t *can_data, Uint8 page, Uint8 index)
+{
+	can_transmit_diagnostic(can_data, page, index);
+
+	return;
+}
+
+/*! Can_pdo_pass() is called by the PDO task before the PDO's are evaluated,
+	at every 100Hz tick, when a batch has been computed and when a SYNC has been
+	received. A SYNC transmits the values of the latest computed batch. Returns
+	false when there is no pass.
+*/
+sbool Can_pdo_pass(T_can_data_t *can_data, sbool tick, sbool batch)
+{
+	Uint16	received = can_data->sync_received;
+
+	can_data->tick_pass = tick;
+	can_data->batch_pass = batch;
+	can_data->sync_pass = (received != can_data->sync_handled);
+	can_data->sync_handled = received;
+
+	if (can_data->sync_pass)
+		can_data->sync_timeout = 0U;
+
+	return (can_data->tick_pass || can_data->batch_pass || can_data->sync_pass);
+}
+
 // Check when testing whether published values are the same as the values of the deviation variables
 void Can_transmit_wireguid_result(
   const T_wireGuid_t	*wire_guid_data,
@@ -395,20 +1602,28 @@ void Can_transmit_wireguid_result(
 	can_msg->sid    = CAN_PDO_SID_TX_DEVIATION + (Uint16)nodeID;
 	can_msg->length = 8U;
   
-	/* Fill content with deviations:
-		- msg: [0x18n  8  deviation f4, deviation f3, deviation f2, deviation f1]*/
-	/* Frequency 4 */
-	msg_content[0] = ((wire_guid_data->deviation_m2ecm[3] & 0xFF00) >> 8); // upper 8 bits
-	msg_content[1] = ((wire_guid_data->deviation_m2ecm[3] & 0x00FF) >> 0); // lower 8 bits 
-	/* Frequency 3 */
-	msg_content[2] = ((wire_guid_data->deviation_m2ecm[2] & 0xFF00) >> 8);
-	msg_content[3] = ((wire_guid_data->deviation_m2ecm[2] & 0x00FF) >> 0);
-	/* Frequency 2 */
-	msg_content[4] = ((wire_guid_data->deviation_m2ecm[1] & 0xFF00) >> 8);
-	msg_content[5] = ((wire_guid_data->deviation_m2ecm[1] & 0x00FF) >> 0);
-	/* Frequency 1 */
-	msg_content[6] = ((wire_guid_data->deviation_m2ecm[0] & 0xFF00) >> 8);
-	msg_content[7] = ((wire_guid_data->deviation_m2ecm[0] & 0x00FF) >> 0);
+	if (can_data->pdo_layout == CAN_PDO_LAYOUT_COMPACT)
+	{
+		/* Deviation of the selected frequency, quality and status */
+		can_fill_compact(wire_guid_data, can_data, msg_content);
+	}
+	else
+	{
+		/* Fill content with deviations:
+			- msg: [0x18n  8  deviation f4, deviation f3, deviation f2, deviation f1]*/
+		/* Frequency 4 */
+		msg_content[0] = ((wire_guid_data->deviation_m2ecm[3] & 0xFF00) >> 8); // upper 8 bits
+		msg_content[1] = ((wire_guid_data->deviation_m2ecm[3] & 0x00FF) >> 0); // lower 8 bits 
+		/* Frequency 3 */
+		msg_content[2] = ((wire_guid_data->deviation_m2ecm[2] & 0xFF00) >> 8);
+		msg_content[3] = ((wire_guid_data->deviation_m2ecm[2] & 0x00FF) >> 0);
+		/* Frequency 2 */
+		msg_content[4] = ((wire_guid_data->deviation_m2ecm[1] & 0xFF00) >> 8);
+		msg_content[5] = ((wire_guid_data->deviation_m2ecm[1] & 0x00FF) >> 0);
+		/* Frequency 1 */
+		msg_content[6] = ((wire_guid_data->deviation_m2ecm[0] & 0xFF00) >> 8);
+		msg_content[7] = ((wire_guid_data->deviation_m2ecm[0] & 0x00FF) >> 0);
+	}
   
 	/* Implement internal timer for Transmission function (call) */
 	// start step instruction-counter
@@ -416,7 +1631,14 @@ void Can_transmit_wireguid_result(
 	t_can[4] = clock();
 	#endif
   
-	Can_transmit_message(can_msg);
+	/* New values are computed every batch */
+	if (can_pdo_due(can_data, CAN_PDO_RESULT, msg_content, true))
+	{
+		Can_transmit_message(can_msg, CAN_TX_PRIORITY_HIGH);
+		#if CAN_TIMESTAMP
+		can_transmit_diagnostic(can_data, CAN_DIAG_PAGE_TIMESTAMP, 0U);
+		#endif
+	}
   
 	/*  End timer of Transmission function (call) */
 	#ifdef FUNCTION_CALL_CAN
@@ -437,6 +1659,10 @@ void Can_transmit_wireguid_raw(
   Uint8                 		*msg_content) 
                                          
 {
+	/* Not transmitted with the compact PDO layout */
+	if (can_data->pdo_layout == CAN_PDO_LAYOUT_COMPACT)
+		return;
+
 	/* Implement internal timer for TX Raws */
 	// start step instruction-counter
 	#ifdef FUNCTION_INTERNAL_CAN
@@ -480,7 +1706,9 @@ void Can_transmit_wireguid_raw(
 	t_can[4] = clock();
 	#endif
   
-	Can_transmit_message(can_msg);
+	/* New values are computed every batch */
+	if (can_pdo_due(can_data, CAN_PDO_RAW, msg_content, true))
+		Can_transmit_message(can_msg, CAN_TX_PRIORITY_MEDIUM_LOW);
   
 	/*  End timer of Transmission function (call) */
 	#ifdef FUNCTION_CALL_CAN
@@ -501,6 +1729,10 @@ void Can_transmit_wireguid_status(
   Uint8                 		*msg_content) 
                                          
 {
+	/* Not transmitted with the compact PDO layout */
+	if (can_data->pdo_layout == CAN_PDO_LAYOUT_COMPACT)
+		return;
+
 	/* Implement internal timer for TX Statuses */
 	// start step instruction-counter
 	#ifdef FUNCTION_INTERNAL_CAN
@@ -509,8 +1741,6 @@ void Can_transmit_wireguid_status(
 
 	T_can_msg_t    *can_msg;
 	Uint8           nodeID;
-	int16           left_ok  = 0;
-	int16           right_ok = 0;
 
 	can_msg  	= &(can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_1]);
 	nodeID   	= can_data->nodeID_DIP;
@@ -536,39 +1766,20 @@ void Can_transmit_wireguid_status(
 
 	/* Status (to be added)*/
 	/* Left and right antenna */
-	if ((wire_guid_data->status_left_antenna.antenna_cable_ok +
-        wire_guid_data->status_left_antenna.no_short_circuit +
-        wire_guid_data->status_left_antenna.pilot_tone_ok) == 3)
-	{
-		left_ok = 1;
-	}
-	if ((wire_guid_data->status_right_antenna.antenna_cable_ok +
-		wire_guid_data->status_right_antenna.no_short_circuit +
-		wire_guid_data->status_right_antenna.pilot_tone_ok) == 3)
-	{
-		right_ok = 1;
-	}
+	msg_content[4] = can_antenna_status(wire_guid_data);
 
-	msg_content[4] = ((((wire_guid_data->status_left_antenna.antenna_cable_ok & 0x0001) << 3) |
-								((wire_guid_data->status_left_antenna.no_short_circuit  & 0x0001) << 2) |
-								((wire_guid_data->status_left_antenna.pilot_tone_ok     & 0x0001) << 1) |
-								(left_ok & 0x0001)) << 4) |
-								((((wire_guid_data->status_right_antenna.antenna_cable_ok & 0x0001) << 3) |
-								((wire_guid_data->status_right_antenna.no_short_circuit  & 0x0001) << 2) |
-								((wire_guid_data->status_right_antenna.pilot_tone_ok     & 0x0001) << 1) |
-								(right_ok & 0x0001))    );
-	
 	#if SECOND_HARMONIC_FIRST_FREQUENCY
-	/* Transmit Phase Direction Correction */
-	msg_content[5] = (wire_guid_data->direction_checked & 0x01);
+	/* Transmit Phase Direction Correction and active coefficient version */
+	msg_content[5] = (Uint8)((wire_guid_data->coeff_version & 0x7F) << 1) |
+								(wire_guid_data->direction_checked & 0x01);
 	if (wire_guid_data->direction_checked)
 		msg_content[6] = ((wire_guid_data->rel_phaseLeft_sign & 0x0F) << 4) | 
 									(wire_guid_data->rel_phaseRight_sign & 0x0F);
 	else
 		msg_content[6] = 0x00U;
 	#else
-	/* Void */
-	msg_content[5] = 0x00U;
+	/* Active coefficient version */
+	msg_content[5] = (Uint8)((wire_guid_data->coeff_version & 0x7F) << 1);
 	msg_content[6] = 0x00U;
 	#endif
 	/* Calibration indication */
@@ -580,7 +1791,9 @@ void Can_transmit_wireguid_status(
 	t_can[4] = clock();
 	#endif
   
-	Can_transmit_message(can_msg);
+	/* New values are computed every batch */
+	if (can_pdo_due(can_data, CAN_PDO_STATUS, msg_content, true))
+		Can_transmit_message(can_msg, CAN_TX_PRIORITY_MEDIUM_HIGH);
   
 	/*  End timer of Transmission function (call) */
 	#ifdef FUNCTION_CALL_CAN
@@ -601,8 +1814,13 @@ void Can_transmit_wireguid_switches(
   Uint8                 		*msg_content) 
                                          
 {
+	/* Not transmitted with the compact PDO layout */
+	if (can_data->pdo_layout == CAN_PDO_LAYOUT_COMPACT)
+		return;
+
 	T_can_msg_t    *can_msg;
 	Uint8           nodeID;
+	sbool           event;
 
 	can_msg  	= &(can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_3]);
 	nodeID   	= can_data->nodeID_DIP;
@@ -622,46 +1840,92 @@ void Can_transmit_wireguid_switches(
 	msg_content[6] = 0x00U;
 	msg_content[7] = 0x00U;
 
-	Can_transmit_message(can_msg);
+	/* New switch states are signalled by the rising edge of tx_new_states */
+	event = wire_guid_data->tx_new_states && !can_data->pdo_state[CAN_PDO_SWITCHES].event_level;
+	can_data->pdo_state[CAN_PDO_SWITCHES].event_level = wire_guid_data->tx_new_states;
+
+	if (can_pdo_due(can_data, CAN_PDO_SWITCHES, msg_content, event))
+		Can_transmit_message(can_msg, CAN_TX_PRIORITY_MEDIUM_HIGH);
 
 	return;
 }
 
-/*! _C1Interrupt() is the CAN receive interrupt.*/
+/*! _C1Interrupt() is the CAN receive and transmit interrupt.*/
 void __attribute__((interrupt, auto_psv)) _C1Interrupt(void)
 {
+	#if INT_LATENCY_MONITOR
+	Uint16	entry = TMR3;
+	Uint16	capture;
+	#endif
+	#if PERF_COUNTERS
+	Uint16	perf_start = PERF_STAMP();
+	#endif
+
 	/* Implement internal timer for CAN Interrupt */
 	// start step instruction-counter
 	#if DBG_TIME_CAN
 	t_can[0] = clock();
 	#endif
 
-	/* For now, only messages are transmitted and only receive interrupt is
-		cleared. They are not processed */
-	if (C1INTFbits.TX0IF) C1INTFbits.TX0IF = 0;
-	if (C1INTFbits.TX1IF) C1INTFbits.TX1IF = 0;
-	if (C1INTFbits.TX2IF) C1INTFbits.TX2IF = 0;
+	/* Entry latency from the oldest captured receipt. Timer3 counts 0..PR3,
+		a latency above one period (200 usec at 5kHz) is not seen. */
+	#if INT_LATENCY_MONITOR
+	if (IC2CONbits.ICBNE)
+	{
+		capture = IC2BUF;
+		while (IC2CONbits.ICBNE)
+			(void)IC2BUF;
+		Interrupt_latency(INT_SOURCE_C1, (entry >= capture) ? (entry - capture) : (entry + (PR3 + 1U) - capture));
+	}
+	#endif
+
+	/* A transmit buffer is free: load the next queued messages */
+	if (C1INTF & 0x001C)
+	{
+		C1INTFbits.TX0IF = 0;
+		C1INTFbits.TX1IF = 0;
+		C1INTFbits.TX2IF = 0;
+		can_tx_fill_buffers(&(gSystemData.can_data));
+	}
+	/* Receive buffer 0 is older than buffer 1 when both are full (double buffering) */
 	if (C1INTFbits.RX0IF)
 	{
-		Can_receive_message(CAN_RX_MSG_BUFFER_0,
-			gSystemData.can_data.can_rx_msg_buffer[CAN_RX_MSG_BUFFER_0].content);
+		can_rx_read(&(gSystemData.can_data), (const volatile T_can_hw_buffer_t *)&C1RX0SID);
 		C1RX0CONbits.RXFUL 	= 0;
 		C1INTFbits.RX0IF   		= 0;
 	}
 	if (C1INTFbits.RX1IF)
 	{
-		Can_receive_message(CAN_RX_MSG_BUFFER_1,
-			gSystemData.can_data.can_rx_msg_buffer[CAN_RX_MSG_BUFFER_1].content);
+		can_rx_read(&(gSystemData.can_data), (const volatile T_can_hw_buffer_t *)&C1RX1SID);
 		C1RX1CONbits.RXFUL 	= 0;
 		C1INTFbits.RX1IF 			= 0;
 	}
+	/* A message was received while both receive buffers were full */
+	if (C1INTFbits.RX0OVR || C1INTFbits.RX1OVR)
+	{
+		++gSystemData.can_data.rx_overrun;
+		C1INTFbits.RX0OVR = 0;
+		C1INTFbits.RX1OVR = 0;
+	}
 	if (C1INTFbits.WAKIF) C1INTFbits.WAKIF = 0; // Add wake-up handler code
-	if (C1INTFbits.ERRIF) C1INTFbits.ERRIF = 0; // Add error handler code
-	if (C1INTFbits.IVRIF) C1INTFbits.IVRIF = 0; // Add invalid message received handler code
+	if (C1INTFbits.ERRIF)
+	{
+		++gSystemData.can_data.error_irq;
+		C1INTFbits.ERRIF = 0;
+	}
+	if (C1INTFbits.IVRIF)
+	{
+		++gSystemData.can_data.invalid_msg;
+		C1INTFbits.IVRIF = 0;
+	}
 	if ( (C1INTF & C1INTE) == 0 ) IFS1bits.C1IF = 0;
 
 	/* End timer  for CAN Interrupt */
 	#if DBG_TIME_CAN
 	t_can[0] = clock() - t_can[0];
 	#endif
+
+	#if PERF_COUNTERS
+	Perf_record(PERF_PROBE_C1_ISR, perf_start);
+	#endif
 }
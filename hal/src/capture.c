@@ -0,0 +1,216 @@
+// 2014 - 2015
+
+/*! \file capture.c
+    \brief Contains the capture of antenna samples and the order in which
+           they are streamed
+*/
+
+#include "project_canantenna.h"
+
+#if SAMPLE_CAPTURE
+
+// Global variables
+volatile Uint8 Capture_hook;	// Hooks called by the A/D interrupt
+
+// Local variables
+static T_capture_t	Capture;
+static Uint8		CaptureBuffer[CAPTURE_PAIRS * CAPTURE_PAIR_SIZE];
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+/* Pack a pair of 12-bit samples at the next position. Called from the A/D
+	interrupt only. Returns true when all pairs are recorded. */
+static sbool capture_store(int16 left, int16 right)
+{
+	Uint8	*pPair = &CaptureBuffer[(Uint16)Capture.count * CAPTURE_PAIR_SIZE];
+
+	if (Capture.count == 0U)
+		Capture.start = ADC_sampleCounter;
+
+	pPair[0] = (Uint8)((Uint16)left >> 4);
+	pPair[1] = (Uint8)(((Uint16)left << 4) & 0xF0U) | (Uint8)(((Uint16)right >> 8) & 0x0FU);
+	pPair[2] = (Uint8)right;
+
+	++Capture.count;
+
+	return (Capture.count >= Capture.pairs);
+}
+
+/*************************************************************************/
+/* Arm a new capture */
+static void capture_arm(void)
+{
+	Capture_hook	= 0U;
+	Capture.count	= 0U;
+	Capture.segment	= CAPTURE_SEGMENT_HEADER;
+
+	/* Only a raw capture may start between windows */
+	if ((Capture.mode == CAPTURE_MODE_RAW) && (Capture.trigger == CAPTURE_TRIGGER_NOW))
+	{
+		Capture.state	= CAPTURE_STATE_RECORDING;
+		Capture_hook	= CAPTURE_HOOK_ADC;
+	}
+	else
+	{
+		Capture.state	= CAPTURE_STATE_WAIT_WINDOW;
+		Capture_hook	= CAPTURE_HOOK_STEP;
+	}
+
+	return;
+}
+
+//*****************************************************************************
+// Local functions
+//*****************************************************************************
+void Capture_init(void)
+{
+	Capture_hook = 0U;
+	memset((void*)&Capture, 0, sizeof(Capture));
+	Capture.state	= CAPTURE_STATE_IDLE;
+	Capture.segment	= CAPTURE_SEGMENT_NONE;
+
+	return;
+}
+
+/*! Capture_command() processes the capture command: mode (byte 0), trigger
+	(byte 1), pairs (byte 2, 0 or more than CAPTURE_PAIRS: CAPTURE_PAIRS) */
+void Capture_command(const Uint8 *param)
+{
+	switch (param[0])
+	{
+		case CAPTURE_MODE_RAW:
+		case CAPTURE_MODE_WINDOWED:
+			if (param[1] >= CAPTURE_TRIGGER_LAST)
+				break;
+			Capture_hook	= 0U;
+			Capture.mode	= param[0];
+			Capture.trigger	= param[1];
+			Capture.pairs	= ((param[2] == 0U) || (param[2] > CAPTURE_PAIRS)) ? (Uint8)CAPTURE_PAIRS : param[2];
+			capture_arm();
+			break;
+
+		case CAPTURE_MODE_STOP:
+			Capture_hook	= 0U;
+			Capture.state	= CAPTURE_STATE_IDLE;
+			Capture.segment	= CAPTURE_SEGMENT_NONE;
+			break;
+
+		case CAPTURE_MODE_RESEND:
+			if ((Capture.state == CAPTURE_STATE_DONE) || (Capture.state == CAPTURE_STATE_STREAMING))
+			{
+				Capture.segment	= CAPTURE_SEGMENT_HEADER;
+				Capture.state	= CAPTURE_STATE_STREAMING;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return;
+}
+
+/*! Capture_adc() records a raw pair, called by the A/D interrupt while
+	CAPTURE_HOOK_ADC is set */
+void Capture_adc(int16 left, int16 right)
+{
+	if (capture_store(left, right))
+	{
+		Capture_hook	= 0U;
+		Capture.state	= CAPTURE_STATE_STREAMING;
+	}
+
+	return;
+}
+
+/*! Capture_step() records a window-aligned pair, called by ANT_Step() while
+	CAPTURE_HOOK_STEP is set. The raw or the windowed pair is kept. */
+void Capture_step(int16 rawLeft, int16 rawRight, int16 winLeft, int16 winRight)
+{
+	sbool	complete;
+
+	if (Capture.state == CAPTURE_STATE_WAIT_WINDOW)
+	{
+		if (ANT_k != 0U)
+			return;
+		Capture.state = CAPTURE_STATE_RECORDING;
+	}
+
+	if (Capture.mode == CAPTURE_MODE_WINDOWED)
+		complete = capture_store(winLeft, winRight);
+	else
+		complete = capture_store(rawLeft, rawRight);
+
+	if (complete)
+	{
+		Capture_hook	= 0U;
+		Capture.state	= (Capture.trigger == CAPTURE_TRIGGER_LOST) ? CAPTURE_STATE_CHECK : CAPTURE_STATE_STREAMING;
+	}
+
+	return;
+}
+
+/*! Capture_batch() is called after every batch. A recorded window whose
+	batch lost a valid deviation is kept, otherwise the capture is armed
+	again (CAPTURE_TRIGGER_LOST). */
+void Capture_batch(Uint32 window_end, sbool lost)
+{
+	if (Capture.state != CAPTURE_STATE_CHECK)
+		return;
+
+	/* Batch of an earlier window */
+	if ((int32)(window_end - Capture.start) < 0L)
+		return;
+
+	if (lost)
+		Capture.state = CAPTURE_STATE_STREAMING;
+	else
+		capture_arm();
+
+	return;
+}
+
+/*! Capture_next_segment() returns the next segment to stream: the header,
+	then the data segments. CAPTURE_SEGMENT_NONE when nothing is to be sent. */
+Uint8 Capture_next_segment(void)
+{
+	Uint8	segment;
+	Uint8	segments;
+
+	if (Capture.state != CAPTURE_STATE_STREAMING)
+		return CAPTURE_SEGMENT_NONE;
+
+	segment = Capture.segment;
+	segments = (Capture.count + CAPTURE_SEGMENT_PAIRS - 1U) / CAPTURE_SEGMENT_PAIRS;
+
+	if (segment == CAPTURE_SEGMENT_HEADER)
+		Capture.segment = 0U;
+	else if ((segment + 1U) < segments)
+		++Capture.segment;
+	else
+		Capture.state = CAPTURE_STATE_DONE;
+
+	return segment;
+}
+
+/*! Capture_state() returns the capture state */
+const T_capture_t *Capture_state(void)
+{
+	return &Capture;
+}
+
+/*! Capture_segment() copies the pairs of a data segment, 6 bytes. Pairs
+	beyond the recorded ones are 0. */
+void Capture_segment(Uint8 segment, Uint8 *content)
+{
+	Uint16	offset = (Uint16)segment * (CAPTURE_SEGMENT_PAIRS * CAPTURE_PAIR_SIZE);
+	Uint16	size = (Uint16)Capture.count * CAPTURE_PAIR_SIZE;
+	Uint8	i;
+
+	for (i = 0U; i < (CAPTURE_SEGMENT_PAIRS * CAPTURE_PAIR_SIZE); ++i)
+		content[i] = ((offset + i) < size) ? CaptureBuffer[offset + i] : 0x00U;
+
+	return;
+}
+#endif
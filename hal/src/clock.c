@@ -16,29 +16,33 @@ void Clock_init(void)
 	/* Initialize clock variables */
 	gSystemData.clockT1SysData.ticks_1msec    = 0;
 	gSystemData.clockT1SysData.ticks_1sec 		= 0;
-	gSystemData.clockT1SysData.ticks_10msec	= 0;
-	gSystemData.clockT1SysData.puls_100Hz		= 1;
+	gSystemData.clockT1SysData.ticks_boot_msec	= 0;
+	gSystemData.clockT1SysData.ticks_free_msec	= 0;
   
 	/* - Clear timer1 register, to start counting from zero such that comparison
                               with PR1 is correct from the beginning.
 		- Set period 1 register
 		- Set internal clock source
-		- Start of timer is set in system_start()
-		- Use 1:1 prescaler */
+		- Start of timer is set in system_init(), to measure start-up time
+		- Use 1:1 prescaler
+		- Continue in Idle mode, Timer1 wakes the scheduler */
 	TMR1            	= 0;
 	PR1             		= TMR1_PERIOD;
 	T1CONbits.TCS	= 0;
+	T1CONbits.TSIDL	= 0;
   
 	/* 	- Clear timer3 register, to start counting from zero such that comparison
 		  with PR1 is correct from the beginning.
 		- Set period 3 register
 		- Set internal clock source
 		- Start of timer is set in system_start()
-		- Use 1:1 prescaler */
+		- Use 1:1 prescaler
+		- Continue in Idle mode, Timer3 is the PWM time base */
 	TMR3						= 0;
 	PR3							= TMR3_FORPWMPERIOD;
 	T3CONbits.TCS			= 0;
 	T3CONbits.TCKPS	= 0;
+	T3CONbits.TSIDL	= 0;
 
   return;
 }
@@ -55,18 +59,18 @@ void Clock_init(void)
 */
 void __attribute__((interrupt, auto_psv)) _T1Interrupt(void)
 {
+	/* Timer1 restarted from 0 at the period match: entry latency [TCY] */
+	#if INT_LATENCY_MONITOR
+	Interrupt_latency(INT_SOURCE_T1, TMR1);
+	#endif
+
 	LATBbits.LATB10 = 1;
   
 	/* Increment ticks counter */
 	++gSystemData.clockT1SysData.ticks_1msec;
-	++gSystemData.clockT1SysData.ticks_10msec;
-
-	/* Set 100Hz puls and clear 10msec tick */
-	if (gSystemData.clockT1SysData.ticks_10msec > TIMECOUNTER_10MSEC)
-	{
-		gSystemData.clockT1SysData.ticks_10msec 	= 0;
-		gSystemData.clockT1SysData.puls_100Hz   	= 1;
-	}
+	if (gSystemData.clockT1SysData.ticks_boot_msec < 0xFFFFU)
+		++gSystemData.clockT1SysData.ticks_boot_msec;
+	++gSystemData.clockT1SysData.ticks_free_msec;
 
 	/* Increase 1sec tick, if time rollover and clear 1msec tick */
 	if ( gSystemData.clockT1SysData.ticks_1msec > TIMECOUNTER_1000MSEC)
@@ -25,43 +25,175 @@
 #define	EEPROM_ADDRESS_COEFF_FREQ4					(0x7FFE1A)
 #define	EEPROM_ADDRESS_COEFF_DATA_WRITTEN			(0x7FFE1C)
 #define  EEPROM_ADDRESS_END							(0x7FFE1E)
+/* Last word of the EEPROM, only written by the self-test */
+#define  EEPROM_ADDRESS_SELFTEST						(0x7FFFFE)
 
 #define  VERIFY_WRITE_COUNT                         (3)
 
 /* Local variables */
-Uint16      Eeprom_read_data;
-Uint16      Eeprom_test_data_read;
-Uint16      Eeprom_test_data_write;
+Uint16      Eeprom_legacy_row[EEPROM_ROW_WORDS];	/* Fixed-address layout, read at start-up */
+
+/*********************************************************************************/
+/* Static functions */
+/*********************************************************************************/
+/* Return true when the data of the request is present in EEPROM */
+static sbool eeprom_request_stored(const T_eeprom_request_t *request)
+{
+	Uint16	row_data[EEPROM_ROW_WORDS];
+
+	if (request->row == NULL)
+		return (eeprom_read_word(request->address) == request->data);
+
+	eeprom_read_row(request->address, row_data);
+
+	return (memcmp((void*)row_data, (void*)request->row, EEPROM_ROW_SIZE) == 0);
+}
+
+/*********************************************************************************/
+/* Start the erase of the request, completion is signaled by the NVM interrupt */
+static void eeprom_request_erase(T_eeprom_data_t *eeprom_data, const T_eeprom_request_t *request)
+{
+	eeprom_data->engine_state = EEPROM_ENGINE_ERASE;
+	_erase_eedata(request->address, (request->row == NULL) ? _EE_WORD : _EE_ROW);
+
+	return;
+}
+
+/*********************************************************************************/
+/* Remove the head request from the queue and report its result */
+static void eeprom_engine_complete(T_eeprom_data_t *eeprom_data, sbool success)
+{
+	T_eeprom_request_t	request = eeprom_data->queue[eeprom_data->queue_head];
+
+	/* Remove request before the callback, as the callback may queue a new one */
+	eeprom_data->queue_head = (eeprom_data->queue_head + 1U) % EEPROM_QUEUE_SIZE;
+	--eeprom_data->queue_count;
+	eeprom_data->retry_count = 0U;
+
+	if (success)
+		++eeprom_data->writes_done;
+	else
+		++eeprom_data->writes_failed;
+
+	if (request.callback != NULL)
+		request.callback(request.tag, success);
+
+	return;
+}
+
+/*********************************************************************************/
+/* Start the erase of the next queued request. Requests whose data is already 
+   stored are completed without erase-write cycle. */
+static void eeprom_engine_start(T_eeprom_data_t *eeprom_data)
+{
+	T_eeprom_request_t	*request;
+
+	eeprom_data->engine_state = EEPROM_ENGINE_CHECK;
+
+	while (eeprom_data->queue_count > 0U)
+	{
+		request = &(eeprom_data->queue[eeprom_data->queue_head]);
+		if (!eeprom_request_stored(request))
+		{
+			eeprom_request_erase(eeprom_data, request);
+			return;
+		}
+		eeprom_engine_complete(eeprom_data, true);
+	}
+
+	eeprom_data->engine_state = EEPROM_ENGINE_IDLE;
+
+	return;
+}
+
+/*********************************************************************************/
+/* Add a word or row write to the queue and start the engine when idle */
+static sbool eeprom_engine_queue(
+  Uint32				write_address,
+  Uint16				word_to_write,
+  const Uint16			*row_data,
+  T_eeprom_callback_t	callback,
+  Uint16				tag)
+{
+	T_eeprom_data_t		*eeprom_data = &(gSystemData.eeprom_data);
+	T_eeprom_request_t	*request;
+	Uint16				nvm_ie;
+	sbool				queued = false;
+
+	/* The queue is shared with the NVM interrupt */
+	nvm_ie = IEC0bits.NVMIE;
+	IEC0bits.NVMIE = 0;
+
+	if (eeprom_data->queue_count < EEPROM_QUEUE_SIZE)
+	{
+		request = &(eeprom_data->queue[(eeprom_data->queue_head + eeprom_data->queue_count) %
+										EEPROM_QUEUE_SIZE]);
+		request->address	= write_address;
+		request->data		= word_to_write;
+		request->row		= row_data;
+		request->tag		= tag;
+		request->callback	= callback;
+		++eeprom_data->queue_count;
+		queued = true;
+
+		if (eeprom_data->engine_state == EEPROM_ENGINE_IDLE)
+			eeprom_engine_start(eeprom_data);
+	}
+
+	IEC0bits.NVMIE = nvm_ie;
+
+	return queued;
+}
 
 /*********************************************************************************/
 /* Local functions */
 /*********************************************************************************/
 void eeprom_init(T_eeprom_data_t  *eeprom_data)
 {
-	eeprom_data->wait_read_counter  = 0;
-	eeprom_data->write_enable       = 1;
-	eeprom_data->read_enable		= 0;
-	eeprom_data->write_address 		= EEPROM_ADDRESS_START;
-	eeprom_data->read_address       = EEPROM_ADDRESS_START;
+	eeprom_data->selftest_status	= EEPROM_SELFTEST_NOT_RUN;
+	eeprom_data->selftest_pattern	= eeprom_read_word(EEPROM_ADDRESS_SELFTEST);
+
+	eeprom_data->queue_head		= 0U;
+	eeprom_data->queue_count		= 0U;
+	eeprom_data->engine_state		= EEPROM_ENGINE_IDLE;
+	eeprom_data->retry_count		= 0U;
+	eeprom_data->writes_done		= 0U;
+	eeprom_data->writes_failed	= 0U;
 
-	Eeprom_test_data_read  = 0;
-	Eeprom_test_data_write = 0x5555;
+	/* Read parameter region at start-up: newest records and fixed-address layout */
+	eeprom_record_init();
+	eeprom_read_row(EEPROM_ADDRESS_START, Eeprom_legacy_row);
 
   return;
 }
 
 /*********************************************************************************/
-/* Read data stored in address and return it */
+/* Read data stored in address and return it. Also used by the NVM interrupt,
+   so the word is read into a local variable. */
 Uint16 eeprom_read_word(
   Uint32    read_address)
 {  
-	_memcpy_p2d16(&Eeprom_read_data, read_address, _EE_WORD);
+	Uint16	read_data;
+
+	_memcpy_p2d16(&read_data, read_address, _EE_WORD);
 
-  return (Eeprom_read_data);
+  return (read_data);
 }
 
 /*********************************************************************************/
-/* Write value to address and check if writing succeeded */
+/* Read the EEPROM_ROW_WORDS words of the row starting at row_address */
+void eeprom_read_row(
+  Uint32    row_address,
+  Uint16    *row_data)
+{
+	_memcpy_p2d16(row_data, row_address, _EE_ROW);
+
+	return;
+}
+
+/*********************************************************************************/
+/* Write value to address and check if writing succeeded. This function blocks
+   until the word is written; it cannot be used while queued writes are ongoing. */
 sbool eeprom_write_word(
   Uint32    write_address,
   Uint16    word_to_write)
@@ -72,6 +204,9 @@ sbool eeprom_write_word(
 	// Counter for the erase-write loop
 	Uint16 cnt = 0U;
 
+	if (eeprom_write_busy())
+		return false;
+
 	/*
 		The loop checks if the word to be written was successfully stored
 		by reading back the content of the destination address.
@@ -110,6 +245,48 @@ sbool eeprom_write_word(
 	return true;
 }
 
+/*********************************************************************************/
+/* Queue a word to be written without waiting for the erase-write cycles. The
+   callback (if any) is called with tag when the word is written and read back,
+   or when writing failed VERIFY_WRITE_COUNT times; from the NVM interrupt, or
+   before this function returns when the word is already stored.
+   Returns false when the queue is full; the callback is not called then. */
+sbool eeprom_write_word_async(
+  Uint32				write_address,
+  Uint16				word_to_write,
+  T_eeprom_callback_t	callback,
+  Uint16				tag)
+{
+	return eeprom_engine_queue(write_address, word_to_write, NULL, callback, tag);
+}
+
+/*********************************************************************************/
+/* Queue a row to be erased and written as a whole, see eeprom_write_word_async().
+   row_data shall remain unchanged until the callback is called. */
+sbool eeprom_write_row_async(
+  Uint32				row_address,
+  const Uint16			*row_data,
+  T_eeprom_callback_t	callback,
+  Uint16				tag)
+{
+	return eeprom_engine_queue(row_address, 0xFFFFU, row_data, callback, tag);
+}
+
+/*********************************************************************************/
+/* Return true while queued writes are not completed */
+sbool eeprom_write_busy(void)
+{
+	return (gSystemData.eeprom_data.engine_state != EEPROM_ENGINE_IDLE);
+}
+
+/******************************************************************************/
+/* Return word defined by identifier, as read at start-up */
+Uint16 eeprom_read_legacy(
+  E_eeprom_ID_t   eeprom_ID)
+{
+	return Eeprom_legacy_row[(eeprom_get_read_write_address(eeprom_ID) - EEPROM_ADDRESS_START) >> 1];
+}
+
 /******************************************************************************/
 /* Return EEPROM address defined by identifier */
 Uint32 eeprom_get_read_write_address(
@@ -185,38 +362,84 @@ Uint32 eeprom_get_read_write_address(
 
 
 /******************************************************************************/
-/* Test read/write procedure from/to EEPROM */
-void eeprom_test_read_write(T_eeprom_data_t  *eeprom_data)
+/* Called when the self-test word is written and read back, see T_eeprom_callback_t */
+static void eeprom_self_test_callback(Uint16 tag, sbool success)
 {
-	while(1)
-	{		
-		if (eeprom_data->write_enable)
-		{
-			eeprom_write_word(eeprom_data->write_address, Eeprom_test_data_write);
-			eeprom_data->write_enable  = 0;
-			eeprom_data->wait_read_counter = 0;
-			eeprom_data->read_enable   = 1;
-			eeprom_data->read_address = eeprom_data->write_address;
-		}
-		if (eeprom_data->read_enable)
-		{
-			if (eeprom_data->wait_read_counter > 5)
+	gSystemData.eeprom_data.selftest_status = success ? EEPROM_SELFTEST_PASSED : EEPROM_SELFTEST_FAILED;
+
+	return;
+}
+
+/******************************************************************************/
+/* Test write/read-back procedure of the EEPROM, on request. The pattern alternates
+   between tests, so that every test erases and writes the test word. The result is
+   available in selftest_status. */
+void eeprom_self_test(T_eeprom_data_t  *eeprom_data)
+{
+	if (eeprom_data->selftest_status == EEPROM_SELFTEST_BUSY)
+		return;
+
+	eeprom_data->selftest_pattern = (eeprom_data->selftest_pattern == 0x5555U) ? 0xAAAAU : 0x5555U;
+	eeprom_data->selftest_status = EEPROM_SELFTEST_BUSY;
+	if (!eeprom_write_word_async(EEPROM_ADDRESS_SELFTEST, eeprom_data->selftest_pattern,
+								 eeprom_self_test_callback, 0U))
+	{
+		eeprom_data->selftest_status = EEPROM_SELFTEST_FAILED;
+	}
+
+	return;
+}
+
+//*****************************************************************************
+// Interrupt functions
+//*****************************************************************************
+/*! _NVMInterrupt() is raised when an EEPROM erase or write cycle is completed.
+    It advances the write engine: erase -> write -> read back, with up to
+    VERIFY_WRITE_COUNT attempts per queued word or row.
+*/
+void __attribute__((interrupt, auto_psv)) _NVMInterrupt(void)
+{
+	static const Uint16 __attribute__((space(auto_psv))) 
+	verify_write_count = (Uint16)VERIFY_WRITE_COUNT;
+
+	T_eeprom_data_t		*eeprom_data = &(gSystemData.eeprom_data);
+	T_eeprom_request_t	*request = &(eeprom_data->queue[eeprom_data->queue_head]);
+
+	/* It is necessary to clear manually the interrupt flag for NVM */
+	IFS0bits.NVMIF = 0;
+
+	switch (eeprom_data->engine_state)
+	{
+		case EEPROM_ENGINE_ERASE:
+			/* Erase done, write word or row to blank address */
+			eeprom_data->engine_state = EEPROM_ENGINE_WRITE;
+			if (request->row == NULL)
+				_write_eedata_word(request->address, request->data);
+			else
+				_write_eedata_row(request->address, (int*)request->row);
+			break;
+
+		case EEPROM_ENGINE_WRITE:
+			/* Write done, check data by reading it back */
+			if (eeprom_request_stored(request))
+			{
+				eeprom_engine_complete(eeprom_data, true);
+			}
+			else if (++eeprom_data->retry_count >= verify_write_count)
 			{
-				Eeprom_test_data_read = eeprom_read_word(eeprom_data->read_address);
-				eeprom_data->read_enable = 0;
-				eeprom_data->write_enable = 1;
-				Eeprom_test_data_write = 0x6666;
-				eeprom_data->write_address =   EEPROM_ADDRESS_END;
+				eeprom_engine_complete(eeprom_data, false);
 			}
 			else
-				++eeprom_data->wait_read_counter;
-		}
-		if (Eeprom_test_data_read == 0x6666)
-		{
-			LATBbits.LATB10 = 1;
+			{
+				/* Rewrite the word or row */
+				eeprom_request_erase(eeprom_data, request);
+				break;
+			}
+			eeprom_engine_start(eeprom_data);
+			break;
+
+		default:
+			/* Erase-write cycle of eeprom_write_word(), nothing to do */
 			break;
-		}
 	}
-	
-	return;
 }
@@ -0,0 +1,250 @@
+// 2014 - 2015
+
+/*! \file eeprom_record.c
+    \brief Contains the EEPROM record store. A record is written to the slot
+           following the last write, skipping the newest record, so the
+           newest record is never erased by a write. A write interrupted by a reset leaves a row with a wrong
+           CRC, and the previous record is used at the next start-up.
+*/
+
+#include "project_canantenna.h"
+
+/* Defines */
+#define	EEPROM_RECORD_BASE_ADDRESS	(0x7FFC00)
+/* Identifies a record row. Upper byte cannot be 0xFF, an erased row is never valid */
+#define	EEPROM_RECORD_MAGIC			(0x5A00)
+/* No record of the type has been found */
+#define	EEPROM_RECORD_NO_SLOT		(0xFF)
+
+/* Partitions (first row, number of rows). Rows 16 and 29-31 are not used by the
+   record store; row 16 (0x7FFE00) contains the fixed-address layout of earlier
+   versions, the last word of row 31 is used by the EEPROM self-test. */
+typedef struct{
+	Uint8	first_row;
+	Uint8	nbr_slots;
+} T_eeprom_partition_t;
+
+static const T_eeprom_partition_t __attribute__((space(auto_psv)))
+EepromPartition[EEPROM_RECORD_LAST] = {
+	{ 0U, 8U },		// EEPROM_RECORD_CALIB: 0x7FFC00 - 0x7FFCFF
+	{ 8U, 8U },		// EEPROM_RECORD_FREQS: 0x7FFD00 - 0x7FFDFF
+	{ 17U, 4U },	// EEPROM_RECORD_CAN:   0x7FFE20 - 0x7FFE9F
+	{ 21U, 4U },	// EEPROM_RECORD_PARAM: 0x7FFEA0 - 0x7FFF1F
+	{ 25U, 4U }		// EEPROM_RECORD_LUT:   0x7FFF20 - 0x7FFF9F
+};
+
+/* Local variables */
+typedef struct{
+	T_eeprom_record_t	buffer;			/* Row being written, owned by the write engine */
+	Uint16				shadow[EEPROM_RECORD_PAYLOAD_WORDS];	/* Payload of the newest valid record */
+	sbool				shadow_valid;
+	Uint8				newest_slot;	/* Slot of the newest valid record */
+	Uint8				next_slot;		/* Slot of the next write */
+	Uint16				sequence;		/* Sequence number of the newest valid record */
+	volatile sbool		busy;
+	T_eeprom_callback_t	callback;
+	Uint16				tag;
+} T_eeprom_record_state_t;
+
+static T_eeprom_record_state_t	EepromRecord[EEPROM_RECORD_LAST];
+
+/*********************************************************************************/
+/* Static functions */
+/*********************************************************************************/
+/* CRC-16-CCITT (polynomial 0x1021, initial value 0xFFFF) of nbr_words words */
+static Uint16 eeprom_record_crc(const Uint16 *data, Uint16 nbr_words)
+{
+	Uint16	crc = 0xFFFFU;
+	Uint16	i;
+	Uint8	bit;
+
+	for (i = 0U; i < nbr_words; ++i)
+	{
+		crc ^= data[i];
+		for (bit = 0U; bit < 16U; ++bit)
+		{
+			if (crc & 0x8000U)
+				crc = (crc << 1) ^ 0x1021U;
+			else
+				crc <<= 1;
+		}
+	}
+
+	return crc;
+}
+
+/*********************************************************************************/
+/* Return EEPROM address of a slot */
+static Uint32 eeprom_record_address(E_eeprom_record_t record, Uint8 slot)
+{
+	return (Uint32)EEPROM_RECORD_BASE_ADDRESS +
+			((Uint32)(EepromPartition[record].first_row + slot) * EEPROM_ROW_SIZE);
+}
+
+/*********************************************************************************/
+/* Read a slot. Returns true when it contains a valid record of the type. */
+static sbool eeprom_record_read_slot(E_eeprom_record_t record, Uint8 slot, T_eeprom_record_t *pRecord)
+{
+	eeprom_read_row(eeprom_record_address(record, slot), (Uint16*)pRecord);
+
+	if (pRecord->header != (EEPROM_RECORD_MAGIC | (Uint16)record))
+		return false;
+
+	return (eeprom_record_crc((const Uint16*)pRecord, EEPROM_ROW_WORDS - 1) == pRecord->crc);
+}
+
+/*********************************************************************************/
+/* Return the slot after slot. The slot of the newest valid record is skipped, so
+   that failed writes cannot wrap around onto the only valid record. */
+static Uint8 eeprom_record_next_slot(E_eeprom_record_t record, Uint8 slot)
+{
+	Uint8	nbr_slots = EepromPartition[record].nbr_slots;
+
+	do{
+		slot = (slot + 1U) % nbr_slots;
+	} while ((slot == EepromRecord[record].newest_slot) && (nbr_slots > 1U));
+
+	return slot;
+}
+
+/*********************************************************************************/
+/* Write engine callback of the record row, see T_eeprom_callback_t */
+static void eeprom_record_written(Uint16 tag, sbool success)
+{
+	T_eeprom_record_state_t	*pState = &EepromRecord[tag];
+	Uint8					slot = pState->next_slot;
+
+	if (success)
+	{
+		pState->newest_slot	= slot;
+		pState->sequence	= pState->buffer.sequence;
+		memcpy((void*)pState->shadow, (void*)pState->buffer.payload, sizeof(pState->shadow));
+		pState->shadow_valid = true;
+	}
+	/* A failing slot is skipped by the next write */
+	pState->next_slot = eeprom_record_next_slot((E_eeprom_record_t)tag, slot);
+	pState->busy = false;
+
+	if (pState->callback != NULL)
+		pState->callback(pState->tag, success);
+
+	return;
+}
+
+/*********************************************************************************/
+/* Local functions */
+/*********************************************************************************/
+/* Search the newest valid record of each type and keep its payload in RAM. All
+   reads are done here, at start-up. The sequence number is compared with 
+   wrap-around, a record is newer when its difference is positive. */
+void eeprom_record_init(void)
+{
+	T_eeprom_record_t	row;
+	Uint8				record;
+	Uint8				slot;
+
+	for (record = 0U; record < EEPROM_RECORD_LAST; ++record)
+	{
+		T_eeprom_record_state_t *pState = &EepromRecord[record];
+
+		pState->newest_slot	= EEPROM_RECORD_NO_SLOT;
+		pState->sequence	= 0U;
+		pState->busy		= false;
+		pState->shadow_valid	= false;
+
+		for (slot = 0U; slot < EepromPartition[record].nbr_slots; ++slot)
+		{
+			if (!eeprom_record_read_slot((E_eeprom_record_t)record, slot, &row))
+				continue;
+
+			if ((pState->newest_slot == EEPROM_RECORD_NO_SLOT) ||
+				((int16)(row.sequence - pState->sequence) > 0))
+			{
+				pState->newest_slot	= slot;
+				pState->sequence	= row.sequence;
+				memcpy((void*)pState->shadow, (void*)row.payload, sizeof(pState->shadow));
+				pState->shadow_valid = true;
+			}
+		}
+
+		if (pState->newest_slot == EEPROM_RECORD_NO_SLOT)
+			pState->next_slot = 0U;
+		else
+			pState->next_slot = eeprom_record_next_slot((E_eeprom_record_t)record, pState->newest_slot);
+	}
+
+	return;
+}
+
+/*********************************************************************************/
+/* Copy nbr_words of the newest valid record to payload, from RAM. Returns false
+   when no valid record is present or nbr_words exceeds the payload; payload is
+   not changed then. */
+sbool eeprom_record_load(
+  E_eeprom_record_t		record,
+  Uint16				*payload,
+  Uint16				nbr_words)
+{
+	T_eeprom_record_state_t	*pState = &EepromRecord[record];
+
+	if (!pState->shadow_valid || (nbr_words > EEPROM_RECORD_PAYLOAD_WORDS))
+		return false;
+
+	memcpy((void*)payload, (void*)pState->shadow, nbr_words * sizeof(Uint16));
+
+	return true;
+}
+
+/*********************************************************************************/
+/* Queue a new record with nbr_words of payload; unused payload words are 0xFFFF.
+   The callback (if any) is called when the row is written, from the NVM interrupt
+   or directly (see T_eeprom_callback_t). When the payload equals the newest record,
+   nothing is written and the callback is called directly. Returns false when nbr_words exceeds the payload, a write
+   of the record is ongoing or the EEPROM queue is full; the callback is not
+   called then. */
+sbool eeprom_record_store(
+  E_eeprom_record_t		record,
+  const Uint16			*payload,
+  Uint16				nbr_words,
+  T_eeprom_callback_t	callback,
+  Uint16				tag)
+{
+	T_eeprom_record_state_t	*pState = &EepromRecord[record];
+
+	if (pState->busy || (nbr_words > EEPROM_RECORD_PAYLOAD_WORDS))
+		return false;
+
+	memset((void*)pState->buffer.payload, 0xFF, sizeof(pState->buffer.payload));
+	memcpy((void*)pState->buffer.payload, (void*)payload, nbr_words * sizeof(Uint16));
+
+	/* Only changed records are written */
+	if (pState->shadow_valid &&
+		(memcmp((void*)pState->buffer.payload, (void*)pState->shadow, sizeof(pState->shadow)) == 0))
+	{
+		if (callback != NULL)
+			callback(tag, true);
+		return true;
+	}
+	pState->buffer.header	= EEPROM_RECORD_MAGIC | (Uint16)record;
+	pState->buffer.sequence	= pState->sequence + 1U;
+	pState->buffer.crc		= eeprom_record_crc((const Uint16*)&(pState->buffer), EEPROM_ROW_WORDS - 1);
+	pState->callback		= callback;
+	pState->tag				= tag;
+	pState->busy			= true;
+
+	if (!eeprom_write_row_async(eeprom_record_address(record, pState->next_slot),
+								(const Uint16*)&(pState->buffer), eeprom_record_written, (Uint16)record))
+	{
+		pState->busy = false;
+		return false;
+	}
+
+	return true;
+}
+
+/*********************************************************************************/
+/* Return true while a write of the record is ongoing */
+sbool eeprom_record_busy(E_eeprom_record_t record)
+{
+	return EepromRecord[record].busy;
+}
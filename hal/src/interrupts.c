@@ -8,23 +8,36 @@
 
 #include "project_canantenna.h"
 
+//*****************************************************************************
+// Local variables
+//*****************************************************************************
+/* Written by the interrupt of the source only */
+static T_int_latency_t	IntLatency[INT_SOURCE_LAST];
+
 //*****************************************************************************
 // Local functions
 //*****************************************************************************
 void Interrupt_init(void)
 {
+	memset((void*)IntLatency, 0, sizeof(IntLatency));
+
 	/* Interrupt control register 1
-		Do not allow nested interrupts (bit 15)*/
+		Allow nested interrupts (bit 15) with INT_NESTING: an interrupt preempts
+		the interrupts of lower priority */
+	#if INT_NESTING
+	INTCON1bits.NSTDIS = 0;
+	#else
 	INTCON1bits.NSTDIS = 1;
+	#endif
 
 	/* Interrupt control register 2
 		Use standard vector table */
 	INTCON2bits.ALTIVT = 0;
 
 	/* Status register (In CPU)
-		CPU interrupt level is 3 (bit 7-5), enable CPU priority levels 4-7. If this 
-		value is 0 it is disabled, linked with CORCONbits.IPL3 */
-	SRbits.IPL = 1;
+		CPU interrupt level (bit 7-5) of the scheduler, enables the priority levels
+		above. If this value is 0 it is disabled, linked with CORCONbits.IPL3 */
+	SRbits.IPL = INT_PRIORITY_MAIN;
 
 	/* Core control register
 		CPU interrupt priority level < 7 (bit 3), linked with SRbits.IPL */
@@ -33,20 +46,22 @@ void Interrupt_init(void)
 	/* Interrupt priority control register 0 
 		Set interrupt priority for Timer1 (bits 14-12)
 		Set interrupt priority for Timer3 */
-	IPC0bits.T1IP = 6;
+	IPC0bits.T1IP = INT_PRIORITY_T1;
 	//IPC1bits.T3IP = 1;
 
 	/* Interrupt priority control register 2
 		Set interrupt priority for AD Conversion complete (bits 14-12) */
-	IPC2bits.ADIP = 5;
+	IPC2bits.ADIP = INT_PRIORITY_ADC;
 
 	/* Interrupt priority control register 3 
-		Set interrupt priority for Interrupt Change Notification Flag Status */
-	IPC3bits.CNIP = 2;
+		Set interrupt priority for Interrupt Change Notification Flag Status
+		Set interrupt priority for EEPROM erase/write completion (NVM) */
+	IPC3bits.CNIP = INT_PRIORITY_CN;
+	IPC3bits.NVMIP = INT_PRIORITY_NVM;
   
 	/* Interrupt priority control register 6 
 		Set interrupt priority for CAN (bit 14-12) */
-	IPC6bits.C1IP = 3;
+	IPC6bits.C1IP = INT_PRIORITY_C1;
 
 	/* Interrupt flag status register 0
 		Clear interrupt flag status bit associated with AD Conversion complete
@@ -56,6 +71,7 @@ void Interrupt_init(void)
 	IFS0bits.T3IF		= 0;
 	IFS0bits.ADIF    = 0;
 	IFS0bits.CNIF    = 0;
+	IFS0bits.NVMIF   = 0;
   
 	/* Interrupt flag status register 1 
 		Clear interrupt flag status bit associated with CAN (bit 11) */
@@ -75,6 +91,7 @@ void Interrupt_init(void)
 	//IEC0bits.T3IE      = 1;
 	IEC0bits.ADIE     = 1;
 	IEC0bits.CNIE     = 1;
+	IEC0bits.NVMIE    = 1;
 
 	/* CAN interrupt enable register: enable all CAN interrupt sources
 		IVRIE (invalid message received), WAKIE (Bus Wake Up), ERRIE (Error),
@@ -89,3 +106,48 @@ void Interrupt_init(void)
   
 	return;
 }
+
+/*! Interrupt_latency() adds an entry latency [TCY] to the histogram of the
+	source. Called by the interrupt of the source (INT_LATENCY_MONITOR). */
+void Interrupt_latency(Uint8 source, Uint16 latency)
+{
+	T_int_latency_t	*pLatency = &IntLatency[source];
+	Uint16			bits = latency >> 4;
+	Uint8			bin = 0U;
+
+	while ((bits != 0U) && (bin < (INT_LATENCY_BINS - 1U)))
+	{
+		bits >>= 1;
+		++bin;
+	}
+
+	if (pLatency->histogram[bin] < 0xFFFFU)
+		++pLatency->histogram[bin];
+	if (latency > pLatency->max)
+		pLatency->max = latency;
+	if ((source == INT_SOURCE_T1) && (latency > INT_T1_LATENCY_MAX) && (pLatency->exceeded < 0xFFFFU))
+		++pLatency->exceeded;
+
+	return;
+}
+
+/*! Interrupt_latency_state() returns the entry latency statistics of a source */
+const T_int_latency_t *Interrupt_latency_state(Uint8 source)
+{
+	return &IntLatency[source];
+}
+
+/*! Interrupt_bound_report() returns true once after the Timer1 entry latency
+	exceeded its bound (INT_T1_JITTER_MAX_USEC) */
+sbool Interrupt_bound_report(void)
+{
+	T_int_latency_t	*pLatency = &IntLatency[INT_SOURCE_T1];
+	Uint16			exceeded = pLatency->exceeded;
+
+	if (exceeded == pLatency->reported)
+		return false;
+
+	pLatency->reported = exceeded;
+
+	return true;
+}
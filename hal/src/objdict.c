@@ -0,0 +1,278 @@
+// 2014 - 2015
+
+/*! \file objdict.c
+    \brief Contains the object dictionary and the SDO server (expedited transfers)
+*/
+
+#include "project_canantenna.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+/* Entry attributes: size in bytes (1, 2 or 4), access, sign */
+#define OBJDICT_SIZE_MASK	(0x07U)
+#define OBJDICT_RO			(0x10U)
+#define OBJDICT_SIGNED		(0x20U)
+
+/* SDO command specifiers, byte 0 of request and response */
+#define SDO_CCS_MASK		(0xE0U)
+#define SDO_CCS_DOWNLOAD	(0x20U)		/* Client writes */
+#define SDO_CCS_UPLOAD		(0x40U)		/* Client reads */
+#define SDO_SCS_DOWNLOAD	(0x60U)
+#define SDO_SCS_UPLOAD		(0x43U)		/* Expedited, size indicated, n in bits 2-3 */
+#define SDO_ABORT			(0x80U)
+#define SDO_EXPEDITED		(0x02U)
+#define SDO_SIZE_INDICATED	(0x01U)
+
+/* SDO abort codes */
+#define SDO_ABORT_COMMAND		(0x05040001UL)	/* Command specifier not valid or unknown */
+#define SDO_ABORT_READ_ONLY		(0x06010002UL)	/* Attempt to write a read-only object */
+#define SDO_ABORT_NO_OBJECT		(0x06020000UL)	/* Object does not exist */
+#define SDO_ABORT_LENGTH		(0x06070010UL)	/* Length of service parameter does not match */
+#define SDO_ABORT_NO_SUBINDEX	(0x06090011UL)	/* Sub-index does not exist */
+#define SDO_ABORT_RANGE			(0x06090030UL)	/* Value range of parameter exceeded */
+#define SDO_ABORT_STORE			(0x08000020UL)	/* Data cannot be stored */
+
+/* Signatures written to 0x1010:01 and 0x1011:01, "save" and "load" in ASCII */
+#define OBJDICT_SIGNATURE_SAVE	(0x65766173UL)
+#define OBJDICT_SIGNATURE_LOAD	(0x64616F6CUL)
+
+typedef struct
+{
+	Uint16	index;
+	Uint8	subindex;
+	Uint8	attr;
+	void	*data;
+	int32	min;
+	int32	max;
+} T_objdict_entry_t;
+
+/* Device type: no CANopen device profile */
+static const Uint32 __attribute__((space(auto_psv))) ObjdictDeviceType = 0UL;
+
+/* Object dictionary, sorted by index and sub-index. Sub-index 0 of an index
+	with sub-indexes is not listed, it returns the highest sub-index. */
+static const T_objdict_entry_t __attribute__((space(auto_psv)))
+ObjdictEntry[] = {
+	{ OBJDICT_DEVICE_TYPE, 0U, 4U | OBJDICT_RO, (void*)&ObjdictDeviceType, 0L, 0L },
+	#if GUIDANCE_WIRE
+	{ OBJDICT_WG_PARAM, 1U, 2U, &gWireGuidParam.deviation_scale, 1000L, 60000L },
+	{ OBJDICT_WG_PARAM, 2U, 2U, &gWireGuidParam.deviation_range, 100L, 8000L },
+	{ OBJDICT_WG_PARAM, 3U, 2U, &gWireGuidParam.amplitude_min, 1L, 1000L },
+	{ OBJDICT_WG_PARAM, 4U, 2U | OBJDICT_SIGNED, &gWireGuidParam.qam_comp_noise, 0L, 25L },
+	{ OBJDICT_WG_PARAM, 5U, 2U, &gWireGuidParam.qam_noise, 0L, 1000L },
+	{ OBJDICT_WG_PARAM, 6U, 2U, &gWireGuidParam.calib_delay, 0L, 500L },
+	{ OBJDICT_WG_PARAM, 7U, 2U, &gWireGuidParam.calib_min_time, 1L, 1000L },
+	{ OBJDICT_WG_PARAM, 8U, 2U, &gWireGuidParam.calib_max_time, 1L, 1000L },
+	{ OBJDICT_WG_PARAM, 9U, 2U, &gWireGuidParam.calib_min_param, 0L, 20000L },
+	{ OBJDICT_WG_PARAM, 10U, 2U | OBJDICT_SIGNED, &gWireGuidParam.bit_max_refvolt_short_circuit, 0L, 4095L },
+	{ OBJDICT_WG_PARAM, 11U, 2U | OBJDICT_SIGNED, &gWireGuidParam.bit_min_refvolt, 0L, 4095L },
+	{ OBJDICT_WG_PARAM, 12U, 2U | OBJDICT_SIGNED, &gWireGuidParam.bit_max_refvolt, 0L, 4095L },
+	#endif
+};
+
+#define OBJDICT_NBR_ENTRIES	(sizeof(ObjdictEntry)/sizeof(ObjdictEntry[0]))
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+/* Expedited upload response of size bytes */
+static void objdict_upload(Uint8 *response, Uint32 value, Uint8 size)
+{
+	response[0] = SDO_SCS_UPLOAD | (Uint8)((4U - size) << 2);
+	response[4] = (Uint8)value;
+	response[5] = (Uint8)(value >> 8);
+	response[6] = (Uint8)(value >> 16);
+	response[7] = (Uint8)(value >> 24);
+
+	return;
+}
+
+/*************************************************************************/
+static void objdict_abort(Uint8 *response, Uint32 code)
+{
+	response[0] = SDO_ABORT;
+	response[4] = (Uint8)code;
+	response[5] = (Uint8)(code >> 8);
+	response[6] = (Uint8)(code >> 16);
+	response[7] = (Uint8)(code >> 24);
+
+	return;
+}
+
+/*************************************************************************/
+/* Store (0x1010) and restore (0x1011) objects. Returns the abort code, 0 if ok. */
+static Uint32 objdict_store_restore(Uint16 index, Uint8 subindex, sbool upload,
+									Uint32 value, Uint8 *response)
+{
+	if (subindex > 1U)
+		return SDO_ABORT_NO_SUBINDEX;
+
+	if (upload)
+	{
+		/* Sub 0: highest sub-index, sub 1: parameters are stored on command only */
+		objdict_upload(response, 1UL, (subindex == 0U) ? 1U : 4U);
+		return 0UL;
+	}
+
+	if (subindex == 0U)
+		return SDO_ABORT_READ_ONLY;
+
+	#if GUIDANCE_WIRE
+	if ((index == OBJDICT_STORE) && (value == OBJDICT_SIGNATURE_SAVE))
+	{
+		if (!WireGuid_param_store())
+			return SDO_ABORT_STORE;
+	}
+	else if ((index == OBJDICT_RESTORE) && (value == OBJDICT_SIGNATURE_LOAD))
+	{
+		/* Defaults are active and stored at once */
+		WireGuid_param_defaults();
+		if (!WireGuid_param_store())
+			return SDO_ABORT_STORE;
+	}
+	else
+		return SDO_ABORT_STORE;
+	#else
+	return SDO_ABORT_STORE;
+	#endif
+
+	response[0] = SDO_SCS_DOWNLOAD;
+
+	return 0UL;
+}
+
+/*************************************************************************/
+/* Read or write an entry of the table. Returns the abort code, 0 if ok. */
+static Uint32 objdict_access(Uint16 index, Uint8 subindex, sbool upload,
+							 Uint32 value, Uint8 length, Uint8 *response)
+{
+	Uint8	ix;
+	Uint8	highest = 0U;
+	sbool	index_found = false;
+	const T_objdict_entry_t	*pEntry = NULL;
+	Uint8	size;
+	int32	signed_value;
+
+	for (ix = 0U; ix < OBJDICT_NBR_ENTRIES; ++ix)
+	{
+		if (ObjdictEntry[ix].index != index)
+			continue;
+		index_found = true;
+		if (ObjdictEntry[ix].subindex > highest)
+			highest = ObjdictEntry[ix].subindex;
+		if (ObjdictEntry[ix].subindex == subindex)
+			pEntry = &ObjdictEntry[ix];
+	}
+
+	if (!index_found)
+		return SDO_ABORT_NO_OBJECT;
+
+	if (pEntry == NULL)
+	{
+		if ((subindex != 0U) || (highest == 0U))
+			return SDO_ABORT_NO_SUBINDEX;
+		if (!upload)
+			return SDO_ABORT_READ_ONLY;
+		objdict_upload(response, (Uint32)highest, 1U);
+		return 0UL;
+	}
+
+	size = pEntry->attr & OBJDICT_SIZE_MASK;
+
+	if (upload)
+	{
+		if (size == 1U)
+			value = *(const Uint8*)pEntry->data;
+		else if (size == 2U)
+			value = *(const Uint16*)pEntry->data;
+		else
+			value = *(const Uint32*)pEntry->data;
+		objdict_upload(response, value, size);
+		return 0UL;
+	}
+
+	if (pEntry->attr & OBJDICT_RO)
+		return SDO_ABORT_READ_ONLY;
+
+	/* Length 0: not indicated by the client */
+	if ((length != 0U) && (length != size))
+		return SDO_ABORT_LENGTH;
+
+	if (size == 1U)
+		signed_value = (pEntry->attr & OBJDICT_SIGNED) ? (int32)(int8)value : (int32)(Uint8)value;
+	else if (size == 2U)
+		signed_value = (pEntry->attr & OBJDICT_SIGNED) ? (int32)(int16)value : (int32)(Uint16)value;
+	else
+		signed_value = (int32)value;
+
+	if ((signed_value < pEntry->min) || (signed_value > pEntry->max))
+		return SDO_ABORT_RANGE;
+
+	if (size == 1U)
+		*(Uint8*)pEntry->data = (Uint8)value;
+	else if (size == 2U)
+		*(Uint16*)pEntry->data = (Uint16)value;
+	else
+		*(Uint32*)pEntry->data = value;
+
+	response[0] = SDO_SCS_DOWNLOAD;
+
+	return 0UL;
+}
+
+//*****************************************************************************
+// Local functions
+//*****************************************************************************
+/*! Objdict_sdo_request() processes an SDO request of OBJDICT_SDO_LENGTH bytes
+	and fills the response. Index and sub-index (bytes 1-3) are copied to the
+	response. Changed parameters are active at once; they are kept after a
+	reset only when stored through 0x1010.
+*/
+void Objdict_sdo_request(const Uint8 *request, Uint8 *response)
+{
+	Uint16	index;
+	Uint8	subindex;
+	Uint32	value;
+	Uint8	length = 0U;
+	Uint32	abort;
+
+	index    = (Uint16)request[1] | ((Uint16)request[2] << 8);
+	subindex = request[3];
+	value    = (Uint32)request[4] | ((Uint32)request[5] << 8) |
+				((Uint32)request[6] << 16) | ((Uint32)request[7] << 24);
+
+	memset((void*)response, 0, OBJDICT_SDO_LENGTH);
+	response[1] = request[1];
+	response[2] = request[2];
+	response[3] = request[3];
+
+	if ((request[0] & SDO_CCS_MASK) == SDO_CCS_UPLOAD)
+	{
+		if ((index == OBJDICT_STORE) || (index == OBJDICT_RESTORE))
+			abort = objdict_store_restore(index, subindex, true, 0UL, response);
+		else
+			abort = objdict_access(index, subindex, true, 0UL, 0U, response);
+	}
+	else if (((request[0] & SDO_CCS_MASK) == SDO_CCS_DOWNLOAD) && (request[0] & SDO_EXPEDITED))
+	{
+		if (request[0] & SDO_SIZE_INDICATED)
+			length = 4U - ((request[0] >> 2) & 0x03U);
+
+		if ((index == OBJDICT_STORE) || (index == OBJDICT_RESTORE))
+			abort = ((length != 0U) && (length != 4U)) ? SDO_ABORT_LENGTH :
+						objdict_store_restore(index, subindex, false, value, response);
+		else
+			abort = objdict_access(index, subindex, false, value, length, response);
+	}
+	else
+	{
+		/* Segmented and block transfers are not supported */
+		abort = SDO_ABORT_COMMAND;
+	}
+
+	if (abort != 0UL)
+		objdict_abort(response, abort);
+
+	return;
+}
@@ -0,0 +1,95 @@
+// 2014 - 2015
+
+/*! \file perf.c
+    \brief Contains the run-time performance counters
+*/
+
+#include "project_canantenna.h"
+
+//*****************************************************************************
+// Local variables
+//*****************************************************************************
+static T_perf_probe_t	PerfProbe[PERF_PROBE_LAST];
+
+//*****************************************************************************
+// Local functions
+//*****************************************************************************
+/*! Perf_init() clears the counters and configures Timer2 as free-running TCY
+	counter. Timer2 is started by System_init(). */
+void Perf_init(void)
+{
+	Uint8	probe;
+
+	memset((void*)PerfProbe, 0, sizeof(PerfProbe));
+	for (probe = 0U; probe < PERF_PROBE_LAST; ++probe)
+		PerfProbe[probe].min = 0xFFFFU;
+
+	/* - 1:1 prescaler, internal clock, no interrupt
+		- Continue in Idle mode */
+	TMR2			= 0;
+	PR2				= 0xFFFF;
+	T2CONbits.TCS	= 0;
+	T2CONbits.TCKPS	= 0;
+	T2CONbits.TSIDL	= 0;
+
+	return;
+}
+
+/*! Perf_record() adds the time from start (PERF_STAMP) until now to a probe.
+	Longer times than the Timer2 period (3.28 msec) are not seen. */
+void Perf_record(Uint8 probe, Uint16 start)
+{
+	T_perf_probe_t	*pProbe = &PerfProbe[probe];
+	Uint16			cycles = PERF_STAMP() - start;
+	Uint16			bits = cycles >> 6;
+	Uint8			bin = 0U;
+
+	while ((bits != 0U) && (bin < (PERF_BINS - 1U)))
+	{
+		bits >>= 1;
+		++bin;
+	}
+
+	if (pProbe->histogram[bin] < 0xFFFFU)
+		++pProbe->histogram[bin];
+	if (cycles < pProbe->min)
+		pProbe->min = cycles;
+	if (cycles > pProbe->max)
+		pProbe->max = cycles;
+
+	/* Running mean: halve the sum and count before the count overflows */
+	if (pProbe->count == 0xFFFFU)
+	{
+		pProbe->sum		>>= 1;
+		pProbe->count	>>= 1;
+	}
+	pProbe->sum += cycles;
+	++pProbe->count;
+
+	return;
+}
+
+/*! Perf_probe() returns the counters of a probe */
+const T_perf_probe_t *Perf_probe(Uint8 probe)
+{
+	return &PerfProbe[probe];
+}
+
+/*! Perf_mean() returns the mean time of a probe [TCY], 0 when not measured.
+	The probes of interrupts are read with the interrupt disabled. */
+Uint16 Perf_mean(Uint8 probe)
+{
+	Uint16	ie_adc = IEC0bits.ADIE;
+	Uint16	ie_c1 = IEC1bits.C1IE;
+	Uint32	sum;
+	Uint16	count;
+
+	IEC0bits.ADIE = 0;
+	IEC1bits.C1IE = 0;
+	sum   = PerfProbe[probe].sum;
+	count = PerfProbe[probe].count;
+	IEC1bits.C1IE = ie_c1;
+	IEC0bits.ADIE = ie_adc;
+
+	return (count == 0U) ? 0U : (Uint16)(sum / count);
+}
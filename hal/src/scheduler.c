@@ -0,0 +1,425 @@
+// 2014 - 2015
+
+/*! \file scheduler.c
+    \brief Contains the cooperative run-to-completion task scheduler and the
+           tasks of the CAN antenna
+*/
+
+#include "project_canantenna.h"
+
+//*****************************************************************************
+// Prototypes
+//*****************************************************************************
+static void sched_task_batch(Uint8 release);
+static void sched_task_pdo(Uint8 release);
+static void sched_task_can(Uint8 release);
+static void sched_task_guidance(Uint8 release);
+static void sched_task_bit(Uint8 release);
+static void sched_task_eeprom(Uint8 release);
+static void sched_task_diagnostic(Uint8 release);
+static void sched_load_update(void);
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+static const T_sched_task_t __attribute__((space(auto_psv)))
+SchedTask[SCHED_TASK_LAST] = {
+	{ sched_task_batch,			0U,		5U },		// SCHED_TASK_BATCH
+	{ sched_task_pdo,			10U,	5U },		// SCHED_TASK_PDO
+	{ sched_task_can,			10U,	10U },		// SCHED_TASK_CAN
+	{ sched_task_guidance,		10U,	10U },		// SCHED_TASK_GUIDANCE
+	{ sched_task_bit,			10U,	10U },		// SCHED_TASK_BIT
+	{ sched_task_eeprom,		100U,	100U },		// SCHED_TASK_EEPROM
+	{ sched_task_diagnostic,	1000U,	1000U }		// SCHED_TASK_DIAGNOSTIC
+};
+
+//*****************************************************************************
+// Local variables
+//*****************************************************************************
+static T_sched_state_t	SchedState[SCHED_TASK_LAST];
+
+/* A batch has been processed, the PDO task evaluates the PDO's at once */
+static sbool			SchedBatchDone;
+
+static T_sched_load_t	SchedLoad;
+
+//*****************************************************************************
+// Tasks
+//*****************************************************************************
+static void sched_task_batch(Uint8 release)
+{
+	if (Guid_batch(&gGuidanceData))
+	{
+		SchedBatchDone = true;
+		Sched_signal(SCHED_TASK_PDO);
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* Released every 100Hz tick, after a batch and by a received SYNC */
+static void sched_task_pdo(Uint8 release)
+{
+	sbool	batch = SchedBatchDone;
+
+	SchedBatchDone = false;
+	if (!Can_pdo_pass(&(gSystemData.can_data), (release & SCHED_RELEASE_PERIOD) != 0U, batch))
+		return;
+
+	#if DISABLE_ADC_ISR_CAN
+	// Disable A/D interrupt so that it does not interfere
+	IEC0bits.ADIE = 0; // Control Bit for individual enabling/disabling of A/D interrupt
+	#endif
+
+	/* Measure clock ticks for TX Results, Statuses, Raws functions (calls) */
+	#ifdef FUNCTION_CALL_CAN
+	t_can[1] = clock();
+	#endif
+	Can_transmit_wireguid_result(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
+									gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_0].content);
+	#ifdef FUNCTION_CALL_CAN
+	t_can[1] = clock() - t_can[1];
+	t_can[2] = clock();
+	#endif
+	Can_transmit_wireguid_status(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
+									gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_1].content);
+	#ifdef FUNCTION_CALL_CAN
+	t_can[2] = clock() - t_can[2];
+	t_can[3] = clock();
+	#endif
+	Can_transmit_wireguid_raw(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
+								gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_2].content);
+	#ifdef FUNCTION_CALL_CAN
+	t_can[3] = clock() - t_can[3];
+	#endif
+
+	#if DISABLE_ADC_ISR_CAN
+	// Re-enable A/D interrupt
+	IEC0bits.ADIE = 1;
+	#endif
+
+	Can_transmit_wireguid_switches(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
+									gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_3].content);
+
+	return;
+}
+
+/*************************************************************************/
+static void sched_task_can(Uint8 release)
+{
+	/* Complete CAN start-up, process received commands */
+	Can_process(&(gSystemData.can_data));
+
+	return;
+}
+
+/*************************************************************************/
+static void sched_task_guidance(Uint8 release)
+{
+	Guid_process(&gGuidanceData);
+
+	return;
+}
+
+/*************************************************************************/
+static void sched_task_bit(Uint8 release)
+{
+	Guid_bit(&gGuidanceData);
+
+	return;
+}
+
+/*************************************************************************/
+/* Queue changed records; the writes are done by the NVM interrupt */
+static void sched_task_eeprom(Uint8 release)
+{
+	Guid_store(&gGuidanceData);
+	Can_store(&(gSystemData.can_data));
+
+	return;
+}
+
+/*************************************************************************/
+/* Update the CPU load, report the Timer1 entry latency when above its bound
+	and one task with new deadline misses or overruns per run */
+static void sched_task_diagnostic(Uint8 release)
+{
+	Uint8	task;
+
+	sched_load_update();
+	#if SCHED_LOAD_REPORT
+	Can_diagnostic(&(gSystemData.can_data), CAN_DIAG_PAGE_LOAD, 0U);
+	#endif
+
+	if (Interrupt_bound_report())
+		Can_diagnostic(&(gSystemData.can_data), CAN_DIAG_PAGE_INT, INT_SOURCE_T1);
+
+	task = Sched_report_next();
+	if (task < SCHED_TASK_LAST)
+		Can_diagnostic(&(gSystemData.can_data), CAN_DIAG_PAGE_SCHED, task);
+
+	return;
+}
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+/* Time [usec] from the msec counter and Timer1, which counts TCY within the
+	msec. A period match not yet serviced (interrupts masked) adds its msec. */
+static Uint32 sched_time_usec(void)
+{
+	Uint16	msec;
+	Uint16	count;
+	Uint16	pending;
+
+	do{
+		msec    = gSystemData.clockT1SysData.ticks_free_msec;
+		count   = TMR1;
+		pending = (IFS0bits.T1IF && (count < (TMR1_PERIOD / 2U))) ? 1U : 0U;
+	} while (msec != gSystemData.clockT1SysData.ticks_free_msec);
+	msec += pending;
+
+	return ((Uint32)msec * 1000UL) + (((Uint32)count * TCY_NANOSEC) / 1000UL);
+}
+
+/*************************************************************************/
+/* Time [usec] from start to now, across the wrap of the timebase */
+static Uint32 sched_elapsed_usec(Uint32 start, Uint32 now)
+{
+	if (now < start)
+		now += SCHED_TIME_WRAP_USEC;
+
+	return now - start;
+}
+
+/*************************************************************************/
+/* Release the periodic tasks whose period expired. A task that is still
+	pending at its next release counts an overrun for every skipped period. */
+static void sched_release(void)
+{
+	Uint16				now = gSystemData.clockT1SysData.ticks_free_msec;
+	T_sched_state_t		*pState;
+	Uint8				task;
+
+	for (task = 0U; task < SCHED_TASK_LAST; ++task)
+	{
+		pState = &SchedState[task];
+		if ((SchedTask[task].period == 0U) || ((int16)(now - pState->next_release) < 0))
+			continue;
+
+		if (pState->released)
+			++pState->overrun;
+		else
+		{
+			pState->released		= true;
+			pState->release_time	= pState->next_release;
+		}
+		pState->next_release += SchedTask[task].period;
+
+		while ((int16)(now - pState->next_release) >= 0)
+		{
+			pState->next_release += SchedTask[task].period;
+			++pState->overrun;
+		}
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* Run a pending task and update its statistics */
+static void sched_dispatch(Uint8 task)
+{
+	T_sched_state_t		*pState = &SchedState[task];
+	Uint8				release = 0U;
+	Uint16				release_time = 0U;
+	Uint16				latency;
+	Uint32				start;
+	Uint32				duration;
+
+	if (pState->released)
+	{
+		release			|= SCHED_RELEASE_PERIOD;
+		release_time	= pState->release_time;
+		pState->released = false;
+	}
+	if (pState->signalled)
+	{
+		/* Events signalled while the task runs release it again */
+		if (!(release & SCHED_RELEASE_PERIOD) || ((int16)(pState->signal_time - release_time) < 0))
+			release_time = pState->signal_time;
+		release |= SCHED_RELEASE_EVENT;
+		pState->signalled = false;
+	}
+
+	start = sched_time_usec();
+	latency = (Uint16)(start / 1000UL) - release_time;
+	if (latency > pState->latency_max)
+		pState->latency_max = (latency > 0xFFU) ? 0xFFU : (Uint8)latency;
+
+	SchedTask[task].run(release);
+
+	duration = sched_elapsed_usec(start, sched_time_usec());
+	if (duration > pState->wcet)
+		pState->wcet = (duration > 0xFFFFUL) ? 0xFFFFU : (Uint16)duration;
+
+	if ((Uint16)(gSystemData.clockT1SysData.ticks_free_msec - release_time) > SchedTask[task].deadline)
+		++pState->deadline_miss;
+
+	if (pState->runs < 0xFFFFU)
+		++pState->runs;
+
+	return;
+}
+
+#if SCHED_IDLE
+/*************************************************************************/
+/* Enter Idle mode until the next interrupt. All interrupts are masked while
+	checking for pending tasks, so that an event cannot be lost between the
+	check and Idle(); a masked interrupt still wakes the CPU and is serviced
+	as soon as the priority is restored. */
+static void sched_idle(void)
+{
+	Uint16	ipl = SRbits.IPL;
+	Uint32	start;
+	Uint8	task;
+
+	SRbits.IPL = 7;
+	for (task = 0U; task < SCHED_TASK_LAST; ++task)
+	{
+		if (SchedState[task].signalled)
+			break;
+	}
+
+	if (task == SCHED_TASK_LAST)
+	{
+		start = sched_time_usec();
+		Idle();
+		SchedLoad.idle_usec += sched_elapsed_usec(start, sched_time_usec());
+		++SchedLoad.entries;
+	}
+	SRbits.IPL = ipl;
+
+	return;
+}
+#endif
+
+/*************************************************************************/
+/* CPU load of the window since the last update, the time not spent idle */
+static void sched_load_update(void)
+{
+	Uint32	now = sched_time_usec();
+	Uint32	window = sched_elapsed_usec(SchedLoad.window_start, now) / 1000UL;
+	Uint32	idle;
+
+	if (window == 0UL)
+		return;
+
+	idle = SchedLoad.idle_usec / window;
+	if (idle > 1000UL)
+		idle = 1000UL;
+
+	SchedLoad.load			= 1000U - (Uint16)idle;
+	if (SchedLoad.load > SchedLoad.load_max)
+		SchedLoad.load_max	= SchedLoad.load;
+	SchedLoad.idle_entries	= SchedLoad.entries;
+	SchedLoad.entries		= 0U;
+	SchedLoad.idle_usec		= 0UL;
+	SchedLoad.window_start	= now;
+
+	return;
+}
+
+//*****************************************************************************
+// Local functions
+//*****************************************************************************
+/*! Sched_init() clears the statistics. Periodic tasks are released from the
+	first msec on. */
+void Sched_init(void)
+{
+	Uint16	now = gSystemData.clockT1SysData.ticks_free_msec;
+	Uint8	task;
+
+	memset((void*)SchedState, 0, sizeof(SchedState));
+	for (task = 0U; task < SCHED_TASK_LAST; ++task)
+		SchedState[task].next_release = now;
+	SchedBatchDone = false;
+
+	memset((void*)&SchedLoad, 0, sizeof(SchedLoad));
+	SchedLoad.window_start = sched_time_usec();
+
+	return;
+}
+
+/*! Sched_run() runs the pending task with the highest priority, forever. The
+	CPU idles (SCHED_IDLE) when no task is pending, until the next interrupt.
+	The A/D interrupt limits the idle time to one sample period; Timer1 and
+	CAN interrupts also wake the CPU. Peripherals keep running in Idle mode.
+*/
+void Sched_run(void)
+{
+	Uint8	task;
+
+	do{
+		sched_release();
+
+		for (task = 0U; task < SCHED_TASK_LAST; ++task)
+		{
+			if (SchedState[task].released || SchedState[task].signalled)
+				break;
+		}
+
+		if (task < SCHED_TASK_LAST)
+			sched_dispatch(task);
+		#if SCHED_IDLE
+		else
+			sched_idle();
+		#endif
+	} while(1);
+}
+
+/*! Sched_signal() releases an event task. It may be called from interrupts. */
+void Sched_signal(Uint8 task)
+{
+	if (!SchedState[task].signalled)
+	{
+		SchedState[task].signal_time	= gSystemData.clockT1SysData.ticks_free_msec;
+		SchedState[task].signalled		= true;
+	}
+
+	return;
+}
+
+/*! Sched_state() returns the statistics of a task */
+const T_sched_state_t *Sched_state(Uint8 task)
+{
+	return &SchedState[task];
+}
+
+/*! Sched_report_next() returns the first task with deadline misses or overruns
+	not yet reported, SCHED_TASK_LAST when there is none. The task is marked as
+	reported. */
+Uint8 Sched_report_next(void)
+{
+	Uint8	task;
+	Uint16	events;
+
+	for (task = 0U; task < SCHED_TASK_LAST; ++task)
+	{
+		events = SchedState[task].deadline_miss + SchedState[task].overrun;
+		if (events != SchedState[task].reported)
+		{
+			SchedState[task].reported = events;
+			break;
+		}
+	}
+
+	return task;
+}
+
+/*! Sched_load() returns the CPU load, updated every second */
+const T_sched_load_t *Sched_load(void)
+{
+	return &SchedLoad;
+}
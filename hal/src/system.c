@@ -99,21 +99,31 @@ void System_init(void)
 	SR = 0x0000;
   
 	/* Configure systems */
-	/* Clock (Timer1 and 3) */
+	/* Clock (Timer1 and 3). Timer1 is started here, so start-up time is counted
+		from reset. Its interrupt is enabled by Interrupt_init(). */
 	Clock_init();
+	T1CONbits.TON = 1;
+	/* Performance counters (Timer2) */
+	Perf_init();
+	#if PERF_COUNTERS
+	T2CONbits.TON = 1;
+	#endif
+	gSystemData.bootTiming.can_ready_msec = 0U;
+	gSystemData.bootTiming.first_deviation_msec = 0U;
 	/* ADC */
 	Adc_init();
+	#if SAMPLE_CAPTURE
+	Capture_init();
+	#endif
 
 	/* Output compare (uses Timer 3)*/
 	OC_init();
 
-	/* CAN init */
+	/* CAN init: configuration is completed by Can_process(), without waiting here */
 	Can_init();
 
-	/* EEPROM init */
+	/* EEPROM init. The self-test is run on request (CAN command) */
 	eeprom_init(&(gSystemData.eeprom_data));
-	// Test EEPROM read/write procedures
-	eeprom_test_read_write(&(gSystemData.eeprom_data));
 
 	/* Configure the interrupts and enable required interrupts */
 	Interrupt_init();
@@ -125,8 +135,7 @@ void System_init(void)
      if needed */
 void System_start(void)
 {
-	/* - Clock (Timer1) */
-	T1CONbits.TON = 1;
+	/* - Clock (Timer1) is started by System_init() */
 
 	/* Timer 3 enabled for PWM */
 	T3CONbits.TON = 1;
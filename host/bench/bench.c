@@ -0,0 +1,1049 @@
+// 2014 - 2015
+
+/*! \file bench.c
+    \brief Host tool: deviation accuracy and latency benchmark. The wires of
+           the 4 Input Frequencies follow offset trajectories (steps, ramp,
+           sine), siggen generates the antenna samples and replay runs them
+           through the guidance code. The fine deviation of every batch is
+           scored against the true offset at the window centre.
+
+    Usage:  bench [options]
+      -c name       run this configuration only, see -L
+      -t name       run this trajectory only: step, ramp or sine
+      -e name       run this deviation model only: formula or lut
+      -S seed       noise seed, default 1
+      -o file       results CSV, default stdout
+      -L            list the configurations and exit
+      -q            run the CAN transmit queue case instead, see below
+      -s            run the multi-node SYNC case instead, see below
+
+    A configuration is first calibrated with the wires under the antenna
+    centre, as an antenna is at installation; when the calibration fails the
+    default gains are used. It is then gauged: the mean fine deviation at the offsets
+    -BENCH_GAUGE and +BENCH_GAUGE gives the sensitivity [counts/m] of every
+    Input Frequency, with which the deviations are converted to metres.
+
+    Every configuration runs with both deviation models: the formula of the
+    amplitudes and, with DEVIATION_LUT, the lookup table of an extended
+    calibration. The extended calibration follows the gain calibration: a
+    reference every BENCH_LUT_STEP from -BENCH_LUT_RANGE to +BENCH_LUT_RANGE,
+    the table stored from them. The table is of Input Frequency 1 only, the
+    other Input Frequencies use the formula and have no lut rows.
+
+    One CSV line per configuration, trajectory and Input Frequency:
+      build       revision, window size, window, sample rate and engine
+                  (with the deviation model) of the guidance code, so results
+                  of several commits compare
+      config      coil model, wire amplitude, height, coil spacing, noise,
+                  batch latency, calibrated
+      score       sensitivity, scored batches, invalid rate, bias, RMS and
+                  largest error [mm], step response latency: mean and largest
+                  batches from the step until the deviation is within 10% of
+                  the step, and the mean time [ms] until that batch is output
+      batches     mean batch period [ms], mean and largest batch latency
+                  [ms] from the last sample of a window until its batch is
+                  processed
+
+    Step: the error is scored on windows without a step only, the transients
+    are given by the latency. Ramp and sine: all windows, the lag of the
+    window is part of the error.
+
+    CAN transmit queue case (-q): the bus is stalled for BENCH_CAN_STALL
+    ticks of 100Hz, the PDO task queues a changed deviation (high priority),
+    the cyclic status and raw values and a diagnostic page (low priority)
+    every tick. The queue fills, low priority messages are evicted by high
+    priority ones, then new messages are dropped. The bus is then released,
+    every step transmits the loaded buffers and runs the CAN interrupt until
+    the queue is empty. One CSV line per tick and step: transmitted
+    messages, queued messages, highest number of queued messages, dropped
+    messages and the priorities of the queue, first entry first (3: high,
+    0: low). Fails when the queue is out of order, does not overflow or
+    does not drain.
+
+    Multi-node SYNC case (-s): BENCH_SYNC_NODES nodes start sampling at
+    different times, up to a window apart, and receive a SYNC every
+    BENCH_SYNC_PERIOD. Each node runs the guidance code, first with
+    free-running windows, then with the window started at the SYNC
+    (ANT_Sync_Window, ANT_Sync_Start as the CAN module calls them with
+    CAN_SYNC_REPHASE; the samples are gated by ANT_WaitSync as in the A/D
+    interrupt). One CSV line per mode and node: start of sampling, windows,
+    mean, smallest and largest time [ms] from a SYNC to the end of the
+    first window after it. The spread is the largest difference between
+    the nodes of that time. Fails when a re-phased node misses a SYNC or the
+    spread is a sample period or more.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "project_canantenna.h"
+#include "host_hal.h"
+#include "replay.h"
+#include "siggen.h"
+
+#ifndef BENCH_REVISION
+#define BENCH_REVISION		"unknown"
+#endif
+
+/* The guidance code under test: Goertzel on Hanning-windowed Q15 samples */
+#define BENCH_WINDOW		"hanning"
+#define BENCH_ENGINE		"goertzel-q15"
+
+/* Trajectory amplitude, gauge offset [m] */
+#define BENCH_AMPLITUDE		(0.08)
+#define BENCH_GAUGE			(0.005)
+
+/* Time [sec] at the start offset before a trajectory is scored */
+#define BENCH_LEAD_IN		(0.5)
+
+/* Step response: settled within this part of the step */
+#define BENCH_SETTLED		(0.1)
+
+/* Longest calibration [sec], the calibration time limit [WG_CALIBRATION_TICK_MSEC] */
+#define BENCH_CALIB_TIME	(20.0)
+#define BENCH_CALIB_PARAM	"calib_max_time=1000"
+
+/* Extended calibration: Input Frequency of the table, reference offsets [m],
+   settling time at an offset [sec], fine deviation units of the table [1/m] */
+#define BENCH_LUT_FREQ		(0U)
+#define BENCH_LUT_RANGE		(0.10)
+#define BENCH_LUT_STEP		(0.02)
+#define BENCH_LUT_SETTLE	(0.1)
+#define BENCH_LUT_UNITS		(10000.0)
+
+/* CAN transmit queue case: ticks with the bus stalled, steps to drain the queue */
+#define BENCH_CAN_STALL		(12U)
+#define BENCH_CAN_DRAIN		(10U)
+
+/* Multi-node SYNC case: SYNC period, run time [sec], SYNC periods without
+   a window after the last SYNC before the windows are compared */
+#define BENCH_SYNC_PERIOD	(0.02)
+#define BENCH_SYNC_TIME		(1.0)
+#define BENCH_SYNC_PERIODS	(50U)
+#define BENCH_SYNC_LEAD_IN	(2U)
+#define BENCH_SYNC_NODES	(4U)
+
+#define BENCH_MAX_BATCHES	(1024)
+#define BENCH_MAX_EDGES		(4)
+
+#ifndef M_PI
+#define M_PI	(3.14159265358979323846)
+#endif
+
+typedef enum
+{
+	BENCH_GAUGE_TRAJ = 0,
+	BENCH_STEP,
+	BENCH_RAMP,
+	BENCH_SINE,
+	BENCH_TRAJ_LAST
+} E_bench_traj_t;
+
+typedef enum
+{
+	BENCH_MODEL_FORMULA = 0,
+	BENCH_MODEL_LUT,
+	BENCH_MODEL_LAST
+} E_bench_model_t;
+
+typedef struct
+{
+	const char		*name;
+	double			duration;		/* [sec], after the lead-in */
+} T_bench_traj_t;
+
+typedef struct
+{
+	const char		*name;
+	E_siggen_coil_t	coil;
+	double			amplitude;		/* Wire amplitude [A/D] at SIGGEN_REF_DISTANCE */
+	double			height;			/* [m] */
+	double			spacing;		/* [m] */
+	double			noise;			/* [A/D] */
+	Uint16			latency;		/* Samples from the end of a window to its batch */
+} T_bench_config_t;
+
+/* One processed batch */
+typedef struct
+{
+	Uint32	window_end;				/* ADC sample counter at the last sample of the window */
+	Uint32	output;					/* Sample at which the batch is processed */
+	int16	fine[NBR_INPUT_FREQ];
+} T_bench_batch_t;
+
+typedef struct
+{
+	Uint32	batches;
+	Uint32	invalid;
+	double	bias;					/* [m] */
+	double	rms;					/* [m] */
+	double	max;					/* [m] */
+	double	latency;				/* Batches, -1 when a step is not settled */
+	Uint32	latency_max;
+	double	latency_ms;
+	double	period_ms;				/* Mean time between processed batches */
+	double	batch_latency_ms;		/* Mean and largest time from the last sample of a window */
+	double	batch_latency_max_ms;	/* to its processed batch */
+} T_bench_score_t;
+
+// Local variables
+static const T_bench_traj_t BenchTraj[BENCH_TRAJ_LAST] = {
+	{ "gauge",	1.0 },		/* -BENCH_GAUGE, +BENCH_GAUGE after 0.5 sec */
+	{ "step",	3.5 },		/* 0, +A after 0.5 sec, -A after 1.5 sec, 0 after 2.5 sec */
+	{ "ramp",	3.0 },		/* -A to +A */
+	{ "sine",	4.0 }		/* A sin(2 pi 0.5Hz t) */
+};
+
+static const T_bench_config_t BenchConfig[] = {
+	{ "nominal",	SIGGEN_COIL_FIELD,		300.0,	0.10,	0.20,	2.0,	0U },
+	{ "noisy",		SIGGEN_COIL_FIELD,		300.0,	0.10,	0.20,	10.0,	0U },
+	{ "weak",		SIGGEN_COIL_FIELD,		150.0,	0.10,	0.20,	5.0,	0U },
+	{ "high",		SIGGEN_COIL_FIELD,		300.0,	0.20,	0.20,	2.0,	0U },
+	{ "horizontal",	SIGGEN_COIL_HORIZONTAL,	300.0,	0.10,	0.20,	2.0,	0U },
+	{ "late_batch",	SIGGEN_COIL_FIELD,		300.0,	0.10,	0.20,	2.0,	200U }
+};
+
+#define BENCH_CONFIGS	(sizeof(BenchConfig) / sizeof(BenchConfig[0]))
+
+static const char *CoilName[SIGGEN_COIL_LAST] = { "field", "horizontal", "vertical" };
+static const char *ModelName[BENCH_MODEL_LAST] = { "formula", "lut" };
+
+/* Multi-node SYNC case: start of the sampling of the nodes [sec] */
+static const double BenchSyncStart[BENCH_SYNC_NODES] = { 0.0, 0.00331, 0.00672, 0.00913 };
+
+static T_bench_batch_t	BenchBatch[BENCH_MAX_BATCHES];
+static Uint32			BenchBatches;
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+/* True offset [m] at time t [sec] after the lead-in, the start offset before */
+static double bench_offset(E_bench_traj_t traj, double t)
+{
+	if (t < 0.0)
+		t = 0.0;
+
+	switch (traj)
+	{
+		case BENCH_GAUGE_TRAJ:
+			return (t < 0.5) ? -BENCH_GAUGE : BENCH_GAUGE;
+		case BENCH_STEP:
+			if ((t < 0.5) || (t >= 2.5))
+				return 0.0;
+			return (t < 1.5) ? BENCH_AMPLITUDE : -BENCH_AMPLITUDE;
+		case BENCH_RAMP:
+			return BENCH_AMPLITUDE * ((2.0 * t / BenchTraj[BENCH_RAMP].duration) - 1.0);
+		case BENCH_SINE:
+		default:
+			return BENCH_AMPLITUDE * sin(2.0 * M_PI * 0.5 * t);
+	}
+}
+
+/*************************************************************************/
+/* Steps of a trajectory [sec after the lead-in], returns their number */
+static Uint8 bench_edges(E_bench_traj_t traj, double *edges)
+{
+	switch (traj)
+	{
+		case BENCH_GAUGE_TRAJ:
+			edges[0] = 0.5;
+			return 1U;
+		case BENCH_STEP:
+			edges[0] = 0.5;
+			edges[1] = 1.5;
+			edges[2] = 2.5;
+			return 3U;
+		default:
+			return 0U;
+	}
+}
+
+/*************************************************************************/
+/* Time [sec after the lead-in] of a sample */
+static double bench_time(Uint32 sample)
+{
+	return ((double)sample / SIGGEN_SAMPLE_RATE) - BENCH_LEAD_IN;
+}
+
+/*************************************************************************/
+/* First and last sample of the window of a batch */
+static Uint32 bench_window_first(const T_bench_batch_t *pBatch)
+{
+	return pBatch->window_end - (Uint32)HN_WDW_SZ;
+}
+
+static Uint32 bench_window_last(const T_bench_batch_t *pBatch)
+{
+	return pBatch->window_end - 1UL;
+}
+
+/*************************************************************************/
+/* Signal generator of a configuration */
+static void bench_siggen(const T_bench_config_t *pConfig, Uint32 seed, T_siggen_t *pGen)
+{
+	Uint8	i;
+
+	Siggen_init(pGen, seed);
+	pGen->coil			= pConfig->coil;
+	pGen->coil_spacing	= pConfig->spacing;
+	pGen->noise			= pConfig->noise;
+	for (i = 0U; i < pGen->nbr_wires; ++i)
+	{
+		pGen->wire[i].amplitude	= pConfig->amplitude;
+		pGen->wire[i].height	= pConfig->height;
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* Runs samples of the generator until sample n reaches end */
+static void bench_samples(T_siggen_t *pGen, Uint32 *n, Uint32 end)
+{
+	T_siggen_sample_t	sample;
+
+	for (; *n < end; ++(*n))
+	{
+		Siggen_sample(pGen, *n, &sample);
+		Replay_refvolt(sample.ref_left, sample.ref_right);
+		Replay_sample(sample.left, sample.right);
+	}
+
+	return;
+}
+
+#if DEVIATION_LUT
+/*************************************************************************/
+/* Extended calibration of a calibrated antenna, from sample n: a reference
+   of Input Frequency 1 at every offset, then the table is stored. Returns
+   false when a reference or the table is not taken. */
+static sbool bench_calibrate_lut(T_siggen_t *pGen, Uint32 n)
+{
+	T_wireGuid_t	*pWireGuidData = &(gGuidanceData.wireGuidData);
+	Uint32			end = n + (Uint32)(BENCH_CALIB_TIME * SIGGEN_SAMPLE_RATE);
+	Uint8			param[CAN_COMMAND_PARAM_SIZE];
+	double			x;
+	Uint8			i;
+
+	memset((void*)param, 0, sizeof(param));
+	param[0] = WG_LUT_CMD_CLEAR;
+	WireGuid_lut_command(pWireGuidData, param);
+
+	for (x = -BENCH_LUT_RANGE; x <= (BENCH_LUT_RANGE + 1e-6); x += BENCH_LUT_STEP)
+	{
+		/* Offset of the wire, positive to the right as the fine deviation of the formula */
+		int16	offset = (int16)floor((x * BENCH_LUT_UNITS) + 0.5);
+
+		for (i = 0U; i < pGen->nbr_wires; ++i)
+			pGen->wire[i].offset = x;
+		bench_samples(pGen, &n, n + (Uint32)(BENCH_LUT_SETTLE * SIGGEN_SAMPLE_RATE));
+
+		param[0] = WG_LUT_CMD_REFERENCE;
+		param[1] = (Uint8)((Uint16)offset >> 8);
+		param[2] = (Uint8)((Uint16)offset & 0x00FFU);
+		param[3] = BENCH_LUT_FREQ;
+		WireGuid_lut_command(pWireGuidData, param);
+		while ((pWireGuidData->lut_status == WG_LUT_STATUS_MEASURING) && (n < end))
+			bench_samples(pGen, &n, n + 1UL);
+		if (pWireGuidData->lut_status != WG_LUT_STATUS_IDLE)
+			return false;
+	}
+
+	param[0] = WG_LUT_CMD_STORE;
+	WireGuid_lut_command(pWireGuidData, param);
+	while ((pWireGuidData->lut_status == WG_LUT_STATUS_STORING) && (n < end))
+		bench_samples(pGen, &n, n + 1UL);
+
+	return (pWireGuidData->lut_status == WG_LUT_STATUS_SUCCEEDED);
+}
+#endif
+
+/*************************************************************************/
+/* Calibrates with the wires under the antenna centre. Returns false when
+   the calibration fails, else the calibration parameters in calib. lut
+   returns true when the extended calibration stored a table, which is then
+   the EEPROM_RECORD_LUT record. */
+static sbool bench_calibrate(const T_bench_config_t *pConfig, Uint32 seed, Uint16 *calib, sbool *lut)
+{
+	T_siggen_t			gen;
+	Uint32				samples = (Uint32)(BENCH_CALIB_TIME * SIGGEN_SAMPLE_RATE);
+	E_wg_calib_status_t	status = WG_CALIB_STATUS_START;
+	const Uint16		*record;
+	Uint16				writes;
+	Uint32				n;
+
+	*lut = false;
+	bench_siggen(pConfig, seed, &gen);
+	Host_record_erase(EEPROM_RECORD_LUT);
+	Replay_init(NULL, pConfig->latency);
+	Replay_param(BENCH_CALIB_PARAM);
+	Replay_calibrate();
+
+	for (n = 0UL; (n < samples) && (status != WG_CALIB_STATUS_SUCCEEDED) && (status != WG_CALIB_STATUS_FAILED); )
+	{
+		bench_samples(&gen, &n, n + 1UL);
+		status = Replay_result()->calibration_status;
+	}
+	record = Host_record(EEPROM_RECORD_CALIB, &writes);
+	if ((status != WG_CALIB_STATUS_SUCCEEDED) || (record == NULL) || (writes == 0U))
+		return false;
+
+	memcpy((void*)calib, (const void*)record, 2*NBR_INPUT_FREQ * sizeof(Uint16));
+	#if DEVIATION_LUT
+	*lut = bench_calibrate_lut(&gen, n);
+	#endif
+
+	return true;
+}
+
+/*************************************************************************/
+/* Runs a trajectory through the guidance code, the batches in BenchBatch.
+   calib: calibration parameters, NULL for none. */
+static void bench_run(const T_bench_config_t *pConfig, const Uint16 *calib, E_bench_traj_t traj, Uint32 seed)
+{
+	T_siggen_t			gen;
+	T_siggen_sample_t	sample;
+	Uint32				samples = (Uint32)((BENCH_LEAD_IN + BenchTraj[traj].duration) * SIGGEN_SAMPLE_RATE);
+	Uint32				n;
+	Uint8				i;
+
+	bench_siggen(pConfig, seed, &gen);
+	Replay_init(calib, pConfig->latency);
+	BenchBatches = 0UL;
+
+	for (n = 0UL; n < samples; ++n)
+	{
+		double	offset = bench_offset(traj, bench_time(n));
+
+		for (i = 0U; i < gen.nbr_wires; ++i)
+			gen.wire[i].offset = offset;
+		Siggen_sample(&gen, n, &sample);
+		Replay_refvolt(sample.ref_left, sample.ref_right);
+		if (!Replay_sample(sample.left, sample.right) || (BenchBatches >= BENCH_MAX_BATCHES))
+			continue;
+
+		BenchBatch[BenchBatches].window_end	= Replay_result()->window_end;
+		BenchBatch[BenchBatches].output		= n;
+		for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+			BenchBatch[BenchBatches].fine[i] = Replay_result()->deviation_fine[i];
+		++BenchBatches;
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* True if the window of a batch is scored: after the lead-in, and for a
+   step trajectory without a step in the window */
+static sbool bench_scored(E_bench_traj_t traj, const T_bench_batch_t *pBatch)
+{
+	double	edges[BENCH_MAX_EDGES];
+	double	first = bench_time(bench_window_first(pBatch));
+	double	last = bench_time(bench_window_last(pBatch));
+	Uint8	nbr_edges = bench_edges(traj, edges);
+	Uint8	e;
+
+	if (first < 0.0)
+		return false;
+	for (e = 0U; e < nbr_edges; ++e)
+	{
+		if ((first < edges[e]) && (last >= edges[e]))
+			return false;
+	}
+
+	return true;
+}
+
+/*************************************************************************/
+/* Sensitivity [counts/m] of Input Frequency freq from the gauge batches,
+   0 when no valid deviation */
+static double bench_gauge(Uint8 freq)
+{
+	double	sum[2] = { 0.0, 0.0 };
+	Uint32	count[2] = { 0UL, 0UL };
+	Uint32	b;
+
+	for (b = 0UL; b < BenchBatches; ++b)
+	{
+		const T_bench_batch_t	*pBatch = &BenchBatch[b];
+		Uint8					side;
+
+		if (!bench_scored(BENCH_GAUGE_TRAJ, pBatch) || (pBatch->fine[freq] == WG_DEVIATION_INVALID))
+			continue;
+		side = (bench_offset(BENCH_GAUGE_TRAJ, bench_time(bench_window_last(pBatch))) > 0.0) ? 1U : 0U;
+		sum[side] += pBatch->fine[freq];
+		++count[side];
+	}
+	if ((count[0] == 0UL) || (count[1] == 0UL))
+		return 0.0;
+
+	return ((sum[1] / count[1]) - (sum[0] / count[0])) / (2.0 * BENCH_GAUGE);
+}
+
+/*************************************************************************/
+/* Step response latency of Input Frequency freq */
+static void bench_latency(E_bench_traj_t traj, Uint8 freq, double slope, T_bench_score_t *pScore)
+{
+	double	edges[BENCH_MAX_EDGES];
+	Uint8	nbr_edges = bench_edges(traj, edges);
+	Uint32	sum = 0UL;
+	double	sum_ms = 0.0;
+	Uint8	e;
+
+	pScore->latency		= -1.0;
+	pScore->latency_max	= 0UL;
+	pScore->latency_ms	= -1.0;
+	if (nbr_edges == 0U)
+		return;
+
+	for (e = 0U; e < nbr_edges; ++e)
+	{
+		double	from = bench_offset(traj, edges[e] - 1e-3);
+		double	to = bench_offset(traj, edges[e]);
+		Uint32	edge_sample = (Uint32)((edges[e] + BENCH_LEAD_IN) * SIGGEN_SAMPLE_RATE);
+		Uint32	first;
+		Uint32	b;
+
+		/* First batch with a sample after the step in its window */
+		for (first = 0UL; (first < BenchBatches) && (bench_window_last(&BenchBatch[first]) < edge_sample); ++first)
+			;
+		for (b = first; b < BenchBatches; ++b)
+		{
+			int16	fine = BenchBatch[b].fine[freq];
+
+			if ((fine != WG_DEVIATION_INVALID) &&
+				(fabs((fine / slope) - to) <= (BENCH_SETTLED * fabs(to - from))))
+				break;
+		}
+		if (b >= BenchBatches)
+			return;
+
+		sum += b - first + 1UL;
+		sum_ms += 1000.0 * (BenchBatch[b].output + 1UL - edge_sample) / SIGGEN_SAMPLE_RATE;
+		if ((b - first + 1UL) > pScore->latency_max)
+			pScore->latency_max = b - first + 1UL;
+	}
+	pScore->latency		= (double)sum / nbr_edges;
+	pScore->latency_ms	= sum_ms / nbr_edges;
+
+	return;
+}
+
+/*************************************************************************/
+/* Batch period and batch latency of the batches of a trajectory */
+static void bench_batch_timing(T_bench_score_t *pScore)
+{
+	double	sum = 0.0;
+	Uint32	b;
+
+	pScore->period_ms				= 0.0;
+	pScore->batch_latency_ms		= 0.0;
+	pScore->batch_latency_max_ms	= 0.0;
+	if (BenchBatches == 0UL)
+		return;
+
+	for (b = 0UL; b < BenchBatches; ++b)
+	{
+		double	latency = 1000.0 * (BenchBatch[b].output - bench_window_last(&BenchBatch[b])) / SIGGEN_SAMPLE_RATE;
+
+		sum += latency;
+		if (latency > pScore->batch_latency_max_ms)
+			pScore->batch_latency_max_ms = latency;
+	}
+	pScore->batch_latency_ms = sum / BenchBatches;
+	if (BenchBatches > 1UL)
+		pScore->period_ms = 1000.0 * (BenchBatch[BenchBatches-1].output - BenchBatch[0].output) /
+							((BenchBatches - 1UL) * SIGGEN_SAMPLE_RATE);
+
+	return;
+}
+
+/*************************************************************************/
+/* Scores Input Frequency freq of the batches of a trajectory */
+static void bench_score(E_bench_traj_t traj, Uint8 freq, double slope, T_bench_score_t *pScore)
+{
+	double	sum = 0.0;
+	double	sum_sqr = 0.0;
+	Uint32	valid;
+	Uint32	b;
+
+	memset((void*)pScore, 0, sizeof(T_bench_score_t));
+	for (b = 0UL; b < BenchBatches; ++b)
+	{
+		const T_bench_batch_t	*pBatch = &BenchBatch[b];
+		double					centre;
+		double					error;
+
+		if (!bench_scored(traj, pBatch))
+			continue;
+		++pScore->batches;
+		if ((pBatch->fine[freq] == WG_DEVIATION_INVALID) || (slope == 0.0))
+		{
+			++pScore->invalid;
+			continue;
+		}
+
+		centre = 0.5 * (bench_time(bench_window_first(pBatch)) + bench_time(bench_window_last(pBatch)));
+		error = (pBatch->fine[freq] / slope) - bench_offset(traj, centre);
+		sum += error;
+		sum_sqr += error * error;
+		if (fabs(error) > pScore->max)
+			pScore->max = fabs(error);
+	}
+
+	valid = pScore->batches - pScore->invalid;
+	if (valid > 0UL)
+	{
+		pScore->bias	= sum / valid;
+		pScore->rms		= sqrt(sum_sqr / valid);
+	}
+	if (slope != 0.0)
+		bench_latency(traj, freq, slope, pScore);
+	else
+		pScore->latency = pScore->latency_ms = -1.0;
+	bench_batch_timing(pScore);
+
+	return;
+}
+
+/*************************************************************************/
+static void bench_header(FILE *out)
+{
+	fprintf(out, "revision,window_size,window,sample_rate,engine,"
+				 "config,coil,amplitude,height,spacing,noise,batch_latency,calibrated,"
+				 "trajectory,freq,slope,batches,invalid_rate,bias_mm,rms_mm,max_mm,"
+				 "step_latency_batches,step_latency_max,step_latency_ms,"
+				 "batch_period_ms,batch_latency_ms,batch_latency_max_ms\n");
+
+	return;
+}
+
+static void bench_row(FILE *out, const T_bench_config_t *pConfig, E_bench_model_t model, sbool calibrated,
+					  E_bench_traj_t traj, Uint8 freq, double slope, const T_bench_score_t *pScore)
+{
+	fprintf(out, "%s,%u,%s,%.1f,%s/%s,%s,%s,%g,%g,%g,%g,%u,%d,%s,%u,%.1f,%lu,%.4f,%.3f,%.3f,%.3f,",
+			BENCH_REVISION, (unsigned)HN_WDW_SZ, BENCH_WINDOW, SIGGEN_SAMPLE_RATE, BENCH_ENGINE, ModelName[model],
+			pConfig->name, CoilName[pConfig->coil], pConfig->amplitude, pConfig->height,
+			pConfig->spacing, pConfig->noise, pConfig->latency, calibrated ? 1 : 0,
+			BenchTraj[traj].name, freq + 1U, slope,
+			(unsigned long)pScore->batches,
+			(pScore->batches > 0UL) ? (double)pScore->invalid / pScore->batches : 0.0,
+			1000.0 * pScore->bias, 1000.0 * pScore->rms, 1000.0 * pScore->max);
+	if (pScore->latency >= 0.0)
+		fprintf(out, "%.2f,%lu,%.2f,", pScore->latency, (unsigned long)pScore->latency_max, pScore->latency_ms);
+	else
+		fprintf(out, ",,,");
+	fprintf(out, "%.3f,%.3f,%.3f\n", pScore->period_ms, pScore->batch_latency_ms, pScore->batch_latency_max_ms);
+
+	return;
+}
+
+//*****************************************************************************
+// CAN transmit queue
+//*****************************************************************************
+/* Priorities of the queued messages, first entry first. Returns false when
+   the queue is not ordered by priority. */
+static sbool bench_can_queue(const T_can_data_t *can_data, char *map)
+{
+	sbool	ordered = (can_data->tx_queue_count <= CAN_TX_QUEUE_SIZE);
+	Uint8	ix;
+
+	for (ix = 0U; (ix < can_data->tx_queue_count) && (ix < CAN_TX_QUEUE_SIZE); ++ix)
+	{
+		map[ix] = (char)('0' + can_data->tx_queue[ix].priority);
+		if ((ix > 0U) && (can_data->tx_queue[ix].priority > can_data->tx_queue[ix - 1U].priority))
+			ordered = false;
+	}
+	map[ix] = '\0';
+
+	return ordered;
+}
+
+/*************************************************************************/
+/* The bus transmits the loaded buffers: their request bit is cleared and the
+   CAN interrupt runs as on the transmit interrupts. Returns the number of
+   transmitted messages. */
+static Uint8 bench_can_transmit(void)
+{
+	Uint8	sent = 0U;
+	Uint8	b;
+
+	for (b = 0U; b < 3U; ++b)
+	{
+		if (HostC1TxBuffer[b][7] & 0x0008U)
+		{
+			HostC1TxBuffer[b][7] &= ~0x0008U;
+			++sent;
+		}
+	}
+	C1INTF = 0x001CU;
+	_C1Interrupt();
+	C1INTF = 0U;
+
+	return sent;
+}
+
+/*************************************************************************/
+static void bench_can_row(FILE *out, const char *phase, Uint8 step, Uint8 sent, const T_can_data_t *can_data,
+						  const char *map)
+{
+	fprintf(out, "%s,%s,%u,%u,%u,%u,%u,%s\n", BENCH_REVISION, phase, step, sent,
+			can_data->tx_queue_count, can_data->tx_queue_max, can_data->tx_dropped, map);
+
+	return;
+}
+
+/*************************************************************************/
+/* CAN transmit queue case, see the file description. Returns false when it fails. */
+static sbool bench_can_case(FILE *out)
+{
+	T_can_data_t	*can_data = &(gSystemData.can_data);
+	T_wireGuid_t	*pWireGuidData = &(gGuidanceData.wireGuidData);
+	char			map[CAN_TX_QUEUE_SIZE + 1];
+	sbool			ordered = true;
+	Uint32			sent = 0UL;
+	Uint8			step;
+	Uint8			n;
+
+	/* Start the CAN module, the mode changes are done at once */
+	Can_init();
+	for (step = 0U; (step < 4U) && (can_data->state != CAN_STATE_RUNNING); ++step)
+	{
+		C1CTRLbits.OPMODE = C1CTRLbits.REQOP;
+		Can_process(can_data);
+	}
+	if (can_data->state != CAN_STATE_RUNNING)
+	{
+		fprintf(stderr, "can queue: CAN module not started\n");
+		return false;
+	}
+
+	fprintf(out, "revision,phase,step,sent,queue_count,queue_max,tx_dropped,queue\n");
+
+	/* Stalled bus: the first messages are loaded in the transmit buffers and stay */
+	for (step = 1U; step <= BENCH_CAN_STALL; ++step)
+	{
+		pWireGuidData->deviation_m2ecm[0] += 100;
+		if (Can_pdo_pass(can_data, true, true))
+		{
+			Can_transmit_wireguid_result(pWireGuidData, can_data, can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_0].content);
+			Can_transmit_wireguid_status(pWireGuidData, can_data, can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_1].content);
+			Can_transmit_wireguid_raw(pWireGuidData, can_data, can_data->can_tx_msg_buffer[CAN_TX_MSG_BUFFER_2].content);
+		}
+		Can_diagnostic(can_data, CAN_DIAG_PAGE_TX_QUEUE, 0U);
+		ordered &= bench_can_queue(can_data, map);
+		bench_can_row(out, "stall", step, 0U, can_data, map);
+	}
+
+	/* Released bus */
+	for (step = 1U; (step <= BENCH_CAN_DRAIN) && (can_data->tx_queue_count > 0U); ++step)
+	{
+		n = bench_can_transmit();
+		sent += n;
+		ordered &= bench_can_queue(can_data, map);
+		bench_can_row(out, "release", step, n, can_data, map);
+	}
+	sent += bench_can_transmit();
+
+	fprintf(stderr, "can queue: max %u of %u, dropped %u, transmitted %lu, %s, %s\n",
+			can_data->tx_queue_max, (unsigned)CAN_TX_QUEUE_SIZE, can_data->tx_dropped, (unsigned long)sent,
+			ordered ? "ordered" : "OUT OF ORDER",
+			(can_data->tx_queue_count == 0U) ? "drained" : "NOT DRAINED");
+
+	return ordered && (can_data->tx_queue_max == CAN_TX_QUEUE_SIZE) && (can_data->tx_dropped > 0U) &&
+			(can_data->tx_queue_count == 0U);
+}
+
+//*****************************************************************************
+// Multi-node SYNC
+//*****************************************************************************
+/* Runs a node which starts sampling at start [sec]. end returns the time
+   [sec] of the last sample of the first window after each SYNC, -1 when
+   there is none. Returns the number of windows. */
+static Uint32 bench_sync_node(double start, sbool rephase, Uint32 seed, double *end)
+{
+	T_siggen_t	gen;
+	Uint32		n = 0UL;
+	Uint32		batches = 0UL;
+	Uint16		sync = 0U;
+	double		t;
+	Uint16		period;
+
+	for (period = 0U; period < BENCH_SYNC_PERIODS; ++period)
+		end[period] = -1.0;
+
+	Replay_init(NULL, 0U);
+	bench_siggen(&BenchConfig[0], seed, &gen);
+	ANT_Sync_Window(rephase);
+
+	for (t = start; t < BENCH_SYNC_TIME; t = start + (double)n / SIGGEN_SAMPLE_RATE)
+	{
+		/* A SYNC received before this sample */
+		while (t >= ((double)(sync + 1U) * BENCH_SYNC_PERIOD))
+		{
+			++sync;
+			if (rephase)
+				ANT_Sync_Start();
+		}
+
+		bench_samples(&gen, &n, n + 1UL);
+		if (Replay_batches() == batches)
+			continue;
+		batches = Replay_batches();
+
+		/* Sample counter of the last sample: 1 is the first sample */
+		t = start + (double)(Replay_result()->window_end - 1UL) / SIGGEN_SAMPLE_RATE;
+		period = (Uint16)floor(t / BENCH_SYNC_PERIOD);
+		if ((period < BENCH_SYNC_PERIODS) && (end[period] < 0.0))
+			end[period] = t;
+	}
+
+	return batches;
+}
+
+/*************************************************************************/
+/* Multi-node SYNC case of a mode, see the file description. Returns the
+   largest spread [sec], -1 when a node misses a SYNC period. */
+static double bench_sync_mode(FILE *out, sbool rephase, Uint32 seed)
+{
+	static double	end[BENCH_SYNC_NODES][BENCH_SYNC_PERIODS];
+	const char		*mode = rephase ? "rephase" : "free";
+	double			spread = 0.0;
+	double			sum = 0.0;
+	Uint32			compared = 0UL;
+	Uint32			windows;
+	Uint16			period;
+	Uint8			node;
+
+	for (node = 0U; node < BENCH_SYNC_NODES; ++node)
+	{
+		double	offset_sum = 0.0;
+		double	offset_min = BENCH_SYNC_PERIOD;
+		double	offset_max = 0.0;
+		Uint32	offsets = 0UL;
+
+		windows = bench_sync_node(BenchSyncStart[node], rephase, seed, end[node]);
+		for (period = BENCH_SYNC_LEAD_IN; period < BENCH_SYNC_PERIODS; ++period)
+		{
+			double	offset = end[node][period] - (double)period * BENCH_SYNC_PERIOD;
+
+			if (end[node][period] < 0.0)
+				continue;
+			offset_sum += offset;
+			offset_min = (offset < offset_min) ? offset : offset_min;
+			offset_max = (offset > offset_max) ? offset : offset_max;
+			++offsets;
+		}
+		if (offsets == 0UL)
+			offset_min = 0.0;
+		fprintf(out, "%s,%s,%u,%.3f,%lu,%.3f,%.3f,%.3f\n", BENCH_REVISION, mode, node + 1U,
+				1000.0 * BenchSyncStart[node], (unsigned long)windows,
+				(offsets > 0UL) ? 1000.0 * offset_sum / offsets : 0.0, 1000.0 * offset_min, 1000.0 * offset_max);
+	}
+
+	/* Spread of the nodes in every SYNC period */
+	for (period = BENCH_SYNC_LEAD_IN; period < BENCH_SYNC_PERIODS; ++period)
+	{
+		double	first = BENCH_SYNC_TIME;
+		double	last = 0.0;
+
+		for (node = 0U; node < BENCH_SYNC_NODES; ++node)
+		{
+			if (end[node][period] < 0.0)
+				break;
+			first = (end[node][period] < first) ? end[node][period] : first;
+			last = (end[node][period] > last) ? end[node][period] : last;
+		}
+		if (node < BENCH_SYNC_NODES)
+		{
+			if (rephase)
+				spread = -1.0;
+			continue;
+		}
+		if (spread >= 0.0)
+			spread = ((last - first) > spread) ? (last - first) : spread;
+		sum += last - first;
+		++compared;
+	}
+
+	fprintf(stderr, "sync %-7s %u nodes: spread mean %.3f ms, largest %.3f ms over %lu SYNC periods%s\n",
+			mode, (unsigned)BENCH_SYNC_NODES, (compared > 0UL) ? 1000.0 * sum / compared : 0.0,
+			(spread >= 0.0) ? 1000.0 * spread : 0.0, (unsigned long)compared,
+			(spread < 0.0) ? ", SYNC MISSED" : "");
+
+	return spread;
+}
+
+/*************************************************************************/
+/* Multi-node SYNC case. Returns false when it fails. */
+static sbool bench_sync_case(FILE *out, Uint32 seed)
+{
+	double	spread;
+
+	fprintf(out, "revision,mode,node,start_ms,windows,sync_to_end_ms,sync_to_end_min_ms,sync_to_end_max_ms\n");
+	(void)bench_sync_mode(out, false, seed);
+	spread = bench_sync_mode(out, true, seed);
+
+	return (spread >= 0.0) && (spread < (1.0 / SIGGEN_SAMPLE_RATE));
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-c config] [-t step|ramp|sine] [-e formula|lut] [-S seed] [-o file] [-L] [-q] [-s]\n", name);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	const char	*config_name = NULL;
+	const char	*traj_name = NULL;
+	const char	*model_name = NULL;
+	const char	*out_name = NULL;
+	FILE		*out = stdout;
+	Uint32		seed = 1UL;
+	Uint32		runs = 0UL;
+	sbool		can_case = false;
+	sbool		sync_case = false;
+	int			opt;
+	Uint8		c;
+
+	while ((opt = getopt(argc, argv, "c:t:e:S:o:Lqs")) != -1)
+	{
+		switch (opt)
+		{
+			case 'c':
+				config_name = optarg;
+				break;
+			case 't':
+				traj_name = optarg;
+				break;
+			case 'e':
+				model_name = optarg;
+				break;
+			case 'S':
+				seed = (Uint32)strtoul(optarg, NULL, 0);
+				break;
+			case 'o':
+				out_name = optarg;
+				break;
+			case 'L':
+				for (c = 0U; c < BENCH_CONFIGS; ++c)
+					printf("%s: %s coil, amplitude %g, height %g m, spacing %g m, noise %g, batch latency %u\n",
+						   BenchConfig[c].name, CoilName[BenchConfig[c].coil], BenchConfig[c].amplitude,
+						   BenchConfig[c].height, BenchConfig[c].spacing, BenchConfig[c].noise,
+						   BenchConfig[c].latency);
+				return 0;
+			case 'q':
+				can_case = true;
+				break;
+			case 's':
+				sync_case = true;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (out_name != NULL)
+	{
+		out = fopen(out_name, "w");
+		if (out == NULL)
+		{
+			perror(out_name);
+			return 1;
+		}
+	}
+	if (can_case || sync_case)
+	{
+		sbool	passed = can_case ? bench_can_case(out) : bench_sync_case(out, seed);
+
+		if (out != stdout)
+			fclose(out);
+		return passed ? 0 : 1;
+	}
+	bench_header(out);
+
+	for (c = 0U; c < BENCH_CONFIGS; ++c)
+	{
+		const T_bench_config_t	*pConfig = &BenchConfig[c];
+		Uint16					calib[2*NBR_INPUT_FREQ];
+		Uint16					table[EEPROM_RECORD_PAYLOAD_WORDS];
+		sbool					calibrated;
+		sbool					lut;
+		double					slope[NBR_INPUT_FREQ];
+		Uint8					model;
+		Uint8					traj;
+		Uint8					i;
+
+		if ((config_name != NULL) && (strcmp(config_name, pConfig->name) != 0))
+			continue;
+
+		calibrated = bench_calibrate(pConfig, seed, calib, &lut);
+		if (lut)
+			memcpy((void*)table, (const void*)Host_record(EEPROM_RECORD_LUT, NULL), sizeof(table));
+
+		for (model = 0U; model < BENCH_MODEL_LAST; ++model)
+		{
+			if ((model_name != NULL) && (strcmp(model_name, ModelName[model]) != 0))
+				continue;
+			/* Without a table the firmware uses the formula */
+			if (model == BENCH_MODEL_LUT)
+			{
+				if (!lut)
+				{
+					fprintf(stderr, "%-11s no lookup table\n", pConfig->name);
+					continue;
+				}
+				Host_record_preset(EEPROM_RECORD_LUT, table, EEPROM_RECORD_PAYLOAD_WORDS);
+			}
+			else
+				Host_record_erase(EEPROM_RECORD_LUT);
+
+			bench_run(pConfig, calibrated ? calib : NULL, BENCH_GAUGE_TRAJ, seed);
+			for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+				slope[i] = bench_gauge(i);
+
+			for (traj = BENCH_STEP; traj < BENCH_TRAJ_LAST; ++traj)
+			{
+				if ((traj_name != NULL) && (strcmp(traj_name, BenchTraj[traj].name) != 0))
+					continue;
+
+				bench_run(pConfig, calibrated ? calib : NULL, (E_bench_traj_t)traj, seed);
+				for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+				{
+					T_bench_score_t	score;
+
+					/* The table is used for its Input Frequency only */
+					if ((model == BENCH_MODEL_LUT) && (i != BENCH_LUT_FREQ))
+						continue;
+					bench_score((E_bench_traj_t)traj, i, slope[i], &score);
+					bench_row(out, pConfig, (E_bench_model_t)model, calibrated, (E_bench_traj_t)traj, i, slope[i], &score);
+					if (i != 0U)
+						continue;
+					fprintf(stderr, "%-11s %-7s %-5s freq 1: rms %7.2f mm, bias %7.2f mm, invalid %5.1f%%",
+							pConfig->name, ModelName[model], BenchTraj[traj].name, 1000.0 * score.rms,
+							1000.0 * score.bias, (score.batches > 0UL) ? 100.0 * score.invalid / score.batches : 0.0);
+					if (score.latency >= 0.0)
+						fprintf(stderr, ", step latency %.2f batches", score.latency);
+					fprintf(stderr, ", batch %.2f ms, latency %.2f ms", score.period_ms, score.batch_latency_ms);
+					fprintf(stderr, "%s\n", calibrated ? "" : " (not calibrated)");
+				}
+				++runs;
+			}
+		}
+	}
+
+	if (out != stdout)
+		fclose(out);
+	if (runs == 0UL)
+	{
+		fprintf(stderr, "bench: no configuration or trajectory matches\n");
+		return 1;
+	}
+
+	return 0;
+}
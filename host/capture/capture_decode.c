@@ -0,0 +1,248 @@
+// 2014 - 2015
+
+/*! \file capture_decode.c
+    \brief Host tool: reassembles a sample capture streamed by the antenna
+           (diagnostic PDO 0x680 + node ID, pages CAPTURE and CAPTURE_DATA)
+           from a candump log into a CSV or binary file.
+
+    Build:  cc -O2 -o capture_decode capture_decode.c
+    Usage:  capture_decode [-n node] [-b] [-o file] [candump.log]
+
+    Input lines in candump format, with or without -L:
+      (1424000000.000000) can0 681#0E00...
+      can0  681   [8]  0E 00 ...
+    Output, per captured pair: ADC sample counter, left, right (CSV), or
+    little-endian int16 left, right (-b). The last complete capture of the
+    log is written.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/* Must match can.h / capture.h */
+#define DIAG_SID				(0x680U)
+#define DIAG_PAGE_CAPTURE		(13U)
+#define DIAG_PAGE_CAPTURE_DATA	(14U)
+#define CAPTURE_STATE_STREAMING	(4U)
+#define PAIR_SIZE				(3U)
+#define SEGMENT_PAIRS			(2U)
+#define MAX_PAIRS				(255U)
+#define MAX_SEGMENTS			((MAX_PAIRS + SEGMENT_PAIRS - 1U) / SEGMENT_PAIRS)
+
+typedef struct
+{
+	unsigned	mode;
+	unsigned	trigger;
+	unsigned	pairs;
+	uint32_t	start;
+	uint8_t		data[MAX_SEGMENTS * SEGMENT_PAIRS * PAIR_SIZE];
+	uint8_t		received[MAX_SEGMENTS];
+	int			active;
+} T_capture_t;
+
+/* Parse a candump line, returns the number of data bytes or -1 */
+static int parse_line(const char *line, unsigned *sid, uint8_t *data)
+{
+	const char	*p;
+	unsigned	length;
+	unsigned	value;
+	int			n;
+	int			i;
+
+	/* candump -L: "(time) can0 681#0102..." */
+	p = strchr(line, '#');
+	if (p != NULL)
+	{
+		const char *q = p;
+
+		while ((q > line) && (q[-1] != ' '))
+			--q;
+		if (sscanf(q, "%x#", sid) != 1)
+			return -1;
+		for (i = 0, ++p; (i < 8) && (sscanf(p, "%2x", &value) == 1); ++i, p += 2)
+			data[i] = (uint8_t)value;
+		return i;
+	}
+
+	/* candump: "can0  681   [8]  01 02 ..." */
+	p = strchr(line, '[');
+	if (p == NULL)
+		return -1;
+	{
+		const char *q = p;
+
+		while ((q > line) && (q[-1] == ' '))
+			--q;
+		while ((q > line) && (q[-1] != ' '))
+			--q;
+		if (sscanf(q, "%x", sid) != 1)
+			return -1;
+	}
+	if ((sscanf(p, "[%u]%n", &length, &n) != 1) || (length > 8U))
+		return -1;
+	for (p += n, i = 0; i < (int)length; ++i, p += n)
+	{
+		if (sscanf(p, " %2x%n", &value, &n) != 1)
+			return -1;
+		data[i] = (uint8_t)value;
+	}
+
+	return i;
+}
+
+/* 12-bit two's complement to int */
+static int sign12(unsigned value)
+{
+	return (value & 0x800U) ? (int)value - 0x1000 : (int)value;
+}
+
+static int write_capture(const T_capture_t *capture, FILE *out, int binary)
+{
+	unsigned	segments = (capture->pairs + SEGMENT_PAIRS - 1U) / SEGMENT_PAIRS;
+	unsigned	missing = 0U;
+	unsigned	i;
+
+	for (i = 0U; i < segments; ++i)
+		missing += capture->received[i] ? 0U : 1U;
+	if (missing != 0U)
+		fprintf(stderr, "capture_decode: %u of %u segments missing, written as 0\n", missing, segments);
+
+	if (!binary)
+		fprintf(out, "# mode %u trigger %u pairs %u\nsample,left,right\n",
+				capture->mode, capture->trigger, capture->pairs);
+
+	for (i = 0U; i < capture->pairs; ++i)
+	{
+		const uint8_t	*pair = &capture->data[i * PAIR_SIZE];
+		int				left = sign12(((unsigned)pair[0] << 4) | (pair[1] >> 4));
+		int				right = sign12((((unsigned)pair[1] & 0x0FU) << 8) | pair[2]);
+
+		if (binary)
+		{
+			int16_t	values[2] = { (int16_t)left, (int16_t)right };
+			uint8_t	bytes[4] = { (uint8_t)values[0], (uint8_t)((uint16_t)values[0] >> 8),
+								 (uint8_t)values[1], (uint8_t)((uint16_t)values[1] >> 8) };
+
+			fwrite(bytes, 1, sizeof(bytes), out);
+		}
+		else
+			fprintf(out, "%lu,%d,%d\n", (unsigned long)(capture->start + i), left, right);
+	}
+
+	return (missing == 0U) ? 0 : 2;
+}
+
+int main(int argc, char *argv[])
+{
+	FILE		*in = stdin;
+	FILE		*out = stdout;
+	const char	*out_name = NULL;
+	unsigned	node = 1U;
+	int			binary = 0;
+	int			opt;
+	char		line[256];
+	unsigned	sid;
+	uint8_t		data[8];
+	T_capture_t	current;
+	T_capture_t	complete;
+	int			have_complete = 0;
+	int			rc;
+
+	memset(&current, 0, sizeof(current));
+	memset(&complete, 0, sizeof(complete));
+
+	while ((opt = getopt(argc, argv, "n:bo:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n':
+				node = (unsigned)strtoul(optarg, NULL, 0) & 0x0FU;
+				break;
+			case 'b':
+				binary = 1;
+				break;
+			case 'o':
+				out_name = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-n node] [-b] [-o file] [candump.log]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (optind < argc)
+	{
+		in = fopen(argv[optind], "r");
+		if (in == NULL)
+		{
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL)
+	{
+		if ((parse_line(line, &sid, data) != 8) || (sid != (DIAG_SID + node)))
+			continue;
+
+		/* The state page starts a streamed capture; requested state pages do not */
+		if ((data[0] == DIAG_PAGE_CAPTURE) && (data[1] == CAPTURE_STATE_STREAMING))
+		{
+			/* A new capture starts, keep the previous one when it was complete */
+			if (current.active && (current.pairs != 0U))
+			{
+				complete = current;
+				have_complete = 1;
+			}
+			memset(&current, 0, sizeof(current));
+			current.active	= 1;
+			current.mode	= data[2] & 0x0FU;
+			current.trigger	= data[2] >> 4;
+			current.pairs	= data[3];
+			current.start	= ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) |
+							  ((uint32_t)data[6] << 8) | data[7];
+		}
+		else if ((data[0] == DIAG_PAGE_CAPTURE_DATA) && current.active)
+		{
+			unsigned	offset = (unsigned)data[1] * SEGMENT_PAIRS * PAIR_SIZE;
+
+			if ((offset + SEGMENT_PAIRS * PAIR_SIZE) <= sizeof(current.data))
+			{
+				memcpy(&current.data[offset], &data[2], SEGMENT_PAIRS * PAIR_SIZE);
+				current.received[data[1]] = 1;
+			}
+		}
+	}
+
+	if (current.active && (current.pairs != 0U))
+	{
+		complete = current;
+		have_complete = 1;
+	}
+
+	if (!have_complete)
+	{
+		fprintf(stderr, "capture_decode: no capture of node %u found\n", node);
+		return 1;
+	}
+
+	if (out_name != NULL)
+	{
+		out = fopen(out_name, binary ? "wb" : "w");
+		if (out == NULL)
+		{
+			perror(out_name);
+			return 1;
+		}
+	}
+
+	rc = write_capture(&complete, out, binary);
+	if (out != stdout)
+		fclose(out);
+	if (in != stdin)
+		fclose(in);
+
+	return rc;
+}
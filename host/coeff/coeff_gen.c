@@ -0,0 +1,145 @@
+// 2014 - 2015
+
+/*! \file coeff_gen.c
+    \brief Host tool: computes the Goertzel coefficients 8192 x cos/sin(2.pi.Ft/Fs)
+           as ANT_Set_Freqs and ANT_Load_Freqs do on target, and checks the
+           default coefficients of antenna_calculation.c against them.
+
+    The dsPIC compiler uses 32-bit doubles, so the coefficients are computed in
+    single precision and truncated to int16 like on target. A double precision
+    computation differs by one for the Test Freq. (-4095 instead of -4096).
+
+    Usage:  coeff_gen [-c] [Ft]...
+      -c            check the default coefficients of the firmware, i.e. the
+                    active coefficient set after initialization, exit code 1
+                    when one differs
+      Ft            Frequency [Hz], default the Frequencies of configuration.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "replay.h"
+#include "antenna_calculation.h"
+#include "gen_math.h"
+
+/* Coefficient sets of antenna_calculation.c */
+extern T_ant_coeff_set_t	AntCoeffSet[2];
+extern Uint8				AntCoeffActive;
+
+/* Computes 8192 x cos(2.pi.harmonic.Ft/Fs) as on target */
+static int16 coeff_cos(Uint16 freq, Uint8 harmonic)
+{
+	float ratio = (float)freq / (float)ADC_SAMPLING_FREQ_Hz;
+
+	return (int16)(cosf((float)harmonic * (float)MATH_2PI * ratio) * 8192.0f);
+}
+
+/* Computes 8192 x sin(2.pi.harmonic.Ft/Fs) as on target */
+static int16 coeff_sin(Uint16 freq, Uint8 harmonic)
+{
+	float ratio = (float)freq / (float)ADC_SAMPLING_FREQ_Hz;
+
+	return (int16)(sinf((float)harmonic * (float)MATH_2PI * ratio) * 8192.0f);
+}
+
+static void print_coeff(Uint16 freq)
+{
+	int16 cos1 = coeff_cos(freq, 1U);
+	int16 sin1 = coeff_sin(freq, 1U);
+	int16 cos2 = coeff_cos(freq, 2U);
+	int16 sin2 = coeff_sin(freq, 2U);
+
+	printf("%5u Hz  cos DEC: %6d HEX: 0x%04X  sin DEC: %6d HEX: 0x%04X  "
+		   "2nd Harmonic cos DEC: %6d HEX: 0x%04X  sin DEC: %6d HEX: 0x%04X\n",
+		   (unsigned)freq, cos1, (Uint16)cos1, sin1, (Uint16)sin1,
+		   cos2, (Uint16)cos2, sin2, (Uint16)sin2);
+
+	return;
+}
+
+static Uint32 CheckFailures;
+
+static void check_coeff(const char *name, int16 actual, int16 expected)
+{
+	if (actual != expected)
+	{
+		printf("%s: default %d, computed %d\n", name, actual, expected);
+		++CheckFailures;
+	}
+
+	return;
+}
+
+/* Compares the active coefficient set after initialization, i.e. the default
+   coefficients, with the computed ones. */
+static int check_defaults(void)
+{
+	static const Uint16 freqs[NBR_INPUT_FREQ] = { FREQ1_HZ, FREQ2_HZ, FREQ3_HZ, FREQ4_HZ };
+	const T_ant_coeff_set_t *pSet;
+	char	name[32];
+	Uint8	freq_idx = 0U;
+	Uint8	i;
+
+	Replay_init(NULL, 0U);
+	pSet = &AntCoeffSet[AntCoeffActive];
+
+	#if BIT_WIREGUID_ACTIVE
+	check_coeff("test freq cos", pSet->cos_coeff[freq_idx++], coeff_cos(TEST_FREQUENCY_HZ, 1U));
+	#endif
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+	{
+		snprintf(name, sizeof(name), "freq %u cos", (unsigned)(i + 1U));
+		check_coeff(name, pSet->cos_coeff[freq_idx++], coeff_cos(freqs[i], 1U));
+	}
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	check_coeff("freq 1 sin", pSet->sin_coeff[0], coeff_sin(freqs[0], 1U));
+	check_coeff("2nd harmonic cos", pSet->cos_coeff[freq_idx], coeff_cos(freqs[0], 2U));
+	check_coeff("2nd harmonic sin", pSet->sin_coeff[1], coeff_sin(freqs[0], 2U));
+	#endif
+
+	printf("coeff_gen: default coefficients %s\n", (CheckFailures == 0UL) ? "match" : "differ");
+
+	return (CheckFailures == 0UL) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	int		check = 0;
+	int		opt;
+
+	while ((opt = getopt(argc, argv, "c")) != -1)
+	{
+		if (opt == 'c')
+			check = 1;
+		else
+		{
+			fprintf(stderr, "usage: %s [-c] [Ft]...\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (check)
+		return check_defaults();
+
+	printf("Fs = %u Hz\n", (unsigned)ADC_SAMPLING_FREQ_Hz);
+	if (optind < argc)
+	{
+		for (; optind < argc; ++optind)
+			print_coeff((Uint16)strtoul(argv[optind], NULL, 10));
+	}
+	else
+	{
+		#if BIT_WIREGUID_ACTIVE
+		print_coeff(TEST_FREQUENCY_HZ);
+		#endif
+		print_coeff(FREQ1_HZ);
+		print_coeff(FREQ2_HZ);
+		print_coeff(FREQ3_HZ);
+		print_coeff(FREQ4_HZ);
+	}
+
+	return 0;
+}
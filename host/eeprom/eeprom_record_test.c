@@ -0,0 +1,347 @@
+// 2014 - 2015
+
+/*! \file eeprom_record_test.c
+    \brief Host test of the EEPROM record store (hal/src/eeprom_record.c) on
+           a RAM EEPROM. A row write is interrupted at every word, or
+           completed with a corrupted word, followed by a reset: the previous
+           record must be used. Repeated failed writes must not erase the
+           newest record. The sequence numbers wrap from 0xFFFF to 0 within
+           the slots of a partition, at every slot.
+
+    Usage:  eeprom_record_test
+    Returns 0 when all checks pass.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "project_canantenna.h"
+
+/* EEPROM of the dsPIC30F4013: 1 kB from 0x7FFC00 */
+#define TEST_EEPROM_BASE	(0x7FFC00UL)
+#define TEST_EEPROM_ROWS	(32U)
+
+#define TEST_MAGIC			(0x5A00U)
+#define TEST_CALIB_SLOTS	(8U)
+
+typedef enum
+{
+	TEST_WRITE_COMPLETE = 0,	/* Row written, callback called */
+	TEST_WRITE_TORN,			/* Reset while writing: words from tear_word on still erased */
+	TEST_WRITE_CORRUPT,			/* Reset after writing, word tear_word has a flipped bit */
+	TEST_WRITE_LOST,			/* Reset before the row was erased */
+	TEST_WRITE_FAILED			/* Row erased, write failed, callback called */
+} E_test_write_t;
+
+// Local variables
+static Uint16			TestEeprom[TEST_EEPROM_ROWS][EEPROM_ROW_WORDS];
+static E_test_write_t	TestWriteMode;
+static Uint16			TestTearWord;
+static Uint32			TestLastAddress;
+static Uint32			TestChecks;
+static Uint32			TestFailures;
+
+//*****************************************************************************
+// EEPROM driver
+//*****************************************************************************
+static Uint16 *test_row(Uint32 row_address)
+{
+	return TestEeprom[(row_address - TEST_EEPROM_BASE) / EEPROM_ROW_SIZE];
+}
+
+void eeprom_read_row(Uint32 row_address, Uint16 *row_data)
+{
+	memcpy((void*)row_data, (void*)test_row(row_address), EEPROM_ROW_SIZE);
+
+	return;
+}
+
+/* A row is erased, then written. The callback is not called on a reset. */
+sbool eeprom_write_row_async(Uint32 row_address, const Uint16 *row_data,
+							 T_eeprom_callback_t callback, Uint16 tag)
+{
+	Uint16	*row = test_row(row_address);
+
+	TestLastAddress = row_address;
+	switch (TestWriteMode)
+	{
+		case TEST_WRITE_LOST:
+			return true;
+
+		case TEST_WRITE_TORN:
+			memset((void*)row, 0xFF, EEPROM_ROW_SIZE);
+			memcpy((void*)row, (void*)row_data, TestTearWord * sizeof(Uint16));
+			return true;
+
+		case TEST_WRITE_CORRUPT:
+			memcpy((void*)row, (void*)row_data, EEPROM_ROW_SIZE);
+			row[TestTearWord] ^= 0x0100U;
+			return true;
+
+		case TEST_WRITE_FAILED:
+			memset((void*)row, 0xFF, EEPROM_ROW_SIZE);
+			if (callback != NULL)
+				callback(tag, false);
+			return true;
+
+		case TEST_WRITE_COMPLETE:
+		default:
+			memcpy((void*)row, (void*)row_data, EEPROM_ROW_SIZE);
+			if (callback != NULL)
+				callback(tag, true);
+			return true;
+	}
+}
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+static void test_check(sbool condition, const char *what, Uint32 a, Uint32 b)
+{
+	++TestChecks;
+	if (condition)
+		return;
+
+	++TestFailures;
+	fprintf(stderr, "FAIL: %s (%lu, %lu)\n", what, (unsigned long)a, (unsigned long)b);
+
+	return;
+}
+
+/*************************************************************************/
+/* CRC-16-CCITT of the record format, independent of the implementation */
+static Uint16 test_crc(const Uint16 *data, Uint16 nbr_words)
+{
+	Uint16	crc = 0xFFFFU;
+	Uint16	i;
+	Uint8	bit;
+
+	for (i = 0U; i < nbr_words; ++i)
+	{
+		crc ^= data[i];
+		for (bit = 0U; bit < 16U; ++bit)
+			crc = (crc & 0x8000U) ? (Uint16)((crc << 1) ^ 0x1021U) : (Uint16)(crc << 1);
+	}
+
+	return crc;
+}
+
+/*************************************************************************/
+/* Payload whose words identify a record and a value */
+static void test_payload(Uint16 *payload, E_eeprom_record_t record, Uint16 value)
+{
+	Uint16	i;
+
+	for (i = 0U; i < EEPROM_RECORD_PAYLOAD_WORDS; ++i)
+		payload[i] = (Uint16)((record << 12) + value + i);
+
+	return;
+}
+
+/*************************************************************************/
+/* Writes a record row with a sequence number directly to a calibration slot */
+static void test_put_calib(Uint8 slot, Uint16 sequence, Uint16 value)
+{
+	Uint16	*row = TestEeprom[slot];
+
+	row[0] = TEST_MAGIC | (Uint16)EEPROM_RECORD_CALIB;
+	row[1] = sequence;
+	test_payload(&row[2], EEPROM_RECORD_CALIB, value);
+	row[EEPROM_ROW_WORDS - 1] = test_crc(row, EEPROM_ROW_WORDS - 1);
+
+	return;
+}
+
+/*************************************************************************/
+/* True if the loaded record has the payload of value */
+static sbool test_loaded(E_eeprom_record_t record, Uint16 value)
+{
+	Uint16	expected[EEPROM_RECORD_PAYLOAD_WORDS];
+	Uint16	loaded[EEPROM_RECORD_PAYLOAD_WORDS];
+
+	test_payload(expected, record, value);
+	if (!eeprom_record_load(record, loaded, EEPROM_RECORD_PAYLOAD_WORDS))
+		return false;
+
+	return (memcmp((void*)expected, (void*)loaded, sizeof(loaded)) == 0);
+}
+
+/*************************************************************************/
+/* Stores value in a record with the write mode, then resets */
+static void test_store(E_eeprom_record_t record, Uint16 value, E_test_write_t mode, Uint16 word)
+{
+	Uint16	payload[EEPROM_RECORD_PAYLOAD_WORDS];
+
+	test_payload(payload, record, value);
+	TestWriteMode = mode;
+	TestTearWord = word;
+	test_check(eeprom_record_store(record, payload, EEPROM_RECORD_PAYLOAD_WORDS, NULL, 0U),
+			   "store accepted", record, value);
+	TestWriteMode = TEST_WRITE_COMPLETE;
+	eeprom_record_init();
+
+	return;
+}
+
+/*************************************************************************/
+/* Every record: after value writes, an interrupted or corrupted write of
+   the next value at every word keeps the last value */
+static void test_torn_writes(void)
+{
+	Uint8	record;
+	Uint16	value;
+	Uint16	word;
+
+	memset((void*)TestEeprom, 0xFF, sizeof(TestEeprom));
+	eeprom_record_init();
+
+	for (record = 0U; record < EEPROM_RECORD_LAST; ++record)
+	{
+		value = 1U;
+		test_store((E_eeprom_record_t)record, value, TEST_WRITE_COMPLETE, 0U);
+		test_check(test_loaded((E_eeprom_record_t)record, value), "first record", record, value);
+
+		/* Spans the partition several times, so the slot written holds an older record */
+		for (word = 0U; word < EEPROM_ROW_WORDS; ++word)
+		{
+			test_store((E_eeprom_record_t)record, value + 1U, TEST_WRITE_TORN, word);
+			test_check(test_loaded((E_eeprom_record_t)record, value), "torn write keeps the previous record",
+					   record, word);
+
+			test_store((E_eeprom_record_t)record, value + 1U, TEST_WRITE_CORRUPT, word);
+			test_check(test_loaded((E_eeprom_record_t)record, value), "corrupt write keeps the previous record",
+					   record, word);
+
+			test_store((E_eeprom_record_t)record, value + 1U, TEST_WRITE_LOST, word);
+			test_check(test_loaded((E_eeprom_record_t)record, value), "lost write keeps the previous record",
+					   record, word);
+
+			++value;
+			test_store((E_eeprom_record_t)record, value, TEST_WRITE_COMPLETE, 0U);
+			test_check(test_loaded((E_eeprom_record_t)record, value), "complete write", record, word);
+		}
+	}
+
+	/* The records do not overwrite each other */
+	for (record = 0U; record < EEPROM_RECORD_LAST; ++record)
+		test_check(test_loaded((E_eeprom_record_t)record, EEPROM_ROW_WORDS + 1U), "record kept", record, 0U);
+
+	return;
+}
+
+/*************************************************************************/
+/* Every record: failed writes, more than the slots of a partition, are not
+   written to the slot of the newest record, which is kept after a reset */
+static void test_failed_writes(void)
+{
+	Uint16	payload[EEPROM_RECORD_PAYLOAD_WORDS];
+	Uint32	newest;
+	Uint8	record;
+	Uint8	n;
+
+	memset((void*)TestEeprom, 0xFF, sizeof(TestEeprom));
+	eeprom_record_init();
+
+	for (record = 0U; record < EEPROM_RECORD_LAST; ++record)
+	{
+		test_store((E_eeprom_record_t)record, 1U, TEST_WRITE_COMPLETE, 0U);
+		test_store((E_eeprom_record_t)record, 2U, TEST_WRITE_COMPLETE, 0U);
+		newest = TestLastAddress;
+
+		/* No reset between the failed writes */
+		test_payload(payload, (E_eeprom_record_t)record, 3U);
+		TestWriteMode = TEST_WRITE_FAILED;
+		for (n = 0U; n < (2U * TEST_CALIB_SLOTS); ++n)
+		{
+			test_check(eeprom_record_store((E_eeprom_record_t)record, payload, EEPROM_RECORD_PAYLOAD_WORDS, NULL, 0U),
+					   "store accepted", record, n);
+			test_check(TestLastAddress != newest, "failed write spares the newest record", record, n);
+			test_check(test_loaded((E_eeprom_record_t)record, 2U), "failed write keeps the record", record, n);
+		}
+		TestWriteMode = TEST_WRITE_COMPLETE;
+
+		eeprom_record_init();
+		test_check(test_loaded((E_eeprom_record_t)record, 2U), "record kept after failed writes", record, 0U);
+		test_store((E_eeprom_record_t)record, 3U, TEST_WRITE_COMPLETE, 0U);
+		test_check(test_loaded((E_eeprom_record_t)record, 3U), "write after failed writes", record, 0U);
+	}
+
+	return;
+}
+
+/*************************************************************************/
+/* A payload longer than a record is rejected, the record is kept */
+static void test_oversize(void)
+{
+	Uint16	payload[EEPROM_RECORD_PAYLOAD_WORDS + 1];
+
+	memset((void*)TestEeprom, 0xFF, sizeof(TestEeprom));
+	eeprom_record_init();
+	test_store(EEPROM_RECORD_CALIB, 1U, TEST_WRITE_COMPLETE, 0U);
+
+	memset((void*)payload, 0, sizeof(payload));
+	test_check(!eeprom_record_store(EEPROM_RECORD_CALIB, payload, EEPROM_RECORD_PAYLOAD_WORDS + 1, NULL, 0U),
+			   "oversize store rejected", 0U, 0U);
+	test_check(!eeprom_record_load(EEPROM_RECORD_CALIB, payload, EEPROM_RECORD_PAYLOAD_WORDS + 1),
+			   "oversize load rejected", 0U, 0U);
+	test_check(test_loaded(EEPROM_RECORD_CALIB, 1U), "record kept after oversize store", 0U, 0U);
+
+	return;
+}
+
+/*************************************************************************/
+/* All 8 calibration slots hold records with consecutive sequence numbers
+   across 0xFFFF -> 0, the oldest at slot first. The newest is used, the
+   next write replaces the oldest and a torn write of it keeps the newest. */
+static void test_sequence_wrap(void)
+{
+	Uint16	newest;
+	Uint8	first;
+	Uint8	i;
+	Uint16	word;
+
+	for (first = 0U; first < TEST_CALIB_SLOTS; ++first)
+	{
+		/* The wrap between every pair of slots */
+		for (i = 0U; i < TEST_CALIB_SLOTS; ++i)
+		{
+			Uint16	base = (Uint16)(0x10000UL - (Uint32)i - 1UL);
+			Uint8	n;
+
+			memset((void*)TestEeprom, 0xFF, sizeof(TestEeprom));
+			for (n = 0U; n < TEST_CALIB_SLOTS; ++n)
+				test_put_calib((Uint8)((first + n) % TEST_CALIB_SLOTS), (Uint16)(base + n), n);
+			newest = TEST_CALIB_SLOTS - 1U;
+
+			eeprom_record_init();
+			test_check(test_loaded(EEPROM_RECORD_CALIB, newest), "newest record across the wrap", first, base);
+
+			for (word = 0U; word < EEPROM_ROW_WORDS; ++word)
+			{
+				test_store(EEPROM_RECORD_CALIB, 100U, TEST_WRITE_TORN, word);
+				test_check(TestLastAddress == (TEST_EEPROM_BASE + (Uint32)first * EEPROM_ROW_SIZE),
+						   "write replaces the oldest record", first, TestLastAddress);
+				test_check(test_loaded(EEPROM_RECORD_CALIB, newest), "torn write across the wrap", first, word);
+			}
+
+			test_store(EEPROM_RECORD_CALIB, 100U, TEST_WRITE_COMPLETE, 0U);
+			test_check(test_loaded(EEPROM_RECORD_CALIB, 100U), "write across the wrap", first, base);
+			test_check(TestEeprom[first][1] == (Uint16)(base + TEST_CALIB_SLOTS), "sequence number", first,
+					   TestEeprom[first][1]);
+		}
+	}
+
+	return;
+}
+
+int main(void)
+{
+	test_torn_writes();
+	test_failed_writes();
+	test_oversize();
+	test_sequence_wrap();
+
+	printf("eeprom_record_test: %lu checks, %lu failed\n", (unsigned long)TestChecks,
+		   (unsigned long)TestFailures);
+
+	return (TestFailures == 0UL) ? 0 : 1;
+}
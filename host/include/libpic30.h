@@ -0,0 +1,14 @@
+// 2014 - 2015
+
+/*! \file libpic30.h
+    \brief Host build: stands in for the compiler helper library header
+*/
+
+#ifndef __HOST_LIBPIC30_H
+#define __HOST_LIBPIC30_H
+
+typedef unsigned long	_prog_addressT;
+
+#define __delay32(cycles)	((void)0)
+
+#endif // End of __HOST_LIBPIC30_H definition
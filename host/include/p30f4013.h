@@ -0,0 +1,145 @@
+// 2014 - 2015
+
+/*! \file p30f4013.h
+    \brief Host build: stands in for the processor header of the guidance code.
+           Only the registers used by the guidance code and the CAN module
+           (hal/src/can.c) are declared, they are defined by host_hal.c. Bit
+           structures are separate variables, not aliases of the register word,
+           except for the transmit and receive buffers.
+*/
+
+#ifndef __HOST_P30F4013_H
+#define __HOST_P30F4013_H
+
+typedef struct
+{
+	unsigned int	LATB9;
+	unsigned int	LATB10;
+} LATBBITS;
+
+typedef struct
+{
+	unsigned int	ADIE;
+} IEC0BITS;
+
+typedef struct
+{
+	unsigned int	C1IE;
+} IEC1BITS;
+
+typedef struct
+{
+	unsigned int	C1IF;
+} IFS1BITS;
+
+typedef struct
+{
+	unsigned int	ICM;
+	unsigned int	ICTMR;
+	unsigned int	ICSIDL;
+	unsigned int	ICBNE;
+} IC2CONBITS;
+
+extern volatile LATBBITS	LATBbits;
+extern volatile IEC0BITS	IEC0bits;
+extern volatile IEC1BITS	IEC1bits;
+extern volatile IFS1BITS	IFS1bits;
+extern volatile IC2CONBITS	IC2CONbits;
+extern volatile unsigned int	TMR2;
+extern volatile unsigned int	TMR3;
+extern volatile unsigned int	PR3;
+extern volatile unsigned int	IC2BUF;
+extern volatile unsigned int	PORTB;
+extern volatile unsigned int	PORTF;
+
+/* CAN module */
+typedef struct
+{
+	unsigned int	REQOP;
+	unsigned int	OPMODE;
+	unsigned int	CANCKS;
+	unsigned int	CSIDL;
+	unsigned int	CANCAP;
+	unsigned int	ABAT;
+} C1CTRLBITS;
+
+typedef struct
+{
+	unsigned int	BRP;
+	unsigned int	SJW;
+} C1CFG1BITS;
+
+typedef struct
+{
+	unsigned int	PRSEG;
+	unsigned int	SEG1PH;
+	unsigned int	SAM;
+	unsigned int	SEG2PHTS;
+	unsigned int	SEG2PH;
+} C1CFG2BITS;
+
+typedef struct
+{
+	unsigned int	RX0IF;
+	unsigned int	RX1IF;
+	unsigned int	TX0IF;
+	unsigned int	TX1IF;
+	unsigned int	TX2IF;
+	unsigned int	ERRIF;
+	unsigned int	WAKIF;
+	unsigned int	IVRIF;
+	unsigned int	RX0OVR;
+	unsigned int	RX1OVR;
+	unsigned int	TXBO;
+	unsigned int	TXEP;
+	unsigned int	RXEP;
+} C1INTFBITS;
+
+typedef struct
+{
+	unsigned int	SID;
+	unsigned int	TXIDE;
+	unsigned int	TXPRI;
+	unsigned int	RXFUL;
+	unsigned int	DBEN;
+} C1BUFBITS;
+
+extern volatile C1CTRLBITS	C1CTRLbits;
+extern volatile C1CFG1BITS	C1CFG1bits;
+extern volatile C1CFG2BITS	C1CFG2bits;
+extern volatile C1INTFBITS	C1INTFbits;
+extern volatile unsigned int	C1INTF;
+extern volatile unsigned int	C1INTE;
+extern volatile unsigned int	C1EC;
+
+/* Transmit buffers 0-2 and receive buffers 0-1, laid out as on the processor:
+	SID, EID, DLC, 4 data words, CON */
+extern volatile unsigned short	HostC1TxBuffer[3][8];
+extern volatile unsigned short	HostC1RxBuffer[2][8];
+#define C1TX0SID	(HostC1TxBuffer[0][0])
+#define C1TX1SID	(HostC1TxBuffer[1][0])
+#define C1TX2SID	(HostC1TxBuffer[2][0])
+#define C1RX0SID	(HostC1RxBuffer[0][0])
+#define C1RX1SID	(HostC1RxBuffer[1][0])
+#define C1RX0B1		(HostC1RxBuffer[0][3])
+#define C1RX0B2		(HostC1RxBuffer[0][4])
+#define C1RX0B3		(HostC1RxBuffer[0][5])
+#define C1RX0B4		(HostC1RxBuffer[0][6])
+
+/* Control and identifier bits of the buffers, filters and masks */
+extern volatile C1BUFBITS	C1TX0SIDbits, C1TX1SIDbits, C1TX2SIDbits;
+extern volatile C1BUFBITS	C1TX0CONbits, C1TX1CONbits, C1TX2CONbits;
+extern volatile C1BUFBITS	C1RX0CONbits, C1RX1CONbits;
+extern volatile C1BUFBITS	C1RXF0SIDbits, C1RXF1SIDbits, C1RXF2SIDbits;
+extern volatile C1BUFBITS	C1RXF3SIDbits, C1RXF4SIDbits, C1RXF5SIDbits;
+extern volatile C1BUFBITS	C1RXM0SIDbits, C1RXM1SIDbits;
+extern volatile unsigned int	C1RXF0SID, C1RXF1SID, C1RXF2SID, C1RXF3SID, C1RXF4SID, C1RXF5SID;
+extern volatile unsigned int	C1RXM0SID, C1RXM1SID;
+
+/* Interrupt service routines are plain functions on the host */
+#define interrupt	unused
+
+#define Nop()		((void)0)
+#define ClrWdt()	((void)0)
+
+#endif // End of __HOST_P30F4013_H definition
@@ -0,0 +1,194 @@
+// 2014 - 2015
+
+/*! \file host_hal.c
+    \brief Host build: the hardware layer seen by the guidance code and the CAN
+           module. Registers are plain variables, the EEPROM records are kept
+           in RAM and written at once, scheduler, interrupt latency and
+           performance counters do nothing and report zeros.
+*/
+
+#include "project_canantenna.h"
+#include "host_hal.h"
+
+// Registers
+volatile LATBBITS		LATBbits;
+volatile IEC0BITS		IEC0bits;
+volatile IEC1BITS		IEC1bits;
+volatile IFS1BITS		IFS1bits;
+volatile IC2CONBITS		IC2CONbits;
+volatile unsigned int	TMR2;
+volatile unsigned int	TMR3;
+volatile unsigned int	PR3;
+volatile unsigned int	IC2BUF;
+volatile unsigned int	PORTB;
+volatile unsigned int	PORTF;
+
+// CAN registers
+volatile C1CTRLBITS		C1CTRLbits;
+volatile C1CFG1BITS		C1CFG1bits;
+volatile C1CFG2BITS		C1CFG2bits;
+volatile C1INTFBITS		C1INTFbits;
+volatile unsigned int	C1INTF;
+volatile unsigned int	C1INTE;
+volatile unsigned int	C1EC;
+volatile unsigned short	HostC1TxBuffer[3][8];
+volatile unsigned short	HostC1RxBuffer[2][8];
+volatile C1BUFBITS		C1TX0SIDbits, C1TX1SIDbits, C1TX2SIDbits;
+volatile C1BUFBITS		C1TX0CONbits, C1TX1CONbits, C1TX2CONbits;
+volatile C1BUFBITS		C1RX0CONbits, C1RX1CONbits;
+volatile C1BUFBITS		C1RXF0SIDbits, C1RXF1SIDbits, C1RXF2SIDbits;
+volatile C1BUFBITS		C1RXF3SIDbits, C1RXF4SIDbits, C1RXF5SIDbits;
+volatile C1BUFBITS		C1RXM0SIDbits, C1RXM1SIDbits;
+volatile unsigned int	C1RXF0SID, C1RXF1SID, C1RXF2SID, C1RXF3SID, C1RXF4SID, C1RXF5SID;
+volatile unsigned int	C1RXM0SID, C1RXM1SID;
+
+// Global variables of the firmware
+T_guidData_t		gGuidanceData;
+T_systemData_t		gSystemData;
+
+int16				ADC_refVoltLeft_1;
+int16				ADC_refVoltRight_1;
+volatile Uint32		ADC_sampleCounter;
+
+// Local variables
+static Uint16	HostRecord[EEPROM_RECORD_LAST][EEPROM_RECORD_PAYLOAD_WORDS];
+static sbool	HostRecordValid[EEPROM_RECORD_LAST];
+static Uint16	HostRecordWrites[EEPROM_RECORD_LAST];
+static T_sched_state_t	HostSchedState;
+static T_sched_load_t	HostSchedLoad;
+static T_int_latency_t	HostLatency;
+static T_perf_probe_t	HostPerfProbe;
+
+//*****************************************************************************
+// EEPROM
+//*****************************************************************************
+sbool eeprom_record_load(E_eeprom_record_t record, Uint16 *payload, Uint16 words)
+{
+	if ((record >= EEPROM_RECORD_LAST) || !HostRecordValid[record] ||
+		(words > EEPROM_RECORD_PAYLOAD_WORDS))
+		return false;
+
+	memcpy((void*)payload, (void*)HostRecord[record], words * sizeof(Uint16));
+
+	return true;
+}
+
+sbool eeprom_record_store(E_eeprom_record_t record, const Uint16 *payload, Uint16 words,
+						  T_eeprom_callback_t callback, Uint16 tag)
+{
+	if ((record >= EEPROM_RECORD_LAST) || (words > EEPROM_RECORD_PAYLOAD_WORDS))
+		return false;
+
+	memset((void*)HostRecord[record], 0xFF, sizeof(HostRecord[record]));
+	memcpy((void*)HostRecord[record], (const void*)payload, words * sizeof(Uint16));
+	HostRecordValid[record] = true;
+	++HostRecordWrites[record];
+
+	if (callback != NULL)
+		callback(tag, true);
+
+	return true;
+}
+
+/* Records are written at once */
+sbool eeprom_record_busy(E_eeprom_record_t record)
+{
+	return false;
+}
+
+/* Nothing to test */
+void eeprom_self_test(T_eeprom_data_t *eeprom_data)
+{
+	return;
+}
+
+/* No data of earlier versions */
+Uint16 eeprom_read_legacy(E_eeprom_ID_t eeprom_ID)
+{
+	return 0xFFFFU;
+}
+
+/*! Host_record_preset() writes a record before the guidance is initialized */
+void Host_record_preset(E_eeprom_record_t record, const Uint16 *payload, Uint16 words)
+{
+	eeprom_record_store(record, payload, words, NULL, 0U);
+	HostRecordWrites[record] = 0U;
+
+	return;
+}
+
+/*! Host_record_erase() erases a record, as a blank EEPROM */
+void Host_record_erase(E_eeprom_record_t record)
+{
+	HostRecordValid[record] = false;
+	HostRecordWrites[record] = 0U;
+
+	return;
+}
+
+/*! Host_record() returns the payload of a record, NULL when not written.
+	writes returns the number of writes since the preset. */
+const Uint16 *Host_record(E_eeprom_record_t record, Uint16 *writes)
+{
+	if (writes != NULL)
+		*writes = HostRecordWrites[record];
+
+	return HostRecordValid[record] ? HostRecord[record] : NULL;
+}
+
+//*****************************************************************************
+// Scheduler, performance counters
+//*****************************************************************************
+void Sched_signal(Uint8 task)
+{
+	return;
+}
+
+const T_sched_state_t *Sched_state(Uint8 task)
+{
+	return &HostSchedState;
+}
+
+const T_sched_load_t *Sched_load(void)
+{
+	return &HostSchedLoad;
+}
+
+void Perf_record(Uint8 probe, Uint16 start)
+{
+	return;
+}
+
+const T_perf_probe_t *Perf_probe(Uint8 probe)
+{
+	return &HostPerfProbe;
+}
+
+Uint16 Perf_mean(Uint8 probe)
+{
+	return 0U;
+}
+
+//*****************************************************************************
+// Interrupts, ADC, object dictionary
+//*****************************************************************************
+void Interrupt_latency(Uint8 source, Uint16 latency)
+{
+	return;
+}
+
+const T_int_latency_t *Interrupt_latency_state(Uint8 source)
+{
+	return &HostLatency;
+}
+
+Uint32 Adc_sample_counter(void)
+{
+	return ADC_sampleCounter;
+}
+
+/* No object dictionary on the host, the response is not filled */
+void Objdict_sdo_request(const Uint8 *request, Uint8 *response)
+{
+	return;
+}
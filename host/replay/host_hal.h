@@ -0,0 +1,19 @@
+// 2014 - 2015
+
+/*! \file host_hal.h
+    \brief Host build: access to the hardware layer stand-ins of host_hal.c
+*/
+
+#ifndef __HOST_HAL_H
+#define __HOST_HAL_H
+
+#include "stypes.h"
+#include "eeprom_record.h"
+
+/* Function declarations */
+void _C1Interrupt(void);
+void Host_record_preset(E_eeprom_record_t record, const Uint16 *payload, Uint16 words);
+void Host_record_erase(E_eeprom_record_t record);
+const Uint16 *Host_record(E_eeprom_record_t record, Uint16 *writes);
+
+#endif // End of __HOST_HAL_H definition
@@ -0,0 +1,277 @@
+// 2014 - 2015
+
+/*! \file replay.c
+    \brief Host build: cadence of the guidance code, see replay.h
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include "project_canantenna.h"
+#include "host_hal.h"
+#include "replay.h"
+
+/* Timer1 period [TCY], the 100Hz and 10Hz tasks in Timer1 periods */
+#define REPLAY_TICK_TCY		(20000UL)
+#define REPLAY_GUIDANCE_MS	(10U)
+#define REPLAY_STORE_MS		(100U)
+
+typedef struct
+{
+	const char	*name;
+	size_t		offset;
+	sbool		is_signed;
+} T_replay_param_t;
+
+// Local variables
+static const T_replay_param_t ReplayParam[] = {
+	{ "deviation_scale",		offsetof(T_wg_param_t, deviation_scale),		false },
+	{ "deviation_range",		offsetof(T_wg_param_t, deviation_range),		false },
+	{ "amplitude_min",			offsetof(T_wg_param_t, amplitude_min),			false },
+	{ "qam_comp_noise",			offsetof(T_wg_param_t, qam_comp_noise),			true },
+	{ "qam_noise",				offsetof(T_wg_param_t, qam_noise),				false },
+	{ "calib_delay",			offsetof(T_wg_param_t, calib_delay),			false },
+	{ "calib_min_time",			offsetof(T_wg_param_t, calib_min_time),			false },
+	{ "calib_max_time",			offsetof(T_wg_param_t, calib_max_time),			false },
+	{ "calib_min_param",		offsetof(T_wg_param_t, calib_min_param),		false },
+	{ "bit_max_refvolt_short_circuit", offsetof(T_wg_param_t, bit_max_refvolt_short_circuit), true },
+	{ "bit_min_refvolt",		offsetof(T_wg_param_t, bit_min_refvolt),		true },
+	{ "bit_max_refvolt",		offsetof(T_wg_param_t, bit_max_refvolt),		true }
+};
+
+static Uint32	ReplayTickTcy;		/* Sample time since the last Timer1 period */
+static Uint16	ReplayMsec;			/* Timer1 periods since the start */
+static Uint16	ReplayLatency;		/* Samples until a completed window is processed */
+static Uint16	ReplayPending;		/* Samples left until the batch is processed, 0: none */
+static Uint32	ReplayBatches;
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+/* One Timer1 period: the 100Hz and 10Hz tasks */
+static void replay_tick(void)
+{
+	++ReplayMsec;
+	if (gSystemData.clockT1SysData.ticks_boot_msec < 0xFFFFU)
+		++gSystemData.clockT1SysData.ticks_boot_msec;
+	++gSystemData.clockT1SysData.ticks_free_msec;
+
+	if ((ReplayMsec % REPLAY_GUIDANCE_MS) == 0U)
+	{
+		Guid_process(&gGuidanceData);
+		Guid_bit(&gGuidanceData);
+	}
+	if ((ReplayMsec % REPLAY_STORE_MS) == 0U)
+		Guid_store(&gGuidanceData);
+
+	return;
+}
+
+/*************************************************************************/
+/* The batch task */
+static sbool replay_batch(void)
+{
+	ReplayPending = 0U;
+	if (!Guid_batch(&gGuidanceData))
+		return false;
+	++ReplayBatches;
+
+	return true;
+}
+
+//*****************************************************************************
+// Local functions
+//*****************************************************************************
+/*! Replay_init() initializes the guidance as after a reset. calib_params are
+	the stored calibration parameters (left Freq. 1-4, right Freq. 1-4), NULL
+	when not calibrated. batch_latency is the number of samples the batch task
+	runs after the end of a window, 0 for at once. */
+void Replay_init(const Uint16 *calib_params, Uint16 batch_latency)
+{
+	memset((void*)&gSystemData, 0, sizeof(gSystemData));
+	ADC_sampleCounter	= 0UL;
+	ReplayTickTcy		= 0UL;
+	ReplayMsec			= 0U;
+	ReplayLatency		= batch_latency;
+	ReplayPending		= 0U;
+	ReplayBatches		= 0UL;
+	Replay_refvolt(REPLAY_REFVOLT_DEFAULT, REPLAY_REFVOLT_DEFAULT);
+
+	if (calib_params != NULL)
+		Host_record_preset(EEPROM_RECORD_CALIB, calib_params, 2*NBR_INPUT_FREQ);
+	else
+		Host_record_erase(EEPROM_RECORD_CALIB);
+
+	Guid_init(&gGuidanceData);
+
+	return;
+}
+
+/*! Replay_param() sets a runtime parameter, "name=value". Returns false when
+	the name is unknown or the value out of range. */
+sbool Replay_param(const char *assignment)
+{
+	const char	*value = strchr(assignment, '=');
+	char		*end;
+	long		number;
+	size_t		length;
+	Uint8		i;
+
+	if (value == NULL)
+		return false;
+	length = (size_t)(value - assignment);
+	number = strtol(value + 1, &end, 0);
+	if ((*end != '\0') || (end == (value + 1)))
+		return false;
+
+	for (i = 0U; i < (sizeof(ReplayParam) / sizeof(ReplayParam[0])); ++i)
+	{
+		void	*pField = (Uint8*)&gWireGuidParam + ReplayParam[i].offset;
+
+		if ((strlen(ReplayParam[i].name) != length) || (strncmp(ReplayParam[i].name, assignment, length) != 0))
+			continue;
+
+		if (ReplayParam[i].is_signed)
+		{
+			if ((number < -32768L) || (number > 32767L))
+				return false;
+			*(int16*)pField = (int16)number;
+		}
+		else
+		{
+			if ((number < 0L) || (number > 65535L))
+				return false;
+			*(Uint16*)pField = (Uint16)number;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*! Replay_param_list() writes the runtime parameters, one per line */
+void Replay_param_list(FILE *out)
+{
+	Uint8	i;
+
+	for (i = 0U; i < (sizeof(ReplayParam) / sizeof(ReplayParam[0])); ++i)
+	{
+		const void	*pField = (const Uint8*)&gWireGuidParam + ReplayParam[i].offset;
+
+		if (ReplayParam[i].is_signed)
+			fprintf(out, "%s=%d\n", ReplayParam[i].name, *(const int16*)pField);
+		else
+			fprintf(out, "%s=%u\n", ReplayParam[i].name, *(const Uint16*)pField);
+	}
+
+	return;
+}
+
+/*! Replay_refvolt() sets the reference voltages, A/D values */
+void Replay_refvolt(int16 left, int16 right)
+{
+	ADC_refVoltLeft_1	= left;
+	ADC_refVoltRight_1	= right;
+
+	return;
+}
+
+/*! Replay_calibrate() starts a calibration, as the CAN command does */
+void Replay_calibrate(void)
+{
+	gGuidanceData.wireGuidData.calibration_status = WG_CALIB_STATUS_START;
+
+	return;
+}
+
+/*! Replay_sample() processes one A/D sample (0x800 offset removed), as the
+	A/D interrupt does. Returns true when a batch has been processed. */
+sbool Replay_sample(int16 left, int16 right)
+{
+	sbool	batch = false;
+
+	/* A window completed by an earlier sample, processed before this one */
+	if ((ReplayPending != 0U) && (--ReplayPending == 0U))
+		batch = replay_batch();
+
+	++ADC_sampleCounter;
+	if ((ANT_k < ANT_k_max) && !ANT_WaitSync)
+		ANT_Step(left, right);
+
+	if (ANT_BatchReady && (ReplayPending == 0U))
+	{
+		if (ReplayLatency == 0U)
+			batch = replay_batch() || batch;
+		else
+			ReplayPending = ReplayLatency;
+	}
+
+	ReplayTickTcy += ADC_PERIOD_TCY;
+	while (ReplayTickTcy >= REPLAY_TICK_TCY)
+	{
+		ReplayTickTcy -= REPLAY_TICK_TCY;
+		replay_tick();
+	}
+
+	return batch;
+}
+
+/*! Replay_batches() returns the number of processed batches */
+Uint32 Replay_batches(void)
+{
+	return ReplayBatches;
+}
+
+/*! Replay_result() returns the wire guidance data of the last batch */
+const T_wireGuid_t *Replay_result(void)
+{
+	return &(gGuidanceData.wireGuidData);
+}
+
+/*! Replay_csv_header() writes the column names of Replay_csv_row() */
+void Replay_csv_header(FILE *out)
+{
+	Uint8	i;
+
+	fprintf(out, "batch,window_end,calibration,status,left_ok,right_ok,valid");
+	for (i = 1U; i <= NBR_INPUT_FREQ; ++i)
+		fprintf(out, ",dev%u,fine%u,ampl_left%u,ampl_right%u", i, i, i, i);
+	#if BIT_WIREGUID_ACTIVE
+	fprintf(out, ",pilot_left,pilot_right");
+	#endif
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	fprintf(out, ",phase_left_cos,phase_left_sin,phase_right_cos,phase_right_sin,nibble_status,switches");
+	#endif
+	fprintf(out, "\n");
+
+	return;
+}
+
+/*! Replay_csv_row() writes the results of the last batch. The antenna status
+	is cable ok, no short circuit, pilot tone ok as bits 2-0. */
+void Replay_csv_row(FILE *out)
+{
+	const T_wireGuid_t	*pData = &(gGuidanceData.wireGuidData);
+	Uint8				i;
+
+	fprintf(out, "%lu,%lu,%d,%d,%d%d%d,%d%d%d,0x%02X",
+			(unsigned long)ReplayBatches, (unsigned long)pData->window_end,
+			(int)pData->calibration_status, (int)pData->status,
+			pData->status_left_antenna.antenna_cable_ok, pData->status_left_antenna.no_short_circuit,
+			pData->status_left_antenna.pilot_tone_ok,
+			pData->status_right_antenna.antenna_cable_ok, pData->status_right_antenna.no_short_circuit,
+			pData->status_right_antenna.pilot_tone_ok, pData->valid_mask);
+	for (i = 0U; i < NBR_INPUT_FREQ; ++i)
+		fprintf(out, ",%d,%d,%lu,%lu", pData->deviation_m2ecm[i], pData->deviation_fine[i],
+				(unsigned long)pData->amplitudeLeft[i], (unsigned long)pData->amplitudeRight[i]);
+	#if BIT_WIREGUID_ACTIVE
+	fprintf(out, ",%lu,%lu", (unsigned long)pData->amplitudePWM[0], (unsigned long)pData->amplitudePWM[1]);
+	#endif
+	#if SECOND_HARMONIC_FIRST_FREQUENCY
+	fprintf(out, ",%d,%d,%d,%d,%d,0x%02X", pData->rel_phaseLeft[0], pData->rel_phaseLeft[1],
+			pData->rel_phaseRight[0], pData->rel_phaseRight[1],
+			(int)pData->nibble_status, pData->switch_states_to_be_sent);
+	#endif
+	fprintf(out, "\n");
+
+	return;
+}
@@ -0,0 +1,38 @@
+// 2014 - 2015
+
+/*! \file replay.h
+    \brief Host build: drives the guidance code with recorded or generated A/D
+           samples at the cadence of the firmware. A sample is stepped as by
+           the A/D interrupt, a completed window is post-processed as by the
+           batch task, WireGuid_process() and WireGuid_bit() run every 10 msec
+           and WireGuid_store() every 100 msec of sample time.
+*/
+
+#ifndef __HOST_REPLAY_H
+#define __HOST_REPLAY_H
+
+#include <stdio.h>
+#include "stypes.h"
+#include "configuration.h"
+#include "wireguidance.h"
+
+/* Defines */
+/* A/D sample rate [Hz] */
+#define REPLAY_SAMPLE_RATE		(20000000.0 / 1320.0)
+
+/* Reference voltage while none is given, within the BIT window */
+#define REPLAY_REFVOLT_DEFAULT	(408)
+
+/* Function declarations */
+void Replay_init(const Uint16 *calib_params, Uint16 batch_latency);
+sbool Replay_param(const char *assignment);
+void Replay_param_list(FILE *out);
+void Replay_refvolt(int16 left, int16 right);
+void Replay_calibrate(void);
+sbool Replay_sample(int16 left, int16 right);
+Uint32 Replay_batches(void);
+const T_wireGuid_t *Replay_result(void);
+void Replay_csv_header(FILE *out);
+void Replay_csv_row(FILE *out);
+
+#endif // End of __HOST_REPLAY_H definition
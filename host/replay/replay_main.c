@@ -0,0 +1,365 @@
+// 2014 - 2015
+
+/*! \file replay_main.c
+    \brief Host tool: replays recorded left/right A/D samples through the
+           guidance code and writes the result of every batch as CSV.
+
+    Usage:  replay [options] [samples]
+      -b 2|4        binary input, little-endian int16 per sample: left, right
+                    (as capture_decode -b), with 4 also ref_left, ref_right
+      -r left,right reference voltages [A/D] while none are in the input
+      -k p1,..,p8   stored calibration parameters, left Freq. 1-4, right 1-4
+      -c batch      start a calibration after this batch (0: at once)
+      -l samples    samples from the end of a window until its batch is processed
+      -p name=value runtime parameter, see -P for the names
+      -P            list the runtime parameters and exit
+      -o file       CSV output, default stdout
+      -q            no CSV, the summary only
+
+    CSV input: lines of left,right[,ref_left,ref_right], or a header line
+    naming the columns left, right, ref_left, ref_right (others are ignored,
+    so capture_decode output is read as is). Lines starting with # are
+    skipped. Samples are A/D values less the 0x800 offset, reference voltages
+    are A/D values.
+
+    The summary (stderr) gives samples, batches, the valid deviations per
+    frequency and the calibration record written, if any.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "project_canantenna.h"
+#include "host_hal.h"
+#include "replay.h"
+
+#define MAX_PARAMS		(16)
+#define MAX_COLUMNS		(16)
+#define COLUMN_NONE		(-1)
+
+typedef enum
+{
+	COLUMN_LEFT = 0,
+	COLUMN_RIGHT,
+	COLUMN_REF_LEFT,
+	COLUMN_REF_RIGHT,
+	COLUMN_LAST
+} E_column_t;
+
+static const char *ColumnName[COLUMN_LAST] = { "left", "right", "ref_left", "ref_right" };
+
+typedef struct
+{
+	FILE	*in;
+	int		binary;					/* Values per binary frame, 0 for CSV */
+	int		column[COLUMN_LAST];	/* CSV column of each value */
+	int		header_checked;
+} T_input_t;
+
+/* Parse a list of n numbers separated by commas */
+static int parse_list(const char *text, long *values, int n)
+{
+	char	*end;
+	int		i;
+
+	for (i = 0; i < n; ++i)
+	{
+		values[i] = strtol(text, &end, 0);
+		if (end == text)
+			return 0;
+		if (i < (n - 1))
+		{
+			if (*end != ',')
+				return 0;
+			text = end + 1;
+		}
+	}
+
+	return (*end == '\0');
+}
+
+/* Take the columns from a header line, returns 0 when it is not a header */
+static int parse_header(T_input_t *input, char *line)
+{
+	char	*token;
+	int		index = 0;
+	int		c;
+
+	if (strpbrk(line, "abcdefghijklmnopqrstuvwxyz") == NULL)
+		return 0;
+
+	for (c = 0; c < COLUMN_LAST; ++c)
+		input->column[c] = COLUMN_NONE;
+	for (token = strtok(line, ", \t\r\n"); token != NULL; token = strtok(NULL, ", \t\r\n"), ++index)
+	{
+		for (c = 0; c < COLUMN_LAST; ++c)
+		{
+			if (strcmp(token, ColumnName[c]) == 0)
+				input->column[c] = index;
+		}
+	}
+
+	return 1;
+}
+
+/* Read the next sample, refs are unchanged when not in the input.
+   Returns 0 at the end of the input, -1 on an error. */
+static int read_sample(T_input_t *input, int16 *left, int16 *right, int16 *ref_left, int16 *ref_right)
+{
+	char	line[256];
+	long	values[MAX_COLUMNS];
+	int		n;
+
+	if (input->binary != 0)
+	{
+		unsigned char	bytes[8];
+		int16			frame[4];
+		int				i;
+
+		n = (int)fread(bytes, 2, (size_t)input->binary, input->in);
+		if (n == 0)
+			return 0;
+		if (n != input->binary)
+			return -1;
+		for (i = 0; i < n; ++i)
+			frame[i] = (int16)(Uint16)(bytes[2*i] | (bytes[2*i + 1] << 8));
+		*left	= frame[0];
+		*right	= frame[1];
+		if (n == 4)
+		{
+			*ref_left	= frame[2];
+			*ref_right	= frame[3];
+		}
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), input->in) != NULL)
+	{
+		char	*p = line;
+		char	*end;
+
+		if ((line[0] == '#') || (line[strspn(line, " \t\r\n")] == '\0'))
+			continue;
+		if (!input->header_checked)
+		{
+			input->header_checked = 1;
+			if (parse_header(input, line))
+			{
+				if ((input->column[COLUMN_LEFT] == COLUMN_NONE) || (input->column[COLUMN_RIGHT] == COLUMN_NONE))
+					return -1;
+				continue;
+			}
+		}
+
+		for (n = 0; n < MAX_COLUMNS; ++n)
+		{
+			values[n] = strtol(p, &end, 0);
+			if (end == p)
+				break;
+			p = end + strspn(end, " \t");
+			if (*p != ',')
+			{
+				++n;
+				break;
+			}
+			++p;
+		}
+		if ((input->column[COLUMN_LEFT] >= n) || (input->column[COLUMN_RIGHT] >= n))
+			return -1;
+
+		*left	= (int16)values[input->column[COLUMN_LEFT]];
+		*right	= (int16)values[input->column[COLUMN_RIGHT]];
+		if ((input->column[COLUMN_REF_LEFT] != COLUMN_NONE) && (input->column[COLUMN_REF_LEFT] < n))
+			*ref_left = (int16)values[input->column[COLUMN_REF_LEFT]];
+		if ((input->column[COLUMN_REF_RIGHT] != COLUMN_NONE) && (input->column[COLUMN_REF_RIGHT] < n))
+			*ref_right = (int16)values[input->column[COLUMN_REF_RIGHT]];
+		return 1;
+	}
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-b 2|4] [-r left,right] [-k p1,..,p8] [-c batch] [-l samples]\n"
+					"       [-p name=value]... [-P] [-o file] [-q] [samples]\n", name);
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	T_input_t	input = { stdin, 0, { COLUMN_LEFT, COLUMN_RIGHT, 2, 3 }, 0 };
+	FILE		*out = stdout;
+	const char	*out_name = NULL;
+	const char	*params[MAX_PARAMS];
+	int			nbr_params = 0;
+	Uint16		calib[2*NBR_INPUT_FREQ];
+	int			calibrated = 0;
+	long		calibrate_at = -1L;
+	long		latency = 0L;
+	long		values[2*NBR_INPUT_FREQ];
+	int16		ref_left = REPLAY_REFVOLT_DEFAULT;
+	int16		ref_right = REPLAY_REFVOLT_DEFAULT;
+	int16		left;
+	int16		right;
+	int			quiet = 0;
+	int			list = 0;
+	int			opt;
+	int			rc;
+	int			i;
+	Uint32		samples = 0UL;
+	Uint32		valid[NBR_INPUT_FREQ];
+	Uint16		writes;
+	const Uint16 *record;
+	clock_t		cpu;
+
+	while ((opt = getopt(argc, argv, "b:r:k:c:l:p:Po:q")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':
+				input.binary = atoi(optarg);
+				if ((input.binary != 2) && (input.binary != 4))
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'r':
+				if (!parse_list(optarg, values, 2))
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				ref_left	= (int16)values[0];
+				ref_right	= (int16)values[1];
+				break;
+			case 'k':
+				if (!parse_list(optarg, values, 2*NBR_INPUT_FREQ))
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				for (i = 0; i < 2*NBR_INPUT_FREQ; ++i)
+					calib[i] = (Uint16)values[i];
+				calibrated = 1;
+				break;
+			case 'c':
+				calibrate_at = strtol(optarg, NULL, 0);
+				break;
+			case 'l':
+				latency = strtol(optarg, NULL, 0);
+				if ((latency < 0L) || (latency > 1000L))
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'p':
+				if (nbr_params >= MAX_PARAMS)
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				params[nbr_params++] = optarg;
+				break;
+			case 'P':
+				list = 1;
+				break;
+			case 'o':
+				out_name = optarg;
+				break;
+			case 'q':
+				quiet = 1;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	/* Parameters are set after the initialization, which loads the defaults */
+	Replay_init(calibrated ? calib : NULL, (Uint16)latency);
+	for (i = 0; i < nbr_params; ++i)
+	{
+		if (!Replay_param(params[i]))
+		{
+			fprintf(stderr, "replay: invalid parameter %s\n", params[i]);
+			return 1;
+		}
+	}
+	if (list)
+	{
+		Replay_param_list(stdout);
+		return 0;
+	}
+
+	if (optind < argc)
+	{
+		input.in = fopen(argv[optind], input.binary ? "rb" : "r");
+		if (input.in == NULL)
+		{
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+	if (out_name != NULL)
+	{
+		out = fopen(out_name, "w");
+		if (out == NULL)
+		{
+			perror(out_name);
+			return 1;
+		}
+	}
+
+	memset(valid, 0, sizeof(valid));
+	if (calibrate_at == 0L)
+		Replay_calibrate();
+	if (!quiet)
+		Replay_csv_header(out);
+
+	cpu = clock();
+	while ((rc = read_sample(&input, &left, &right, &ref_left, &ref_right)) > 0)
+	{
+		++samples;
+		Replay_refvolt(ref_left, ref_right);
+		if (!Replay_sample(left, right))
+			continue;
+
+		for (i = 0; i < NBR_INPUT_FREQ; ++i)
+			valid[i] += (Replay_result()->deviation_m2ecm[i] != WG_DEVIATION_INVALID) ? 1UL : 0UL;
+		if (!quiet)
+			Replay_csv_row(out);
+		if ((long)Replay_batches() == calibrate_at)
+			Replay_calibrate();
+	}
+	cpu = clock() - cpu;
+	if (rc < 0)
+		fprintf(stderr, "replay: invalid input after sample %lu\n", (unsigned long)samples);
+
+	fprintf(stderr, "samples %lu (%.2f sec), batches %lu, cpu %.3f sec\nvalid",
+			(unsigned long)samples, samples / REPLAY_SAMPLE_RATE, (unsigned long)Replay_batches(),
+			(double)cpu / CLOCKS_PER_SEC);
+	for (i = 0; i < NBR_INPUT_FREQ; ++i)
+		fprintf(stderr, " %lu", (unsigned long)valid[i]);
+	fprintf(stderr, "\n");
+	record = Host_record(EEPROM_RECORD_CALIB, &writes);
+	if ((record != NULL) && (writes != 0U))
+	{
+		fprintf(stderr, "calibration -k ");
+		for (i = 0; i < 2*NBR_INPUT_FREQ; ++i)
+			fprintf(stderr, "%s%u", (i == 0) ? "" : ",", record[i]);
+		fprintf(stderr, "\n");
+	}
+
+	if (out != stdout)
+		fclose(out);
+	if (input.in != stdin)
+		fclose(input.in);
+
+	return (rc < 0) ? 1 : 0;
+}
@@ -0,0 +1,256 @@
+// 2014 - 2015
+
+/*! \file siggen.c
+    \brief Host build: synthetic antenna signals, see siggen.h
+*/
+
+#include <math.h>
+#include <string.h>
+#include "siggen.h"
+
+#ifndef M_PI
+#define M_PI	(3.14159265358979323846)
+#endif
+
+/* The 2nd harmonic phase to twice the 1st Input Freq. phase is SIGGEN_QAM_PHASE
+   less the symbol angle, its amplitude ratio SIGGEN_QAM_GAIN for a symbol of
+   magnitude 100 at qam_level 1: the relative phase of the antenna then reads
+   the symbol (measured with replay) */
+#define SIGGEN_QAM_PHASE	(M_PI / 2.0)
+#define SIGGEN_QAM_GAIN		(1.29)
+
+#define SIGGEN_ADC_OFFSET	(0x800)
+#define SIGGEN_ADC_MAX		(0xFFF)
+
+// Local variables
+/* QAM component levels of the nibble bits 3-2 (in-phase) and 1-0 (quadrature) */
+static const int16 SiggenQamLevel[4] = { -75, -25, 75, 25 };
+
+/* Parity nibble of a data nibble, as wireGuid_QAM_Parity */
+static const Uint8 SiggenQamParity[16] = {
+	0x00U, 0x0EU, 0x0DU, 0x03U,
+	0x0BU, 0x05U, 0x06U, 0x08U,
+	0x07U, 0x09U, 0x0AU, 0x04U,
+	0x0CU, 0x02U, 0x01U, 0x0FU
+};
+
+//*****************************************************************************
+// Static functions
+//*****************************************************************************
+/* Uniform in ]0, 1[, xorshift32 */
+static double siggen_uniform(T_siggen_t *pGen)
+{
+	Uint32	x = pGen->rng;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	pGen->rng = x;
+
+	return ((double)x + 0.5) / 4294967296.0;
+}
+
+/*************************************************************************/
+/* Normal distribution, Box-Muller */
+static double siggen_gauss(T_siggen_t *pGen)
+{
+	double	u1 = siggen_uniform(pGen);
+	double	u2 = siggen_uniform(pGen);
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/*************************************************************************/
+/* Coil gain to a wire at lateral distance x, height h */
+static double siggen_coil_gain(E_siggen_coil_t coil, double x, double h)
+{
+	double	r2 = (x * x) + (h * h);
+
+	if (r2 < 1e-6)
+		r2 = 1e-6;
+
+	switch (coil)
+	{
+		case SIGGEN_COIL_HORIZONTAL:
+			return SIGGEN_REF_DISTANCE * h / r2;
+		case SIGGEN_COIL_VERTICAL:
+			return SIGGEN_REF_DISTANCE * x / r2;
+		case SIGGEN_COIL_FIELD:
+		default:
+			return SIGGEN_REF_DISTANCE / sqrt(r2);
+	}
+}
+
+/*************************************************************************/
+/* Data nibble of QAM symbol i in the frame */
+static Uint8 siggen_qam_nibble(const T_siggen_t *pGen, Uint8 i)
+{
+	switch (i)
+	{
+		case 4:		return 0x08U;									/* Start data */
+		case 5:		return 0x07U;									/* Start parity */
+		case 6:		return (Uint8)(pGen->qam_switches >> 4);
+		case 7:		return SiggenQamParity[pGen->qam_switches >> 4];
+		case 8:		return (Uint8)(pGen->qam_switches & 0x0FU);
+		case 9:		return SiggenQamParity[pGen->qam_switches & 0x0FU];
+		case 10:
+		case 11:
+		case 12:
+		case 13:	return 0x00U;									/* Reserved */
+		default:	return 0x0AU;									/* End */
+	}
+}
+
+/*************************************************************************/
+/* Amplitude seen by a coil, sensitivity of the coil applied */
+static double siggen_coil(const T_siggen_t *pGen, Uint8 wire, E_siggen_side_t side, Uint32 n)
+{
+	const T_siggen_wire_t	*pWire = &(pGen->wire[wire]);
+	const T_siggen_fault_t	*pFault = &(pGen->fault[side]);
+	double					x = pWire->offset + ((side == SIGGEN_LEFT) ? 0.5 : -0.5) * pGen->coil_spacing;
+	double					gain = 1.0;
+
+	if ((pFault->type != SIGGEN_FAULT_NONE) && (n >= pFault->start))
+		gain = (pFault->type == SIGGEN_FAULT_GAIN) ? pFault->gain : 0.0;
+
+	return gain * pWire->amplitude * siggen_coil_gain(pGen->coil, x, pWire->height);
+}
+
+//*****************************************************************************
+// Local functions
+//*****************************************************************************
+/*! Siggen_init() sets the defaults: the 4 default Input Frequencies on wires
+	under the antenna centre, pilot tone, no QAM, no noise */
+void Siggen_init(T_siggen_t *pGen, Uint32 seed)
+{
+	static const double Freq[SIGGEN_MAX_WIRES] = { FREQ1_HZ, FREQ2_HZ, FREQ3_HZ, FREQ4_HZ };
+	Uint8	i;
+
+	memset((void*)pGen, 0, sizeof(T_siggen_t));
+	pGen->nbr_wires = SIGGEN_MAX_WIRES;
+	for (i = 0U; i < SIGGEN_MAX_WIRES; ++i)
+	{
+		pGen->wire[i].freq		= Freq[i];
+		pGen->wire[i].amplitude	= 300.0;
+		pGen->wire[i].height	= 0.1;
+	}
+	pGen->coil				= SIGGEN_COIL_FIELD;
+	pGen->coil_spacing		= 0.2;
+	pGen->pilot				= 200.0;
+	pGen->symbol_samples	= 215U;
+	pGen->refvolt			= SIGGEN_REFVOLT_DEFAULT;
+	pGen->rng				= (seed != 0UL) ? seed : 1UL;
+
+	return;
+}
+
+/*! Siggen_sample() computes sample n, as read by the A/D interrupt */
+void Siggen_sample(T_siggen_t *pGen, Uint32 n, T_siggen_sample_t *pSample)
+{
+	double	t = (double)n / SIGGEN_SAMPLE_RATE;
+	double	value[SIGGEN_SIDES];
+	int16	inPhase;
+	int16	quad;
+	sbool	qam;
+	Uint8	side;
+	Uint8	i;
+
+	qam = (pGen->qam_level > 0.0) && (pGen->nbr_wires > 0U) &&
+		  (Siggen_symbol(pGen, n, &inPhase, &quad) < SIGGEN_QAM_SYMBOLS) &&
+		  ((inPhase != 0) || (quad != 0));
+
+	for (side = 0U; side < SIGGEN_SIDES; ++side)
+	{
+		const T_siggen_fault_t	*pFault = &(pGen->fault[side]);
+		E_siggen_fault_t		fault = (n >= pFault->start) ? pFault->type : SIGGEN_FAULT_NONE;
+		double					v = 0.0;
+		int16					ref = pGen->refvolt;
+
+		for (i = 0U; i < pGen->nbr_wires; ++i)
+			v += siggen_coil(pGen, i, (E_siggen_side_t)side, n) *
+				 sin(2.0 * M_PI * pGen->wire[i].freq * t + pGen->wire[i].phase);
+
+		if (qam)
+		{
+			double	ratio = SIGGEN_QAM_GAIN * pGen->qam_level * sqrt((double)inPhase * inPhase + (double)quad * quad) / 100.0;
+			double	phase = 2.0 * pGen->wire[0].phase + SIGGEN_QAM_PHASE - atan2((double)quad, (double)inPhase);
+
+			v += ratio * siggen_coil(pGen, 0U, (E_siggen_side_t)side, n) *
+				 sin(2.0 * M_PI * 2.0 * pGen->wire[0].freq * t + phase);
+		}
+
+		/* The pilot tone is injected at the coil input */
+		switch (fault)
+		{
+			case SIGGEN_FAULT_OPEN:
+				ref = SIGGEN_REFVOLT_OPEN;
+				break;
+			case SIGGEN_FAULT_SHORT:
+				ref = SIGGEN_REFVOLT_SHORT;
+				break;
+			case SIGGEN_FAULT_DEAD:
+				break;
+			case SIGGEN_FAULT_GAIN:
+				v += pFault->gain * pGen->pilot * sin(2.0 * M_PI * TEST_FREQUENCY_HZ * t);
+				break;
+			default:
+				v += pGen->pilot * sin(2.0 * M_PI * TEST_FREQUENCY_HZ * t);
+				break;
+		}
+
+		if (pGen->noise > 0.0)
+			v += pGen->noise * siggen_gauss(pGen);
+
+		/* 12-bit A/D, offset removed as by the A/D interrupt */
+		v = floor(v + 0.5) + SIGGEN_ADC_OFFSET;
+		if (v < 0.0)
+			v = 0.0;
+		else if (v > SIGGEN_ADC_MAX)
+			v = SIGGEN_ADC_MAX;
+		value[side] = v - SIGGEN_ADC_OFFSET;
+
+		if (side == SIGGEN_LEFT)
+			pSample->ref_left = ref;
+		else
+			pSample->ref_right = ref;
+	}
+
+	pSample->left	= (int16)value[SIGGEN_LEFT];
+	pSample->right	= (int16)value[SIGGEN_RIGHT];
+
+	return;
+}
+
+/*! Siggen_amplitude() returns the peak amplitude [A/D] of a wire seen by a
+	coil, signed for a vertical coil. Ground truth of the Goertzel amplitude. */
+double Siggen_amplitude(const T_siggen_t *pGen, Uint8 wire, E_siggen_side_t side)
+{
+	const T_siggen_wire_t	*pWire = &(pGen->wire[wire]);
+	double					x = pWire->offset + ((side == SIGGEN_LEFT) ? 0.5 : -0.5) * pGen->coil_spacing;
+
+	return pWire->amplitude * siggen_coil_gain(pGen->coil, x, pWire->height);
+}
+
+/*! Siggen_symbol() returns the QAM symbol of sample n, index in the frame,
+	SIGGEN_QAM_SYMBOLS before the first frame. The synchronization symbols
+	are (0,0), no 2nd harmonic. */
+Uint8 Siggen_symbol(const T_siggen_t *pGen, Uint32 n, int16 *pInPhase, int16 *pQuad)
+{
+	Uint8	i;
+	Uint8	nibble;
+
+	*pInPhase	= 0;
+	*pQuad		= 0;
+	if ((n < pGen->symbol_start) || (pGen->symbol_samples == 0U))
+		return SIGGEN_QAM_SYMBOLS;
+
+	i = (Uint8)(((n - pGen->symbol_start) / pGen->symbol_samples) % SIGGEN_QAM_SYMBOLS);
+	if (i < 4U)
+		return i;
+
+	nibble		= siggen_qam_nibble(pGen, i);
+	*pInPhase	= SiggenQamLevel[(nibble >> 2) & 0x03U];
+	*pQuad		= SiggenQamLevel[nibble & 0x03U];
+
+	return i;
+}
@@ -0,0 +1,112 @@
+// 2014 - 2015
+
+/*! \file siggen.h
+    \brief Host build: synthetic antenna signals. Every wire carries one input
+           Frequency; the left and right coil see it with an amplitude given
+           by their distance to the wire. The pilot tone is added to both
+           coils, the 2nd harmonic of the 1st Input Frequency carries the QAM
+           stream of the Frequency generator (see wireGuid_QAM_decode). Noise,
+           12-bit quantisation with the 0x800 offset and coil faults are
+           applied as by the antenna hardware.
+*/
+
+#ifndef __HOST_SIGGEN_H
+#define __HOST_SIGGEN_H
+
+#include "stypes.h"
+#include "configuration.h"
+
+/* Defines */
+/* A/D sample rate [Hz], FCY / ADC_PERIOD_TCY */
+#define SIGGEN_SAMPLE_RATE		(20000000.0 / 1320.0)
+
+#define SIGGEN_MAX_WIRES		(NBR_INPUT_FREQ)
+
+/* Distance of a coil to the wire at which the wire amplitude is seen [m] */
+#define SIGGEN_REF_DISTANCE		(0.1)
+
+/* Symbols of a QAM frame: synchronization 4, start 2, switches 4, reserved 4, end 2 */
+#define SIGGEN_QAM_SYMBOLS		(16)
+
+/* Reference voltage [A/D] of a good coil, of an open and a short-circuited coil */
+#define SIGGEN_REFVOLT_DEFAULT	(408)
+#define SIGGEN_REFVOLT_OPEN		(4095)
+#define SIGGEN_REFVOLT_SHORT	(0)
+
+/* Typedefs */
+typedef enum
+{
+	SIGGEN_COIL_FIELD = 0,		/* Field strength: amplitude ~ 1/r */
+	SIGGEN_COIL_HORIZONTAL,		/* Horizontal axis across the wire: ~ h/r^2 */
+	SIGGEN_COIL_VERTICAL,		/* Vertical axis: ~ x/r^2, changes sign over the wire */
+	SIGGEN_COIL_LAST
+} E_siggen_coil_t;
+
+typedef enum
+{
+	SIGGEN_FAULT_NONE = 0,
+	SIGGEN_FAULT_OPEN,			/* Cable broken: reference voltage high, noise only */
+	SIGGEN_FAULT_SHORT,			/* Short circuit: reference voltage 0, noise only */
+	SIGGEN_FAULT_DEAD,			/* Amplifier failed: no signal, no pilot tone */
+	SIGGEN_FAULT_GAIN,			/* Sensitivity changed by gain */
+	SIGGEN_FAULT_LAST
+} E_siggen_fault_t;
+
+typedef enum
+{
+	SIGGEN_LEFT = 0,
+	SIGGEN_RIGHT,
+	SIGGEN_SIDES
+} E_siggen_side_t;
+
+typedef struct
+{
+	double	freq;				/* [Hz] */
+	double	amplitude;			/* Peak [A/D] at SIGGEN_REF_DISTANCE */
+	double	offset;				/* Lateral position of the wire to the antenna centre [m],
+								   positive to the right */
+	double	height;				/* Height of the antenna above the wire [m] */
+	double	phase;				/* [rad] */
+} T_siggen_wire_t;
+
+typedef struct
+{
+	E_siggen_fault_t	type;
+	double				gain;	/* SIGGEN_FAULT_GAIN */
+	Uint32				start;	/* First faulty sample */
+} T_siggen_fault_t;
+
+typedef struct
+{
+	Uint8				nbr_wires;
+	T_siggen_wire_t		wire[SIGGEN_MAX_WIRES];
+	E_siggen_coil_t		coil;
+	double				coil_spacing;		/* Distance left to right coil [m] */
+	double				pilot;				/* Peak [A/D] of the pilot tone */
+	double				qam_level;			/* Level of the QAM stream, 1 for the nominal
+											   constellation, 0 for none */
+	Uint8				qam_switches;		/* Switch states sent in every frame */
+	Uint16				symbol_samples;		/* Samples per QAM symbol */
+	Uint32				symbol_start;		/* Sample of the first frame */
+	double				noise;				/* Standard deviation [A/D] */
+	int16				refvolt;			/* Reference voltage of a good coil [A/D] */
+	T_siggen_fault_t	fault[SIGGEN_SIDES];
+	Uint32				rng;				/* Noise generator state, not 0 */
+} T_siggen_t;
+
+/* A/D values as read by the A/D interrupt: samples less the 0x800 offset */
+typedef struct
+{
+	int16	left;
+	int16	right;
+	int16	ref_left;
+	int16	ref_right;
+} T_siggen_sample_t;
+
+/* Function declarations */
+void Siggen_init(T_siggen_t *pGen, Uint32 seed);
+void Siggen_sample(T_siggen_t *pGen, Uint32 n, T_siggen_sample_t *pSample);
+double Siggen_amplitude(const T_siggen_t *pGen, Uint8 wire, E_siggen_side_t side);
+Uint8 Siggen_symbol(const T_siggen_t *pGen, Uint32 n, int16 *pInPhase, int16 *pQuad);
+
+#endif // End of __HOST_SIGGEN_H definition
@@ -0,0 +1,319 @@
+// 2014 - 2015
+
+/*! \file siggen_main.c
+    \brief Host tool: writes synthetic antenna samples for the replay tool,
+           and the ground truth per window.
+
+    Usage:  siggen [options]
+      -t sec        duration, default 10
+      -w f[,a[,x[,h]]]  a wire: Frequency [Hz], amplitude [A/D] at 0.1 m,
+                    lateral position x [m], height h [m]; repeat for every
+                    wire, the first -w replaces the 4 default wires
+      -v m/s        lateral speed of all wires
+      -s m          coil spacing, default 0.2
+      -m coil       field, horizontal or vertical
+      -p a          pilot tone amplitude [A/D], 0 for none
+      -q level[,switches]  QAM stream on the 2nd harmonic of the 1st wire,
+                    level 1 for the nominal constellation (+/-25, +/-75);
+                    switches: switch states (byte)
+      -n sigma      noise [A/D]
+      -r ref        reference voltage of a good coil [A/D]
+      -f side:fault[@sec]  coil fault, side left, right or both; fault
+                    open, short, dead or gain=<factor>
+      -S seed       noise seed
+      -b            binary output: little-endian int16 left, right,
+                    ref_left, ref_right (replay -b 4), else CSV
+      -o file       samples, default stdout
+      -g file       ground truth CSV, one line per window (215 samples)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "siggen.h"
+
+/* Lines of the ground truth */
+#define TRUTH_SAMPLES	(215UL)
+
+static const char *CoilName[SIGGEN_COIL_LAST] = { "field", "horizontal", "vertical" };
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-t sec] [-w f[,a[,x[,h]]]]... [-v m/s] [-s m] [-m coil] [-p a]\n"
+					"       [-q level[,switches]] [-n sigma] [-r ref] [-f side:fault[@sec]]...\n"
+					"       [-S seed] [-b] [-o file] [-g file]\n", name);
+
+	return;
+}
+
+/* Parse "f[,a[,x[,h]]]" */
+static int parse_wire(const char *text, T_siggen_wire_t *pWire)
+{
+	double	values[4];
+	char	*end;
+	int		n;
+
+	for (n = 0; n < 4; ++n)
+	{
+		values[n] = strtod(text, &end);
+		if (end == text)
+			return 0;
+		if (*end != ',')
+		{
+			++n;
+			break;
+		}
+		text = end + 1;
+	}
+	if (*end != '\0')
+		return 0;
+
+	pWire->freq = values[0];
+	if (n > 1)
+		pWire->amplitude = values[1];
+	if (n > 2)
+		pWire->offset = values[2];
+	if (n > 3)
+		pWire->height = values[3];
+
+	return (pWire->freq > 0.0) && (pWire->height > 0.0);
+}
+
+/* Parse "side:fault[@sec]" */
+static int parse_fault(const char *text, T_siggen_t *pGen)
+{
+	T_siggen_fault_t	fault = { SIGGEN_FAULT_NONE, 1.0, 0UL };
+	const char			*type = strchr(text, ':');
+	const char			*at = strchr(text, '@');
+	size_t				length;
+	int					side;
+
+	if (type == NULL)
+		return 0;
+	++type;
+	length = (at != NULL) ? (size_t)(at - type) : strlen(type);
+
+	if ((length == 4U) && (strncmp(type, "open", 4U) == 0))
+		fault.type = SIGGEN_FAULT_OPEN;
+	else if ((length == 5U) && (strncmp(type, "short", 5U) == 0))
+		fault.type = SIGGEN_FAULT_SHORT;
+	else if ((length == 4U) && (strncmp(type, "dead", 4U) == 0))
+		fault.type = SIGGEN_FAULT_DEAD;
+	else if (strncmp(type, "gain=", 5U) == 0)
+	{
+		fault.type = SIGGEN_FAULT_GAIN;
+		fault.gain = strtod(type + 5, NULL);
+	}
+	else
+		return 0;
+
+	if (at != NULL)
+		fault.start = (Uint32)(strtod(at + 1, NULL) * SIGGEN_SAMPLE_RATE);
+
+	for (side = 0; side < SIGGEN_SIDES; ++side)
+	{
+		static const char *SideName[SIGGEN_SIDES] = { "left", "right" };
+		size_t	side_length = (size_t)(type - 1 - text);
+
+		if (((side_length == 4U) && (strncmp(text, "both", 4U) == 0)) ||
+			((side_length == strlen(SideName[side])) && (strncmp(text, SideName[side], side_length) == 0)))
+			pGen->fault[side] = fault;
+	}
+
+	return 1;
+}
+
+static void write_truth_header(FILE *truth, const T_siggen_t *pGen)
+{
+	Uint8	i;
+
+	fprintf(truth, "# coil %s, spacing %g m\nsample,time", CoilName[pGen->coil], pGen->coil_spacing);
+	for (i = 1U; i <= pGen->nbr_wires; ++i)
+		fprintf(truth, ",freq%u,offset%u,height%u,ampl_left%u,ampl_right%u", i, i, i, i, i);
+	fprintf(truth, ",symbol,qam_i,qam_q\n");
+
+	return;
+}
+
+/* Truth of the window that ends with sample n */
+static void write_truth(FILE *truth, const T_siggen_t *pGen, Uint32 n)
+{
+	int16	inPhase;
+	int16	quad;
+	Uint8	symbol;
+	Uint8	i;
+
+	fprintf(truth, "%lu,%.6f", (unsigned long)(n + 1UL), (n + 1UL) / SIGGEN_SAMPLE_RATE);
+	for (i = 0U; i < pGen->nbr_wires; ++i)
+		fprintf(truth, ",%g,%.6f,%.6f,%.3f,%.3f", pGen->wire[i].freq, pGen->wire[i].offset, pGen->wire[i].height,
+				Siggen_amplitude(pGen, i, SIGGEN_LEFT), Siggen_amplitude(pGen, i, SIGGEN_RIGHT));
+	symbol = Siggen_symbol(pGen, n, &inPhase, &quad);
+	if ((pGen->qam_level > 0.0) && (symbol < SIGGEN_QAM_SYMBOLS))
+		fprintf(truth, ",%u,%d,%d\n", symbol, inPhase, quad);
+	else
+		fprintf(truth, ",,,\n");
+
+	return;
+}
+
+int main(int argc, char *argv[])
+{
+	T_siggen_t			gen;
+	T_siggen_sample_t	sample;
+	double				offset[SIGGEN_MAX_WIRES];
+	double				duration = 10.0;
+	double				speed = 0.0;
+	Uint32				seed = 1UL;
+	Uint32				samples;
+	Uint32				n;
+	int					user_wires = 0;
+	int					binary = 0;
+	const char			*out_name = NULL;
+	const char			*truth_name = NULL;
+	FILE				*out = stdout;
+	FILE				*truth = NULL;
+	char				*end;
+	int					opt;
+	int					i;
+
+	/* The seed is taken first, the other options change the defaults */
+	for (i = 1; i < (argc - 1); ++i)
+	{
+		if (strcmp(argv[i], "-S") == 0)
+			seed = (Uint32)strtoul(argv[i + 1], NULL, 0);
+	}
+	Siggen_init(&gen, seed);
+
+	while ((opt = getopt(argc, argv, "t:w:v:s:m:p:q:n:r:f:S:bo:g:")) != -1)
+	{
+		switch (opt)
+		{
+			case 't':
+				duration = strtod(optarg, NULL);
+				break;
+			case 'w':
+				if (user_wires == 0)
+					gen.nbr_wires = 0U;
+				if ((gen.nbr_wires >= SIGGEN_MAX_WIRES) || !parse_wire(optarg, &gen.wire[gen.nbr_wires]))
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				++gen.nbr_wires;
+				user_wires = 1;
+				break;
+			case 'v':
+				speed = strtod(optarg, NULL);
+				break;
+			case 's':
+				gen.coil_spacing = strtod(optarg, NULL);
+				break;
+			case 'm':
+				for (i = 0; (i < SIGGEN_COIL_LAST) && (strcmp(optarg, CoilName[i]) != 0); ++i)
+					;
+				if (i >= SIGGEN_COIL_LAST)
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				gen.coil = (E_siggen_coil_t)i;
+				break;
+			case 'p':
+				gen.pilot = strtod(optarg, NULL);
+				break;
+			case 'q':
+				gen.qam_level = strtod(optarg, &end);
+				if (*end == ',')
+					gen.qam_switches = (Uint8)strtoul(end + 1, NULL, 0);
+				break;
+			case 'n':
+				gen.noise = strtod(optarg, NULL);
+				break;
+			case 'r':
+				gen.refvolt = (int16)strtol(optarg, NULL, 0);
+				break;
+			case 'f':
+				if (!parse_fault(optarg, &gen))
+				{
+					usage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'S':
+				break;
+			case 'b':
+				binary = 1;
+				break;
+			case 'o':
+				out_name = optarg;
+				break;
+			case 'g':
+				truth_name = optarg;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (out_name != NULL)
+	{
+		out = fopen(out_name, binary ? "wb" : "w");
+		if (out == NULL)
+		{
+			perror(out_name);
+			return 1;
+		}
+	}
+	if (truth_name != NULL)
+	{
+		truth = fopen(truth_name, "w");
+		if (truth == NULL)
+		{
+			perror(truth_name);
+			return 1;
+		}
+		write_truth_header(truth, &gen);
+	}
+	if (!binary)
+		fprintf(out, "left,right,ref_left,ref_right\n");
+
+	for (i = 0; i < gen.nbr_wires; ++i)
+		offset[i] = gen.wire[i].offset;
+	samples = (Uint32)(duration * SIGGEN_SAMPLE_RATE);
+	for (n = 0UL; n < samples; ++n)
+	{
+		if (speed != 0.0)
+		{
+			for (i = 0; i < gen.nbr_wires; ++i)
+				gen.wire[i].offset = offset[i] + speed * (n / SIGGEN_SAMPLE_RATE);
+		}
+		Siggen_sample(&gen, n, &sample);
+
+		if (binary)
+		{
+			int16			values[4] = { sample.left, sample.right, sample.ref_left, sample.ref_right };
+			unsigned char	bytes[8];
+
+			for (i = 0; i < 4; ++i)
+			{
+				bytes[2*i]		= (unsigned char)((Uint16)values[i] & 0xFFU);
+				bytes[2*i + 1]	= (unsigned char)((Uint16)values[i] >> 8);
+			}
+			fwrite(bytes, 1, sizeof(bytes), out);
+		}
+		else
+			fprintf(out, "%d,%d,%d,%d\n", sample.left, sample.right, sample.ref_left, sample.ref_right);
+
+		if ((truth != NULL) && (((n + 1UL) % TRUTH_SAMPLES) == 0UL))
+			write_truth(truth, &gen, n);
+	}
+
+	if (out != stdout)
+		fclose(out);
+	if (truth != NULL)
+		fclose(truth);
+
+	return 0;
+}
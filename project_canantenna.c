@@ -61,58 +61,15 @@ int main()
 	/* Initialize general modules that are applicable */
 	/* Initialize guidance module */
 	Guid_init(&gGuidanceData);
+
+	/* Tasks are released from now on */
+	Sched_init();
 			
 	/* Re-start all systems after configuration and initialization */
 	System_start();
 
+	/* Run the tasks, does not return */
+	Sched_run();
 
-	/* Start endless loop */
-	do{
-		/* Run 100Hz computations */
-		if (gSystemData.clockT1SysData.puls_100Hz)
-		{
-			/* Process measurements used for guidance */
-			Guid_process(&gGuidanceData);
-
-			#if DISABLE_ADC_ISR_CAN
-			// Disable A/D interrupt so that it does not interfere
-			IEC0bits.ADIE = 0; // Control Bit for individual enabling/disabling of A/D interrupt 
-			#endif
-
-			/* Output messages */
-			// Re-enable CAN (Phase 3)
-			/* Measure clock ticks for TX Results, Statuses, Raws functions (calls) */
-			#ifdef FUNCTION_CALL_CAN
-			t_can[1] = clock();
-			#endif
-			Can_transmit_wireguid_result(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
-                                            gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_0].content);
-			#ifdef FUNCTION_CALL_CAN
-			t_can[1] = clock() - t_can[1];
-			t_can[2] = clock();
-			#endif 
-			Can_transmit_wireguid_status(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
-                                            gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_1].content);
-			#ifdef FUNCTION_CALL_CAN
-			t_can[2] = clock() - t_can[2];
-			t_can[3] = clock();
-			#endif 
-			Can_transmit_wireguid_raw(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
-                                        gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_2].content);
-			#ifdef FUNCTION_CALL_CAN
-			t_can[3] = clock() - t_can[3];
-			#endif 
-	
-			#if DISABLE_ADC_ISR_CAN
-			// Re-enable A/D interrupt
-			IEC0bits.ADIE = 1;
-			#endif
-
-			Can_transmit_wireguid_switches(&(gGuidanceData.wireGuidData), &(gSystemData.can_data),
-                                            gSystemData.can_data.can_tx_msg_buffer[CAN_TX_MSG_BUFFER_3].content);
-			
-			/* Reset 100Hz pulse */
-			gSystemData.clockT1SysData.puls_100Hz = 0;
-		}
-	} while(1);
+	return 0;
 }
@@ -23,6 +23,7 @@
 #include "gen_math.h"	// Header with mathematical functions and defines
 #include "interrupts.h"	// Interrupt routines
 #include "eeprom.h"		// EEPROM routine
+#include "eeprom_record.h"	// EEPROM record store
 #include "io.h"
 #include "adcmonitoring.h"		// Monitor of A/D functionality
 #include "systemmonitoring.h"	// System monitoring
@@ -31,6 +32,10 @@
 #include "guidance.h"		// General Guidance definitions
 #include "antenna_calculation.h"		// Definitions and functions related to Goertzel algorithm
 #include "can.h"	// Definitions and functions related to the CAN module
+#include "objdict.h"	// Object dictionary, SDO server
+#include "scheduler.h"	// Task scheduler
+#include "perf.h"	// Performance counters
+#include "capture.h"	// Sample capture
 #include "systemtypes.h"	// Configuration of system, device
 #include "system.h"	// Configuration of system, device
 #include "clock.h"	// Internal clock configuration